@@ -38,18 +38,56 @@ BEGIN_RCPP
 END_RCPP
 }
 // KMedoids__fit
-void KMedoids__fit(SEXP xp, arma::mat data, std::vector< std::string > loss, SEXP distMat);
-RcppExport SEXP _banditpam_KMedoids__fit(SEXP xpSEXP, SEXP dataSEXP, SEXP lossSEXP, SEXP distMatSEXP) {
+void KMedoids__fit(SEXP xp, arma::mat data, std::vector< std::string > loss, SEXP distMat, SEXP initMedoids);
+RcppExport SEXP _banditpam_KMedoids__fit(SEXP xpSEXP, SEXP dataSEXP, SEXP lossSEXP, SEXP distMatSEXP, SEXP initMedoidsSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type xp(xpSEXP);
     Rcpp::traits::input_parameter< arma::mat >::type data(dataSEXP);
     Rcpp::traits::input_parameter< std::vector< std::string > >::type loss(lossSEXP);
     Rcpp::traits::input_parameter< SEXP >::type distMat(distMatSEXP);
-    KMedoids__fit(xp, data, loss, distMat);
+    Rcpp::traits::input_parameter< SEXP >::type initMedoids(initMedoidsSEXP);
+    KMedoids__fit(xp, data, loss, distMat, initMedoids);
     return R_NilValue;
 END_RCPP
 }
+// KMedoids__predict
+SEXP KMedoids__predict(SEXP xp, arma::mat data, LogicalVector returnDistances);
+RcppExport SEXP _banditpam_KMedoids__predict(SEXP xpSEXP, SEXP dataSEXP, SEXP returnDistancesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type xp(xpSEXP);
+    Rcpp::traits::input_parameter< arma::mat >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< LogicalVector >::type returnDistances(returnDistancesSEXP);
+    rcpp_result_gen = Rcpp::wrap(KMedoids__predict(xp, data, returnDistances));
+    return rcpp_result_gen;
+END_RCPP
+}
+// KMedoids__save
+void KMedoids__save(SEXP xp, std::string path, LogicalVector includeMedoids);
+RcppExport SEXP _banditpam_KMedoids__save(SEXP xpSEXP, SEXP pathSEXP, SEXP includeMedoidsSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type xp(xpSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< LogicalVector >::type includeMedoids(includeMedoidsSEXP);
+    KMedoids__save(xp, path, includeMedoids);
+    return R_NilValue;
+END_RCPP
+}
+// KMedoids__load
+SEXP KMedoids__load(SEXP xp, std::string path);
+RcppExport SEXP _banditpam_KMedoids__load(SEXP xpSEXP, SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type xp(xpSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(KMedoids__load(xp, path));
+    return rcpp_result_gen;
+END_RCPP
+}
 // KMedoids__get_medoids_final
 SEXP KMedoids__get_medoids_final(SEXP xp);
 RcppExport SEXP _banditpam_KMedoids__get_medoids_final(SEXP xpSEXP) {
@@ -198,7 +236,10 @@ END_RCPP
 static const R_CallMethodDef CallEntries[] = {
     {"_banditpam_bpam_num_threads", (DL_FUNC) &_banditpam_bpam_num_threads, 0},
     {"_banditpam_KMedoids__new", (DL_FUNC) &_banditpam_KMedoids__new, 6},
-    {"_banditpam_KMedoids__fit", (DL_FUNC) &_banditpam_KMedoids__fit, 4},
+    {"_banditpam_KMedoids__fit", (DL_FUNC) &_banditpam_KMedoids__fit, 5},
+    {"_banditpam_KMedoids__predict", (DL_FUNC) &_banditpam_KMedoids__predict, 3},
+    {"_banditpam_KMedoids__save", (DL_FUNC) &_banditpam_KMedoids__save, 3},
+    {"_banditpam_KMedoids__load", (DL_FUNC) &_banditpam_KMedoids__load, 2},
     {"_banditpam_KMedoids__get_medoids_final", (DL_FUNC) &_banditpam_KMedoids__get_medoids_final, 1},
     {"_banditpam_KMedoids__get_k", (DL_FUNC) &_banditpam_KMedoids__get_k, 1},
     {"_banditpam_KMedoids__set_k", (DL_FUNC) &_banditpam_KMedoids__set_k, 2},
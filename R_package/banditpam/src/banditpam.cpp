@@ -13,7 +13,8 @@
 namespace km {
 void BanditPAM::fitBanditPAM(
   const arma_mat& inputData,
-  std::optional<std::reference_wrapper<const arma_mat>> distMat) {
+  std::optional<std::reference_wrapper<const arma_mat>> distMat,
+  std::optional<arma::urowvec> initMedoids) {
   data = arma::trans(inputData);
 
   // Note: even if we are using a distance matrix, we compute the permutation
@@ -42,7 +43,15 @@ void BanditPAM::fitBanditPAM(
   arma_mat medoidMatrix(data.n_rows, nMedoids);
   arma::urowvec medoidIndices(nMedoids);
   steps = 0;
-  BanditPAM::build(data, distMat, &medoidIndices, &medoidMatrix);
+  if (initMedoids) {
+    // Warm start: SWAP begins directly from the given medoids
+    medoidIndices = initMedoids.value();
+    for (size_t k = 0; k < nMedoids; k++) {
+      medoidMatrix.unsafe_col(k) = data.unsafe_col(medoidIndices(k));
+    }
+  } else {
+    BanditPAM::build(data, distMat, &medoidIndices, &medoidMatrix);
+  }
 
   medoidIndicesBuild = medoidIndices;
   arma::urowvec assignments(data.n_cols);
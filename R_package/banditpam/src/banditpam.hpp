@@ -19,10 +19,12 @@ class BanditPAM : public km::KMedoids {
    * @brief Runs BanditPAM to identify a dataset's medoids.
    *
    * @param inputData Input data to cluster
+   * @param initMedoids Optional medoids to start SWAP from, skipping BUILD
    */
   void fitBanditPAM(
     const arma_mat& inputData,
-    std::optional<std::reference_wrapper<const arma_mat>> distMat);
+    std::optional<std::reference_wrapper<const arma_mat>> distMat,
+    std::optional<arma::urowvec> initMedoids = std::nullopt);
 
   /**
    * @brief Empirical estimation of standard deviation of arm returns
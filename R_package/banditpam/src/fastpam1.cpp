@@ -17,11 +17,16 @@
 namespace km {
 void FastPAM1::fitFastPAM1(
   const arma_mat& inputData,
-  std::optional<std::reference_wrapper<const arma_mat>> distMat) {
+  std::optional<std::reference_wrapper<const arma_mat>> distMat,
+  std::optional<arma::urowvec> initMedoids) {
   data = inputData;
   data = arma::trans(data);
   arma::urowvec medoidIndices(nMedoids);
-  FastPAM1::buildFastPAM1(data, distMat, &medoidIndices);
+  if (initMedoids) {
+    medoidIndices = initMedoids.value();
+  } else {
+    FastPAM1::buildFastPAM1(data, distMat, &medoidIndices);
+  }
   steps = 0;
   medoidIndicesBuild = medoidIndices;
   arma::urowvec assignments(data.n_cols);
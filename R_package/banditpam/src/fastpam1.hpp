@@ -19,10 +19,12 @@ class FastPAM1 : public km::KMedoids {
    * @brief Runs the FastPAM1 algorithm to identify a dataset's medoids.
    *
    * @param inputData Input data to cluster
+   * @param initMedoids Optional medoids to start SWAP from, skipping BUILD
    */
   void fitFastPAM1(
     const arma_mat& inputData,
-    std::optional<std::reference_wrapper<const arma_mat>> distMat);
+    std::optional<std::reference_wrapper<const arma_mat>> distMat,
+    std::optional<arma::urowvec> initMedoids = std::nullopt);
 
   /**
    * @brief Performs the BUILD step of FastPAM1.
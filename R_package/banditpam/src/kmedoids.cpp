@@ -52,19 +52,91 @@ SEXP KMedoids__new(IntegerVector k, CharacterVector alg, IntegerVector max_iter,
 //// @param data the data matrix
 //// @param loss the loss indicator
 //// @param distMat the optional distance matrix
+//// @param initMedoids the optional 1-based indices of the medoids to start SWAP from
 // [[Rcpp::export(.KMedoids__fit)]]
-void KMedoids__fit(SEXP xp, arma::mat data, std::vector< std::string > loss, SEXP distMat = R_NilValue) {
+void KMedoids__fit(SEXP xp, arma::mat data, std::vector< std::string > loss, SEXP distMat = R_NilValue, SEXP initMedoids = R_NilValue) {
   // grab the object as a XPtr (smart pointer)
   XPtr<km::KMedoids> ptr(xp);
 
+  // Turn 1-based indices from R into 0-based indices
+  std::optional<arma::urowvec> init = std::nullopt;
+  if (initMedoids != R_NilValue) {
+    IntegerVector initIndices(initMedoids);
+    arma::urowvec medoidIndices(initIndices.size());
+    for (R_xlen_t i = 0; i < initIndices.size(); i++) {
+      if (initIndices[i] == NA_INTEGER || initIndices[i] < 1) {
+        stop("init_medoids must be positive indices");
+      }
+      medoidIndices(i) = initIndices[i] - 1;
+    }
+    init = medoidIndices;
+  }
+
   if (distMat != R_NilValue) {
     arma_mat mat = Rcpp::as<arma_mat>(distMat);
     std::reference_wrapper<const arma::mat> matRef(mat);
-    ptr->fit(data, loss[0], matRef);
+    ptr->fit(data, loss[0], matRef, init);
   } else {
-    ptr->fit(data, loss[0], std::nullopt);
+    ptr->fit(data, loss[0], std::nullopt, init);
+  }
+
+}
+
+//// Assign points to the closest of the final medoids
+////
+//// @param xp the km::KMedoids Object XPtr
+//// @param data the points to assign, one per row
+//// @param returnDistances whether to also return the distance to the closest medoid
+// [[Rcpp::export(.KMedoids__predict)]]
+SEXP KMedoids__predict(SEXP xp, arma::mat data, LogicalVector returnDistances) {
+  // grab the object as a XPtr (smart pointer)
+  XPtr<km::KMedoids> ptr(xp);
+
+  arma_rowvec distances;
+  bool withDistances = returnDistances.size() == 1 && returnDistances[0] == true;
+  arma::urowvec labels = ptr->predict(data, withDistances ? &distances : nullptr);
+  // Turn 0-based indices into 1-based indices for R
+  IntegerVector result(labels.n_elem);
+  for (arma::uword i = 0; i < labels.n_elem; i++) {
+    result[i] = labels(i) + 1;
+  }
+  if (!withDistances) {
+    return result;
   }
+  return List::create(Named("labels") = result,
+                      Named("distances") = NumericVector(distances.begin(), distances.end()));
+}
 
+//// Save the model in the binary format shared with the Python package
+////
+//// @param xp the km::KMedoids Object XPtr
+//// @param path the path of the file to write
+//// @param includeMedoids whether to embed the coordinates of the medoids
+// [[Rcpp::export(.KMedoids__save)]]
+void KMedoids__save(SEXP xp, std::string path, LogicalVector includeMedoids) {
+  // grab the object as a XPtr (smart pointer)
+  XPtr<km::KMedoids> ptr(xp);
+  try {
+    ptr->saveModel(path, includeMedoids.size() == 1 && includeMedoids[0] == true);
+  } catch (std::invalid_argument& e) {
+    stop(e.what());
+  }
+}
+
+//// Load a model saved by save, returning its algorithm
+////
+//// @param xp the km::KMedoids Object XPtr
+//// @param path the path of the file to read
+// [[Rcpp::export(.KMedoids__load)]]
+SEXP KMedoids__load(SEXP xp, std::string path) {
+  // grab the object as a XPtr (smart pointer)
+  XPtr<km::KMedoids> ptr(xp);
+  try {
+    ptr->loadModel(path);
+  } catch (std::invalid_argument& e) {
+    stop(e.what());
+  }
+  return wrap(ptr->getAlgorithm());
 }
 
 //// Return the final medoids
@@ -9,6 +9,7 @@
 #include <regex>
 
 #include "kmedoids_algorithm.hpp"
+#include "model_file.hpp"
 #include "fastpam1.hpp"
 #include "pam.hpp"
 #include "banditpam.hpp"
@@ -51,7 +52,8 @@ KMedoids::~KMedoids() {}
 void KMedoids::fit(
   const arma_mat& inputData,
   const std::string& loss,
-  std::optional<std::reference_wrapper<const arma_mat>> distMat) {
+  std::optional<std::reference_wrapper<const arma_mat>> distMat,
+  std::optional<arma::urowvec> initMedoids) {
   numMiscDistanceComputations = 0;
   numBuildDistanceComputations = 0;
   numSwapDistanceComputations = 0;
@@ -75,19 +77,27 @@ void KMedoids::fit(
     // TODO(@motiwari): Change this to an assertion that is properly raised
     throw std::invalid_argument("Dataset is empty");
   }
+  if (initMedoids) {
+    KMedoids::checkInitMedoids(initMedoids.value(), inputData.n_rows);
+  }
   batchSize = fmin(inputData.n_rows, batchSize);
 
   try {
     KMedoids::setLossFn(loss);
     if (algorithm == "PAM") {
-      static_cast<PAM*>(this)->fitPAM(inputData, distMat);
+      static_cast<PAM*>(this)->fitPAM(inputData, distMat, initMedoids);
     } else if (algorithm == "BanditPAM") {
-      static_cast<BanditPAM*>(this)->fitBanditPAM(inputData, distMat);
+      static_cast<BanditPAM*>(this)->fitBanditPAM(inputData, distMat, initMedoids);
     } else if (algorithm == "BanditPAM_orig") {
+      if (initMedoids) {
+        throw std::invalid_argument(
+          "Initial medoids are not supported by BanditPAM_orig");
+      }
       static_cast<BanditPAM_orig*>(this)->fitBanditPAM_orig(inputData, distMat);
     } else if (algorithm == "FastPAM1") {
-      static_cast<FastPAM1*>(this)->fitFastPAM1(inputData, distMat);
+      static_cast<FastPAM1*>(this)->fitFastPAM1(inputData, distMat, initMedoids);
     }
+    medoidCoordinates = data.cols(medoidIndicesFinal);
   } catch (std::invalid_argument& e) {
 #ifdef R_INTERFACE
     Rcpp::Rcout << e.what() << std::endl;
@@ -100,6 +110,159 @@ void KMedoids::fit(
   }
 }
 
+arma::urowvec KMedoids::predict(
+  const arma_mat& inputData,
+  arma_rowvec* distances) const {
+  if (medoidCoordinates.n_cols == 0) {
+    throw std::invalid_argument("Error: predict requires a previous call to fit");
+  }
+  if (inputData.n_cols != medoidCoordinates.n_rows) {
+    throw std::invalid_argument(
+      "Error: points must have the same number of features as the data that was fit");
+  }
+
+  const size_t N = inputData.n_rows;
+  const size_t K = medoidCoordinates.n_cols;
+  arma::urowvec predictedLabels(N);
+  if (distances != nullptr) {
+    distances->set_size(N);
+  }
+
+  // For L2 and cosine, the inner products of a block of queries with all
+  // medoids come from one matrix product with the d x k medoid matrix
+  const bool useL2 = (lossFn == &KMedoids::LP) && (lp == 2);
+  const bool useCosine = (lossFn == &KMedoids::cos);
+  arma_vec medoidSquaredNorms;
+  if (useL2 || useCosine) {
+    medoidSquaredNorms = arma::trans(arma::sum(arma::square(medoidCoordinates), 0));
+  }
+
+  const size_t numBlocks = (N + predictBatchSize - 1) / predictBatchSize;
+#pragma omp parallel for if (this->parallelize)
+  for (size_t b = 0; b < numBlocks; b++) {
+    const size_t first = b * predictBatchSize;
+    const size_t last = std::min(N, first + predictBatchSize) - 1;
+    // Query points of this block, one per column like the medoids
+    const arma_mat queries = arma::trans(inputData.rows(first, last));
+    const size_t B = queries.n_cols;
+
+    // k x B distances, so that each query's distances are contiguous
+    arma_mat blockDistances;
+    if (useL2) {
+      // ||q - m||^2 = ||q||^2 - 2 q.m + ||m||^2; the square root is only
+      // taken for the returned distances
+      blockDistances = -2 * (medoidCoordinates.t() * queries);
+      blockDistances.each_col() += medoidSquaredNorms;
+      blockDistances.each_row() += arma::sum(arma::square(queries), 0);
+    } else if (useCosine) {
+      blockDistances = medoidCoordinates.t() * queries;
+      blockDistances.each_col() /= arma::sqrt(medoidSquaredNorms);
+      blockDistances.each_row() /= arma::sqrt(arma::sum(arma::square(queries), 0));
+      blockDistances = 1 - blockDistances;
+    } else {
+      blockDistances.set_size(K, B);
+      for (size_t q = 0; q < B; q++) {
+        for (size_t k = 0; k < K; k++) {
+          blockDistances(k, q) = queryLoss(queries, q, k);
+        }
+      }
+    }
+
+    for (size_t q = 0; q < B; q++) {
+      const arma::uword k = blockDistances.col(q).index_min();
+      predictedLabels(first + q) = k;
+      if (distances != nullptr) {
+        // Recomputed directly to avoid the cancellation of the expansion
+        (*distances)(first + q) = useL2 ? queryLoss(queries, q, k) : blockDistances(k, q);
+      }
+    }
+  }
+  return predictedLabels;
+}
+
+banditpam_float KMedoids::queryLoss(
+  const arma_mat& queries,
+  const size_t q,
+  const size_t k) const {
+  if (lossFn == &KMedoids::manhattan) {
+    return arma::accu(arma::abs(queries.col(q) - medoidCoordinates.col(k)));
+  } else if (lossFn == &KMedoids::LINF) {
+    return arma::max(arma::abs(queries.col(q) - medoidCoordinates.col(k)));
+  } else if (lossFn == &KMedoids::cos) {
+    return 1 - (arma::dot(queries.col(q), medoidCoordinates.col(k))
+      / (arma::norm(queries.col(q)) * arma::norm(medoidCoordinates.col(k))));
+  }
+  return arma::norm(queries.col(q) - medoidCoordinates.col(k), lp);
+}
+
+void KMedoids::saveModel(
+  const std::string& path,
+  bool includeCoordinates) const {
+  ModelFile model;
+  model.nMedoids = nMedoids;
+  model.algorithm = algorithm;
+  model.buildMethod = "bandit";
+  // The loss function is only set by a fit
+  if (medoidIndicesFinal.n_elem > 0) {
+    model.loss = getLossFn();
+  }
+  model.maxIter = maxIter;
+  model.maxSwapsPerIter = 1;
+  model.nInit = 1;
+  model.buildConfidence = buildConfidence;
+  model.swapConfidence = swapConfidence;
+  model.seed = seed;
+  model.cacheWidth = cacheWidth;
+  model.useCache = useCache;
+  model.usePerm = usePerm;
+  model.parallelize = parallelize;
+
+  model.buildMedoids = medoidIndicesBuild;
+  model.medoids = medoidIndicesFinal;
+  model.labels = labels;
+  model.averageLoss = averageLoss;
+  model.steps = steps;
+  if (includeCoordinates) {
+    model.medoidCoordinates = arma::conv_to<arma::fmat>::from(medoidCoordinates);
+  }
+  model.write(path);
+}
+
+void KMedoids::loadModel(const std::string& path) {
+  ModelFile model;
+  model.read(path);
+  if (model.nMedoids == 0 ||
+      (model.medoids.n_elem != 0 && model.medoids.n_elem != model.nMedoids) ||
+      (model.labels.n_elem != 0 && model.labels.max() >= model.medoids.n_elem)) {
+    throw std::invalid_argument("Error: the model is inconsistent");
+  }
+  KMedoids::checkAlgorithm(model.algorithm);
+  if (!model.loss.empty()) {
+    // getLossFn names the L-infinity loss differently than setLossFn
+    KMedoids::setLossFn(model.loss == "L-infinity" ? "inf" : model.loss);
+  }
+
+  nMedoids = model.nMedoids;
+  algorithm = model.algorithm;
+  maxIter = model.maxIter;
+  buildConfidence = model.buildConfidence;
+  swapConfidence = model.swapConfidence;
+  seed = model.seed;
+  cacheWidth = model.cacheWidth;
+  useCache = model.useCache;
+  usePerm = model.usePerm;
+  parallelize = model.parallelize;
+
+  // The training data is not part of the model
+  data.reset();
+  medoidIndicesBuild = model.buildMedoids;
+  medoidIndicesFinal = model.medoids;
+  labels = model.labels;
+  averageLoss = model.averageLoss;
+  steps = model.steps;
+  medoidCoordinates = arma::conv_to<arma_mat>::from(model.medoidCoordinates);
+}
+
 arma::urowvec KMedoids::getMedoidsBuild() const {
   return medoidIndicesBuild;
 }
@@ -418,6 +581,22 @@ void KMedoids::checkAlgorithm(const std::string& algorithm) const {
   }
 }
 
+void KMedoids::checkInitMedoids(
+  const arma::urowvec& initMedoids,
+  size_t n) const {
+  if (initMedoids.n_elem != nMedoids) {
+    throw std::invalid_argument(
+      "Number of initial medoids must equal the number of medoids");
+  }
+  if (arma::any(initMedoids >= n)) {
+    throw std::invalid_argument(
+      "Initial medoid index is out of range of the dataset");
+  }
+  if (arma::unique(initMedoids).eval().n_elem != initMedoids.n_elem) {
+    throw std::invalid_argument("Initial medoids must be distinct");
+  }
+}
+
 banditpam_float KMedoids::getAverageLoss() const {
   return averageLoss;
 }
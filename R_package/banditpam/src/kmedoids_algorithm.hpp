@@ -46,13 +46,61 @@ class KMedoids {
    *
    * @param inputData Input data to cluster
    * @param loss The loss function used during medoid computation
+   * @param distMat Optional precomputed distance matrix
+   * @param initMedoids Optional indices of the medoids to start SWAP from.
+   * If given, the BUILD step is skipped (warm start)
    * 
-   * @throws if the input data is empty.
+   * @throws if the input data is empty or the initial medoids are invalid.
    */
   void fit(
     const arma_mat& inputData,
     const std::string& loss,
-    std::optional<std::reference_wrapper<const arma_mat>> distMat);
+    std::optional<std::reference_wrapper<const arma_mat>> distMat,
+    std::optional<arma::urowvec> initMedoids = std::nullopt);
+
+  /**
+   * @brief Assigns points to the closest of the final medoids.
+   *
+   * Query points are processed in blocks of predictBatchSize, in parallel.
+   * For the L2 and cosine losses the distances of a block to all medoids
+   * come from a single matrix product with the medoid matrix; the other
+   * losses are computed point by point.
+   *
+   * @param inputData Datapoints to assign, one per row
+   * @param distances If not null, the distance from each point to its
+   * closest medoid, written in place
+   *
+   * @returns The index of the closest medoid of each point
+   *
+   * @throws If the model has not been fit or the points have a different
+   * dimension than the data that was fit
+   */
+  arma::urowvec predict(
+    const arma_mat& inputData,
+    arma_rowvec* distances = nullptr) const;
+
+  /**
+   * @brief Saves the hyperparameters and the fitted state of the model in
+   * the versioned binary format shared with the Python package.
+   *
+   * @param path Path of the file to write
+   * @param includeCoordinates Whether to embed the coordinates of the final
+   * medoids, which predict needs after the model is loaded
+   *
+   * @throws If the file cannot be written
+   */
+  void saveModel(const std::string& path, bool includeCoordinates = true) const;
+
+  /**
+   * @brief Loads a model saved by saveModel, replacing the hyperparameters
+   * and the fitted state of this one. Settings that this package does not
+   * have are ignored.
+   *
+   * @param path Path of the file to read
+   *
+   * @throws If the file cannot be read or is not a model
+   */
+  void loadModel(const std::string& path);
 
   /**
    * @brief Returns the medoids at the end of the BUILD step.
@@ -384,6 +432,20 @@ class KMedoids {
    * 
    * @returns The distance between points i and j
    */
+  /**
+   * @brief Computes the loss between a query point and a final medoid.
+   *
+   * @param queries Query points, one per column
+   * @param q Index of the query point in queries
+   * @param k Index of the medoid
+   *
+   * @returns The loss between the query point and the medoid
+   */
+  banditpam_float queryLoss(
+    const arma_mat& queries,
+    const size_t q,
+    const size_t k) const;
+
   banditpam_float cachedLoss(
     const arma_mat& data,
     std::optional<std::reference_wrapper<const arma_mat>> distMat,
@@ -462,6 +524,17 @@ class KMedoids {
    */
   void checkAlgorithm(const std::string& algorithm) const;
 
+  /**
+   * @brief Checks whether user-supplied initial medoids are valid: there
+   * must be exactly nMedoids distinct indices, all within the dataset.
+   *
+   * @param initMedoids Indices of the initial medoids
+   * @param n Number of datapoints in the dataset
+   *
+   * @throws If the initial medoids are invalid.
+   */
+  void checkInitMedoids(const arma::urowvec& initMedoids, size_t n) const;
+
   /// Number of medoids to use -- the "k" in k-medoids
   size_t nMedoids;
 
@@ -483,6 +556,12 @@ class KMedoids {
   /// Indices of the medoids after clustering
   arma::urowvec medoidIndicesFinal;
 
+  /// Coordinates of the final medoids, one per column, used by predict
+  arma_mat medoidCoordinates;
+
+  /// Number of query points predict assigns at a time
+  size_t predictBatchSize = 1024;
+
   /// Function pointer to the loss function to use
   banditpam_float (KMedoids::*lossFn)(
     const arma_mat& data,
@@ -0,0 +1,148 @@
+#ifndef HEADERS_ALGORITHMS_MODEL_FILE_HPP_
+#define HEADERS_ALGORITHMS_MODEL_FILE_HPP_
+
+#include <banditpam_common.h>
+#include <cstdint>
+#include <string>
+
+namespace km {
+/**
+ * @brief Hyperparameters and fitted state of a KMedoids model in its
+ * versioned binary format.
+ *
+ * The format starts with the magic string "BPAMMODL" and the format
+ * version, followed by the fields below in order as little-endian integers,
+ * floats and length-prefixed strings and arrays. The medoid coordinates are
+ * optional; without them a loaded model reports its medoids and labels but
+ * cannot predict.
+ */
+struct ModelFile {
+  /**
+   * @brief Returns the model in the binary format.
+   *
+   * @returns The bytes of the model
+   */
+  std::string serialize() const;
+
+  /**
+   * @brief Reads a model in the binary format.
+   *
+   * @param bytes Start of the model
+   * @param size Number of bytes of the model
+   *
+   * @throws If the bytes are not a model or were written by a newer version
+   */
+  void deserialize(const char *bytes, size_t size);
+
+  /**
+   * @brief Writes the model to a file.
+   *
+   * @param path Path of the file
+   *
+   * @throws If the file cannot be written
+   */
+  void write(const std::string &path) const;
+
+  /**
+   * @brief Reads a model from a file, which is memory-mapped rather than
+   * read through a stream.
+   *
+   * @param path Path of the file
+   *
+   * @throws If the file cannot be read or is not a model
+   */
+  void read(const std::string &path);
+
+  /// Version of the format written by serialize
+  static constexpr uint32_t version = 2;
+
+  /// Number of medoids
+  uint64_t nMedoids = 0;
+
+  /// Name of the algorithm
+  std::string algorithm;
+
+  /// Name of the BUILD method
+  std::string buildMethod;
+
+  /// Name of the loss function
+  std::string loss;
+
+  /// Maximum number of SWAP iterations
+  uint64_t maxIter = 0;
+
+  /// Maximum number of swaps per SWAP iteration
+  uint64_t maxSwapsPerIter = 0;
+
+  /// Number of restarts
+  uint64_t nInit = 0;
+
+  /// Confidence of BUILD
+  uint64_t buildConfidence = 0;
+
+  /// Confidence of SWAP
+  uint64_t swapConfidence = 0;
+
+  /// Random seed
+  uint64_t seed = 0;
+
+  /// Width of the distance cache
+  uint64_t cacheWidth = 0;
+
+  /// Whether the distance cache is used
+  uint8_t useCache = 0;
+
+  /// Whether a fixed permutation of reference points is used
+  uint8_t usePerm = 0;
+
+  /// Whether the fit is parallelized
+  uint8_t parallelize = 0;
+
+  /// Whether SWAP arm statistics are carried across iterations
+  uint8_t reuseArmStats = 0;
+
+  /// Whether sigma is estimated from the sampling rounds
+  uint8_t onlineSigma = 0;
+
+  /// Whether assignments use a metric tree over the medoids
+  uint8_t useMedoidTree = 0;
+
+  /// Tolerance within which arms are considered tied
+  float tolerance = 0;
+
+  /// Whether the tolerance is relative
+  uint8_t relativeTolerance = 0;
+
+  /// Time budget of each fit in seconds
+  float timeBudget = 0;
+
+  /// Distance budget of each fit
+  uint64_t distanceBudget = 0;
+
+  /// Whether duplicate points are collapsed before fitting, since version 2
+  uint8_t collapseDuplicates = 0;
+
+  /// Medoids found by BUILD
+  arma::urowvec buildMedoids;
+
+  /// Final medoids
+  arma::urowvec medoids;
+
+  /// Index of the closest medoid of each point of the fit
+  arma::urowvec labels;
+
+  /// Average loss of the final medoids
+  float averageLoss = 0;
+
+  /// Average loss of the medoids found by BUILD
+  float buildLoss = 0;
+
+  /// Number of SWAP iterations performed
+  uint64_t steps = 0;
+
+  /// Coordinates of the final medoids, one per column, or empty if they are
+  /// not embedded
+  arma::fmat medoidCoordinates;
+};
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_MODEL_FILE_HPP_
@@ -15,10 +15,15 @@
 namespace km {
 void PAM::fitPAM(
   const arma_mat& inputData,
-  std::optional<std::reference_wrapper<const arma_mat>> distMat) {
+  std::optional<std::reference_wrapper<const arma_mat>> distMat,
+  std::optional<arma::urowvec> initMedoids) {
   data = arma::trans(inputData);
   arma::urowvec medoidIndices(nMedoids);
-  PAM::buildPAM(data, distMat, &medoidIndices);
+  if (initMedoids) {
+    medoidIndices = initMedoids.value();
+  } else {
+    PAM::buildPAM(data, distMat, &medoidIndices);
+  }
   steps = 0;
   medoidIndicesBuild = medoidIndices;
   arma::urowvec assignments(data.n_cols);
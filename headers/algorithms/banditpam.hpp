@@ -3,6 +3,7 @@
 
 #include <omp.h>
 #include <armadillo>
+#include <memory>
 #include <vector>
 #include <fstream>
 #include <iostream>
@@ -17,13 +18,190 @@ namespace km {
 class BanditPAM : public km::KMedoids {
  public:
   /**
-   * @brief Runs BanditPAM to identify a dataset's medoids.
+   * @brief Runs BanditPAM to identify the medoids of the transposed data
+   * held in data.
    *
-   * @param inputData Input data to cluster
+   * Runs nInit restarts concurrently over the same data and distance
+   * cache, each with its own medoids, arm statistics, random stream and
+   * order of reference points, and keeps the medoids of the restart with
+   * the lowest average loss.
+   *
+   * @param initMedoids Optional medoids to start SWAP from, skipping BUILD
    */
   void fitBanditPAM(
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids = std::nullopt);
+
+  /**
+   * @brief Runs a single restart of BanditPAM on the transposed data held
+   * in data, setting the medoids, the labels and the BUILD loss.
+   *
+   * @param initMedoids Optional medoids to start SWAP from, skipping BUILD
+   */
+  void fitOnce(
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids);
+
+  /**
+   * @brief Creates the model that runs one of the nInit restarts of the
+   * fit, with the settings of this model and a share of its distance
+   * budget.
+   *
+   * The restart shares the data, the distance matrix and the distance cache
+   * of this model, which must outlive it. The first restart continues the
+   * random stream of this model, so that it draws what a single fit would;
+   * every other restart seeds its own stream from the seed and its number
+   * and reorders its reference points.
+   *
+   * @param restart Number of the restart
+   *
+   * @returns The model of the restart
+   */
+  std::unique_ptr<BanditPAM> makeRestart(size_t restart);
+
+  /**
+   * @brief Runs BanditPAM on the transposed data held in data for several
+   * numbers of medoids, sharing a single BUILD up to the largest k.
+   *
+   * @param ks Numbers of medoids to fit, in the order they are run
+   */
+  void fitKRangeBanditPAM(const arma::urowvec &ks);
+
+  /**
+   * @brief Allocates the distance cache, draws the permutation of reference
+   * points, and sizes the workspace for nMedoids medoids.
+   */
+  void initializeFit();
+
+  /**
+   * @brief Writes a checkpoint of the fit to checkpointPath, if the fit
+   * writes checkpoints.
+   *
+   * @param medoidIndices Current medoids
+   */
+  void saveCheckpoint(const arma::urowvec &medoidIndices);
+
+  /**
+   * @brief Restores the state of the fit from the checkpoint at resumePath.
+   *
+   * Sets the medoids of BUILD, the BUILD loss, the number of SWAP
+   * iterations, the permutation, the random state and the cache if it was
+   * saved with matching dimensions.
+   *
+   * @param medoidIndices Current medoids, set from the checkpoint
+   * @param medoids Medoid coordinates, set from the checkpoint
+   *
+   * @throws If the checkpoint cannot be read or was written for other data,
+   * another loss or another number of medoids
+   */
+  void restoreCheckpoint(arma::urowvec *medoidIndices, arma::fmat *medoids);
+
+  /**
+   * @brief Reorders the permutation of reference points for a restart,
+   * keeping the points of the cached prefix in the prefix.
+   */
+  void shufflePermutation();
+
+  /**
+   * @brief Returns whether the smallest upper confidence bound is within
+   * the tolerance of the lower confidence bound of every remaining arm, in
+   * which case the round may end early.
+   *
+   * When the round ends this way, the caller picks the arm with the
+   * smallest upper confidence bound, ucbs.index_min(), rather than the
+   * smallest lower bound. That arm is the one whose loss is bounded best,
+   * and none of the remaining arms can beat it by more than the tolerance.
+   * Equal bounds go to the arm with the lowest index.
+   *
+   * @param lcbs Lower confidence bound of each arm
+   * @param candidates Arms that may still be the best
+   * @param minUcb Smallest upper confidence bound
+   *
+   * @returns true if the round may end and false otherwise
+   */
+  bool withinTolerance(
+          const arma::fmat &lcbs,
+          const arma::umat &candidates,
+          const float minUcb) const;
+
+  /**
+   * @brief Reports the progress of BUILD after a medoid is chosen and, if
+   * a sweep over k was cancelled, drops the medoids not yet chosen.
+   *
+   * A single fit is never truncated, since its model must have nMedoids
+   * medoids; its BUILD seeds the remaining medoids once cancelled.
+   *
+   * @param k Index of the medoid just chosen
+   * @param bestDistances Distance from each point to its closest medoid
+   * @param medoidIndices Indices of the medoids, truncated in place
+   * @param medoids Medoid coordinates, truncated in place
+   * @param prefixLosses Losses of each prefix of the medoids for a sweep,
+   * truncated in place, or nullptr for a single fit
+   *
+   * @returns true if BUILD must stop and false otherwise
+   */
+  bool finishBuildStep(
+          const size_t k,
+          const arma::frowvec &bestDistances,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids,
+          arma::frowvec *prefixLosses);
+
+  /**
+   * @brief Appends points to a model fitted by BanditPAM and runs a bounded
+   * SWAP over the new points.
+   *
+   * @param inputData New datapoints, one per row
+   * @param maxSwapIter Maximum number of SWAP iterations to run
+   */
+  void partialFitBanditPAM(
           const arma::fmat &inputData,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat);
+          const size_t maxSwapIter);
+
+  /**
+   * @brief Grows the distance cache to hold rows for N points.
+   *
+   * The capacity is at least doubled when it is exceeded, so that appending
+   * points copies the existing rows only a logarithmic number of times.
+   *
+   * @param oldN Number of points whose rows are already in the cache
+   * @param N New number of points
+   */
+  void growCache(const size_t oldN, const size_t N);
+
+  /**
+   * @brief Extends the permutation of reference points to N points.
+   *
+   * Each new point is inserted at a uniformly random position (the
+   * "inside-out" Fisher-Yates shuffle), so the permutation remains uniformly
+   * random. A point moved out of the cached prefix hands its cache column
+   * over to the new point, and the column is cleared.
+   *
+   * @param oldN Number of points already in the permutation
+   * @param N New number of points
+   */
+  void extendPermutation(const size_t oldN, const size_t N);
+
+  /**
+   * @brief Draws the next batch of reference points.
+   *
+   * When using the fixed permutation, the returned vector is a non-owning
+   * view into the permutation; otherwise the points are sampled into the
+   * workspace. In both cases no copy of the reference points is made. After
+   * duplicates were collapsed, sampled batches are drawn from the original
+   * rows, so that each point is drawn in proportion to its weight.
+   *
+   * @param N Number of datapoints
+   * @param tmpBatchSize Number of reference points to draw
+   * @param exact Whether the batch covers every point once, in which case
+   * the caller weighs each point itself
+   *
+   * @returns Non-owning view of the reference points
+   */
+  arma::uvec drawReferencePoints(
+          const size_t N,
+          const size_t tmpBatchSize,
+          const bool exact = false);
 
   /**
    * @brief Empirical estimation of standard deviation of arm returns
@@ -33,14 +211,14 @@ class BanditPAM : public km::KMedoids {
    * @param bestDistances Contains best distances from each point to medoids
    * @param useAbsolute Flag to use the absolute distance to each arm instead
    * of improvement over prior loss; necessary for the first BUILD step
-   *
-   * @returns Estimate of each arm's standard deviation
+   * @param sigma Estimate of each arm's standard deviation, written in place
    */
-  arma::frowvec buildSigma(
+  void buildSigma(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::frowvec &bestDistances,
-          const bool useAbsolute);
+          const bool useAbsolute,
+          arma::frowvec *sigma);
 
   /**
    * @brief Estimates the mean reward for each arm in the BUILD steps.
@@ -51,16 +229,19 @@ class BanditPAM : public km::KMedoids {
    * @param useAbsolute Flag to use the absolute distance to each arm instead
    * of improvement over prior loss; necessary for the first BUILD step
    * @param exact false if using standard batch size; true otherwise
-   *
-   * @returns Estimate of each arm's change in loss
+   * @param results Estimate of each target's change in loss, written in place
+   * @param sumSquares If not null, the sum of each target's squared returns
+   * over the batch, written in place
    */
-  arma::frowvec buildTarget(
+  void buildTarget(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::uvec *target,
           const arma::frowvec *bestDistances,
           const bool useAbsolute,
-          const bool exact);
+          const bool exact,
+          arma::frowvec *results,
+          arma::rowvec *sumSquares = nullptr);
 
   /**
    * @brief Performs the BUILD step of BanditPAM.
@@ -75,13 +256,122 @@ class BanditPAM : public km::KMedoids {
    * @param medoidIndices Array of medoids that is modified in place
    * as medoids are identified
    * @param medoids Matrix that contains the coordinates of each medoid
+   * @param prefixLosses If not null, the loss of the first k + 1 medoids is
+   * written to entry k as they are identified
    */
   void build(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids,
+          arma::frowvec *prefixLosses = nullptr);
+
+  /**
+   * @brief Linear approximate BUILD (LAB) initialization.
+   *
+   * Adds medoids greedily as in BUILD, but each medoid is chosen among a
+   * subsample of 10 + sqrt(n) non-medoids, evaluated only on that same
+   * subsample. This follows Schubert and Rousseeuw, "Fast and eager
+   * k-medoids clustering: O(k) runtime improvement of the PAM, CLARA, and
+   * CLARANS algorithms" (2021), and costs O(k n) distance computations.
+   *
+   * @param data Transposed input data to cluster
+   * @param medoidIndices Array of medoids that is modified in place
+   * as medoids are identified
+   * @param medoids Matrix that contains the coordinates of each medoid
+   */
+  void buildLAB(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           arma::urowvec *medoidIndices,
           arma::fmat *medoids);
 
+  /**
+   * @brief k-medoids++ seeding initialization.
+   *
+   * Chooses the first medoid uniformly at random and each subsequent medoid
+   * with probability proportional to its distance from the closest medoid
+   * chosen so far.
+   *
+   * @param data Transposed input data to cluster
+   * @param medoidIndices Array of medoids that is modified in place
+   * as medoids are identified
+   * @param medoids Matrix that contains the coordinates of each medoid
+   */
+  void buildKMedoidsPlusPlus(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids);
+
+  /**
+   * @brief Chooses the medoids from the given one onwards as in k-medoids++
+   * seeding, at one distance per point and medoid. Used by every BUILD
+   * once the budget of the fit is used up.
+   *
+   * @param data Transposed input data to cluster
+   * @param first Index of the first medoid to choose
+   * @param bestDistances Distance from each point to its closest medoid,
+   * updated in place
+   * @param isMedoid Whether each point is a medoid, updated in place
+   * @param medoidIndices Array of medoids that is modified in place
+   * as medoids are identified
+   * @param medoids Matrix that contains the coordinates of each medoid
+   * @param prefixLosses If not null, the loss of the first k + 1 medoids is
+   * written at index k
+   */
+  void seedMedoids(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const size_t first,
+          arma::frowvec *bestDistances,
+          arma::urowvec *isMedoid,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids,
+          arma::frowvec *prefixLosses = nullptr);
+
+  /**
+   * @brief Merges a batch of samples into an arm's running variance.
+   *
+   * @param count Number of samples drawn before the batch
+   * @param mean Mean of the samples drawn before the batch
+   * @param batchCount Number of samples in the batch
+   * @param batchMean Mean of the samples in the batch
+   * @param batchSumSquares Sum of the squared samples in the batch
+   * @param m2 Sum of squared deviations from the mean, updated in place
+   *
+   * @returns The sample standard deviation of all samples
+   */
+  float mergeVariance(
+          const double count,
+          const double mean,
+          const double batchCount,
+          const double batchMean,
+          const double batchSumSquares,
+          double *m2);
+
+  /**
+   * @brief Adds the squared returns of one reference point to every arm of
+   * a candidate.
+   *
+   * @param cost Distance between the candidate and the reference point
+   * @param bestDistance Distance from the reference point to its medoid
+   * @param secondBestDistance Distance from the reference point to its
+   * second closest medoid
+   * @param assignment Medoid the reference point is assigned to
+   * @param col Column of sumSquares that holds the candidate's arms
+   * @param sign 1 to add the squared returns, -1 to remove them
+   * @param sumSquares Sums of squared returns, updated in place
+   */
+  void addSquaredReturns(
+          const float cost,
+          const float bestDistance,
+          const float secondBestDistance,
+          const size_t assignment,
+          const size_t col,
+          const double sign,
+          arma::mat *sumSquares);
+
   /**
    * @brief Empirical estimation of standard deviation of arm returns
    * in the SWAP step.
@@ -90,15 +380,17 @@ class BanditPAM : public km::KMedoids {
    * @param bestDistances Contains best distances from each point to medoids
    * @param secondBestDistances Contains second best distances from each point to medoids
    * @param assignments Assignments of datapoints to their closest medoid
-   *
-   * @returns Estimate of each arm's standard deviation
+   * @param sigma Estimate of each arm's standard deviation, written in place
+   * @param firstCandidate Index of the first point whose arms are estimated
    */
-  arma::fmat swapSigma(
+  void swapSigma(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::frowvec *bestDistances,
           const arma::frowvec *secondBestDistances,
-          const arma::urowvec *assignments);
+          const arma::urowvec *assignments,
+          arma::fmat *sigma,
+          const size_t firstCandidate = 0);
 
   /**
    * @brief Estimates the mean reward for each arm in SWAP step.
@@ -111,10 +403,12 @@ class BanditPAM : public km::KMedoids {
    * @param secondBestDistances Contains second best distances from each point to medoids
    * @param assignments Assignments of datapoints to their closest medoid
    * @param exact false if using standard batch size; true otherwise
-   *
-   * @returns Estimate of each arm's change in loss
+   * @param results k x T estimates of each arm's change in loss, written
+   * in place
+   * @param sumSquares If not null, the k x T sums of each arm's squared
+   * returns over the batch, written in place
    */
-  arma::fmat swapTarget(
+  void swapTarget(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::urowvec *medoidIndices,
@@ -122,7 +416,179 @@ class BanditPAM : public km::KMedoids {
           const arma::frowvec *bestDistances,
           const arma::frowvec *secondBestDistances,
           const arma::urowvec *assignments,
-          const bool exact);
+          const bool exact,
+          arma::fmat *results,
+          arma::mat *sumSquares = nullptr);
+
+  /**
+   * @brief Extends the sampled prefix of each target's arms by a batch.
+   *
+   * Unlike swapTarget, which evaluates every target on the same batch of
+   * reference points, each target continues from where its own prefix of
+   * the permutation ends, so that statistics gathered in earlier SWAP
+   * iterations can be reused.
+   *
+   * @param data Transposed input data to cluster
+   * @param targets Candidate datapoints to evaluate
+   * @param armSamples Length of each candidate's prefix of the permutation
+   * @param bestDistances Contains best distances from each point to medoids
+   * @param secondBestDistances Contains second best distances from each point to medoids
+   * @param assignments Assignments of datapoints to their closest medoid
+   * @param results Sums of the k x T arm returns over the new reference
+   * points, written in place
+   * @param sumSquares If not null, sums of the k x T squared arm returns
+   * over the new reference points, written in place
+   */
+  void swapTargetWindow(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::uvec *targets,
+          const arma::uvec *armSamples,
+          const arma::frowvec *bestDistances,
+          const arma::frowvec *secondBestDistances,
+          const arma::urowvec *assignments,
+          arma::fmat *results,
+          arma::mat *sumSquares);
+
+  /**
+   * @brief Brings the carried arm statistics up to date after a swap.
+   *
+   * For every reference point whose best distance, second best distance or
+   * assignment changed since the statistics were gathered, and that lies in
+   * an arm's sampled prefix, the old return is replaced by the current one.
+   *
+   * @param data Transposed input data to cluster
+   * @param bestDistances Contains best distances from each point to medoids
+   * @param secondBestDistances Contains second best distances from each point to medoids
+   * @param assignments Assignments of datapoints to their closest medoid
+   * @param armSamples Length of each candidate's prefix of the permutation
+   * @param statsBestDistances Best distances the statistics were gathered
+   * with, updated in place
+   * @param statsSecondBestDistances Second best distances the statistics
+   * were gathered with, updated in place
+   * @param statsAssignments Assignments the statistics were gathered with,
+   * updated in place
+   * @param armSums Sums of the arm returns over each prefix, updated in place
+   * @param armSumSquares Sums of the squared arm returns over each prefix,
+   * updated in place
+   */
+  void swapCorrectArmStats(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::frowvec *bestDistances,
+          const arma::frowvec *secondBestDistances,
+          const arma::urowvec *assignments,
+          const arma::uvec *armSamples,
+          arma::frowvec *statsBestDistances,
+          arma::frowvec *statsSecondBestDistances,
+          arma::urowvec *statsAssignments,
+          arma::mat *armSums,
+          arma::mat *armSumSquares);
+
+  /**
+   * @brief Computes the estimates and confidence bounds of one candidate's
+   * arms from their carried statistics.
+   *
+   * @param n Index of the candidate
+   * @param N Number of datapoints
+   * @param adjust Log of the inverse error rate used for the bounds
+   * @param sigma Estimate of each arm's standard deviation, recomputed from
+   * armSumSquares
+   * @param armSums Sums of the arm returns over each prefix
+   * @param armSumSquares Sums of the squared arm returns over each prefix
+   * @param armSamples Length of each candidate's prefix of the permutation
+   * @param exactMask Whether each arm has been computed exactly
+   * @param estimates Estimated return of each arm
+   * @param lcbs Lower confidence bound of each arm
+   * @param ucbs Upper confidence bound of each arm
+   */
+  void swapArmBounds(
+          const size_t n,
+          const size_t N,
+          const float adjust,
+          arma::fmat *sigma,
+          const arma::mat *armSums,
+          const arma::mat *armSumSquares,
+          const arma::uvec *armSamples,
+          arma::umat *exactMask,
+          arma::fmat *estimates,
+          arma::fmat *lcbs,
+          arma::fmat *ucbs);
+
+  /**
+   * @brief Identifies the best swap of a SWAP iteration, starting from the
+   * arm statistics carried over from the previous iterations.
+   *
+   * @param data Transposed input data to cluster
+   * @param bestDistances Contains best distances from each point to medoids
+   * @param secondBestDistances Contains second best distances from each point to medoids
+   * @param assignments Assignments of datapoints to their closest medoid
+   * @param sigma Estimate of each arm's standard deviation, recomputed from
+   * armSumSquares
+   * @param armSums Sums of the arm returns over each prefix, updated in place
+   * @param armSumSquares Sums of the squared arm returns over each prefix,
+   * updated in place
+   * @param armSamples Length of each candidate's prefix of the permutation,
+   * updated in place
+   * @param candidates Arms that may still be the best swap
+   * @param exactMask Whether each arm has been computed exactly
+   * @param estimates Estimated return of each arm
+   * @param lcbs Lower confidence bound of each arm
+   * @param ucbs Upper confidence bound of each arm
+   *
+   * @returns true if the round ended within the tolerance, in which case
+   * the best swap is the arm with the smallest upper confidence bound
+   */
+  bool swapReusingArmStats(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::frowvec *bestDistances,
+          const arma::frowvec *secondBestDistances,
+          const arma::urowvec *assignments,
+          arma::fmat *sigma,
+          arma::mat *armSums,
+          arma::mat *armSumSquares,
+          arma::uvec *armSamples,
+          arma::umat *candidates,
+          arma::umat *exactMask,
+          arma::fmat *estimates,
+          arma::fmat *lcbs,
+          arma::fmat *ucbs);
+
+  /**
+   * @brief Applies further swaps after the best swap of a SWAP iteration.
+   *
+   * Considers the arms whose upper confidence bound is negative in order of
+   * their estimated loss change, and at most one arm per medoid. An arm is
+   * skipped if its medoid, or the cluster its candidate belongs to, has
+   * been changed by a swap already made in this iteration. The remaining
+   * arms are evaluated exactly against the current medoids and applied only
+   * if they still reduce the loss, until maxSwapsPerIter swaps are made.
+   *
+   * @param data Transposed input data to cluster
+   * @param estimates Estimated loss change of each arm in this iteration
+   * @param ucbs Upper confidence bounds of each arm in this iteration
+   * @param swappedMedoid Index of the medoid replaced by the best swap
+   * @param swappedCluster Cluster that contained the new medoid of the best
+   * swap before it was made
+   * @param medoidIndices Indices of the medoids, modified in place
+   * @param medoids Coordinates of the medoids, modified in place
+   * @param bestDistances Contains best distances from each point to medoids
+   * @param secondBestDistances Contains second best distances from each point to medoids
+   * @param assignments Assignments of datapoints to their closest medoid
+   */
+  void swapNonConflicting(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::fmat *estimates,
+          const arma::fmat *ucbs,
+          const size_t swappedMedoid,
+          const size_t swappedCluster,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids,
+          arma::frowvec *bestDistances,
+          arma::frowvec *secondBestDistances,
+          arma::urowvec *assignments);
 
   /**
   * @brief Performs the SWAP step of BanditPAM.
@@ -139,13 +605,16 @@ class BanditPAM : public km::KMedoids {
   * @param medoids Matrix of possible medoids that is updated as the bandit
   * learns which datapoints will be unlikely to be good candidates
   * @param assignments Array of containing the medoid each point is closest to
+  * @param firstCandidate Index of the first point considered as a new
+  * medoid; points before it are only used as reference points
   */
   void swap(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           arma::urowvec *medoidIndices,
           arma::fmat *medoids,
-          arma::urowvec *assignments);
+          arma::urowvec *assignments,
+          const size_t firstCandidate = 0);
 };
 }  // namespace km
 #endif  // HEADERS_ALGORITHMS_BANDITPAM_HPP_
@@ -17,12 +17,10 @@ namespace km {
 class BanditPAM_orig : public km::KMedoids {
  public:
   /**
-   * @brief Runs BanditPAM_orig to identify a dataset's medoids.
-   *
-   * @param inputData Input data to cluster
+   * @brief Runs BanditPAM_orig to identify the medoids of the transposed
+   * data held in data.
    */
   void fitBanditPAM_orig(
-          const arma::fmat &inputData,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat);
 
   /**
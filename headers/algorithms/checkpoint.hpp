@@ -0,0 +1,83 @@
+#ifndef HEADERS_ALGORITHMS_CHECKPOINT_HPP_
+#define HEADERS_ALGORITHMS_CHECKPOINT_HPP_
+
+#include <armadillo>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace km {
+/**
+ * @brief State of a BanditPAM fit after BUILD or after a SWAP iteration,
+ * from which the fit can be resumed.
+ *
+ * The file starts with the magic string "BPAMCKPT" and the format version,
+ * followed by the fields below in order as little-endian integers, floats
+ * and length-prefixed arrays. The cache is optional and empty if it was not
+ * saved.
+ */
+struct Checkpoint {
+  /**
+   * @brief Writes the checkpoint atomically: it is written to a temporary
+   * file next to the given path, which is then renamed over it, so that the
+   * file at the path is always a complete checkpoint.
+   *
+   * @param path Path of the checkpoint
+   *
+   * @throws If the file cannot be written
+   */
+  void write(const std::string &path) const;
+
+  /**
+   * @brief Reads a checkpoint written by write.
+   *
+   * @param path Path of the checkpoint
+   *
+   * @throws If the file cannot be read or is not a checkpoint
+   */
+  void read(const std::string &path);
+
+  /// Version of the format written by write
+  static constexpr uint32_t version = 1;
+
+  /// Number of points of the data
+  uint64_t nPoints = 0;
+
+  /// Number of features of the data
+  uint64_t nFeatures = 0;
+
+  /// Name of the loss function
+  std::string loss;
+
+  /// Number of SWAP iterations performed, 0 right after BUILD
+  uint64_t steps = 0;
+
+  /// Loss of the medoids found by BUILD
+  float buildLoss = 0;
+
+  /// Medoids found by BUILD
+  arma::urowvec buildMedoids;
+
+  /// Current medoids
+  arma::urowvec medoids;
+
+  /// Permutation of the reference points
+  arma::uvec permutation;
+
+  /// Position in the permutation
+  uint64_t permutationIdx = 0;
+
+  /// State of the random number generator, as written by operator<<
+  std::string rngState;
+
+  /// Number of rows of the cache, or 0 if it was not saved
+  uint64_t cacheRows = 0;
+
+  /// Number of columns of the cache, or 0 if it was not saved
+  uint64_t cacheColumns = 0;
+
+  /// Cached distances, cacheRows * cacheColumns of them
+  std::vector<float> cache;
+};
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_CHECKPOINT_HPP_
@@ -0,0 +1,101 @@
+#ifndef HEADERS_ALGORITHMS_DATA_LOADER_HPP_
+#define HEADERS_ALGORITHMS_DATA_LOADER_HPP_
+
+#include <armadillo>
+#include <string>
+
+namespace km {
+/**
+ * @brief Loads datasets from disk directly into the layout of the transposed
+ * data matrix, one column per point, as expected by
+ * KMedoids::fitTransposed.
+ *
+ * The supported formats are:
+ *  - "raw": little-endian float32 values, one point after the other, with
+ *    the number of features given by the caller
+ *  - "npy": a two-dimensional (or one-dimensional, for a single feature)
+ *    NumPy array of little-endian float32 or float64
+ *  - "arma": an Armadillo binary matrix (arma_binary) of float or double
+ *  - "csv": text with one point per line and values separated by commas or
+ *    whitespace, optionally after a header line
+ *
+ * Raw files and C-order float32 .npy files are memory-mapped and used in
+ * place: the returned matrix aliases the read-only mapping, so nothing is
+ * read until the pages are touched and the loader must outlive the matrix.
+ * Other binary files are mapped and converted in a single pass. Text files
+ * are split into chunks at line boundaries that are parsed in parallel.
+ */
+class DataLoader {
+ public:
+  DataLoader() = default;
+
+  ~DataLoader();
+
+  DataLoader(const DataLoader &) = delete;
+
+  DataLoader &operator=(const DataLoader &) = delete;
+
+  /**
+   * @brief Loads a dataset, releasing any dataset previously loaded.
+   *
+   * @param path Path of the file
+   * @param format One of "auto", "raw", "npy", "arma" and "csv". "auto"
+   * picks "npy" for files ending in .npy, "arma" for files starting with an
+   * Armadillo binary header, and "csv" otherwise
+   * @param nFeatures Number of features of each point of a raw file
+   * @param parallelize Whether text is parsed by multiple threads
+   *
+   * @returns The transposed data matrix, one column per point, which must
+   * never be written to
+   *
+   * @throws If the file cannot be read or is not in the given format
+   */
+  arma::fmat load(
+          const std::string &path,
+          const std::string &format = "auto",
+          size_t nFeatures = 0,
+          bool parallelize = true);
+
+  /**
+   * @brief Releases the file, if any. Matrices aliasing it must not be used
+   * afterwards.
+   */
+  void close();
+
+ private:
+  /**
+   * @brief Maps a file, or reads it into memory where mapping is not
+   * supported.
+   *
+   * @param path Path of the file
+   *
+   * @returns The start of the file
+   *
+   * @throws If the file cannot be opened or is empty
+   */
+  const char *map(const std::string &path);
+
+  /**
+   * @brief Parses points in text form.
+   *
+   * @param text Start of the text
+   * @param bytes Length of the text
+   * @param parallelize Whether the text is parsed by multiple threads
+   *
+   * @returns The transposed data matrix
+   *
+   * @throws If the lines do not all have the same number of values
+   */
+  static arma::fmat parseText(const char *text, size_t bytes, bool parallelize);
+
+  /// Start of the file mapping, or nullptr if no file is mapped
+  void *mapping = nullptr;
+
+  /// Length of the file mapping in bytes
+  size_t mappingBytes = 0;
+
+  /// Contents of the file where it cannot be mapped
+  std::string contents;
+};
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_DATA_LOADER_HPP_
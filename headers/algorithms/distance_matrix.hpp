@@ -0,0 +1,233 @@
+#ifndef HEADERS_ALGORITHMS_DISTANCE_MATRIX_HPP_
+#define HEADERS_ALGORITHMS_DISTANCE_MATRIX_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace km {
+/**
+ * @brief Read-only view of a precomputed symmetric distance matrix that is
+ * not held as a dense arma::fmat.
+ *
+ * The distances are either a dense n x n matrix or a condensed matrix, the
+ * upper triangle without the diagonal stored row by row as returned by
+ * scipy.spatial.distance.pdist, and either float32 or float16. They are read
+ * from memory owned by the caller or from a memory-mapped .npy or raw file,
+ * and are never copied.
+ */
+class DistanceMatrix {
+ public:
+  DistanceMatrix() = default;
+
+  ~DistanceMatrix();
+
+  DistanceMatrix(const DistanceMatrix &) = delete;
+
+  DistanceMatrix &operator=(const DistanceMatrix &) = delete;
+
+  /**
+   * @brief Views distances held in memory owned by the caller, which must
+   * outlive the view.
+   *
+   * @param values Distances, row-major if dense
+   * @param n Number of points
+   * @param condensed Whether the distances are condensed
+   * @param half Whether the distances are float16 rather than float32
+   */
+  void view(const void *values, size_t n, bool condensed, bool half);
+
+  /**
+   * @brief Views the distances viewed by another matrix, which must keep
+   * them open for as long as this view is used.
+   *
+   * @param other Matrix whose distances to view
+   */
+  void viewOf(const DistanceMatrix &other);
+
+  /**
+   * @brief Maps distances stored in a file.
+   *
+   * A .npy file holds either a condensed matrix (one dimension) or a dense
+   * square matrix (two dimensions) of little-endian float32 or float16. Any
+   * other file holds a raw condensed matrix of the given type, and the
+   * number of points is inferred from its size.
+   *
+   * @param path Path of the file
+   * @param dtype Type of the values of a raw file, "float32" or "float16"
+   *
+   * @throws If the file cannot be mapped or is not in a supported format
+   */
+  void open(const std::string &path, const std::string &dtype = "float32");
+
+  /**
+   * @brief Stops viewing the distances, unmapping the file if any.
+   */
+  void close();
+
+  /**
+   * @brief Returns whether distances are currently viewed.
+   *
+   * @returns true if distances are viewed and false otherwise
+   */
+  bool isOpen() const;
+
+  /**
+   * @brief Returns the number of points the distances are between.
+   *
+   * @returns The number of points
+   */
+  size_t size() const;
+
+  /**
+   * @brief Returns the number of points of a condensed matrix with the
+   * given number of values.
+   *
+   * @param count Number of values of the condensed matrix
+   *
+   * @returns The number of points, or 0 if no number of points has that
+   * many pairs
+   */
+  static size_t pointsOfCondensed(size_t count);
+
+  /**
+   * @brief Returns the distance between two points.
+   *
+   * @param i Index of the first point
+   * @param j Index of the second point
+   *
+   * @returns The distance between points i and j
+   */
+  float at(size_t i, size_t j) const {
+    size_t index;
+    if (!condensed) {
+      index = i * n + j;
+    } else if (i == j) {
+      return 0;
+    } else {
+      index = i < j ? condensedIndex(i, j, n) : condensedIndex(j, i, n);
+    }
+    if (half) {
+      return halfToFloat(static_cast<const uint16_t *>(values)[index]);
+    }
+    return static_cast<const float *>(values)[index];
+  }
+
+  /**
+   * @brief Returns the position of the distance between two points in a
+   * condensed matrix.
+   *
+   * @param i Index of the first point
+   * @param j Index of the second point, greater than i
+   * @param n Number of points
+   *
+   * @returns The position of the distance between points i and j
+   */
+  static size_t condensedIndex(size_t i, size_t j, size_t n) {
+    // Rows 0..i-1 of the upper triangle hold n - 1 + ... + n - i values
+    return i * n - (i * (i + 1)) / 2 + (j - i - 1);
+  }
+
+  /**
+   * @brief Converts a float to the nearest IEEE 754 half-precision value.
+   *
+   * @param value Value to convert
+   *
+   * @returns Bits of the half-precision value
+   */
+  static uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t exponent = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+    if (exponent == 0xffu) {
+      // Infinity or NaN, keeping NaNs quiet
+      return static_cast<uint16_t>(
+              sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0));
+    }
+    // Rebias the exponent from 127 to 15
+    const int halfExponent = static_cast<int>(exponent) - 112;
+    if (halfExponent >= 0x1f) {
+      return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+    if (halfExponent <= 0) {
+      if (halfExponent < -10) {
+        return sign;
+      }
+      // Subnormal: shift in the implicit bit and round to nearest even
+      mantissa |= 0x800000u;
+      const uint32_t shift = 14 - halfExponent;
+      uint32_t half = mantissa >> shift;
+      const uint32_t remainder = mantissa & ((1u << shift) - 1);
+      const uint32_t midpoint = 1u << (shift - 1);
+      if (remainder > midpoint || (remainder == midpoint && (half & 1))) {
+        half++;
+      }
+      return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) |
+                    (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1fffu;
+    // Round to nearest even; a carry into the exponent is still correct
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1))) {
+      half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+  }
+
+  /**
+   * @brief Converts an IEEE 754 half-precision value to a float.
+   *
+   * @param h Bits of the half-precision value
+   *
+   * @returns The value as a float
+   */
+  static float halfToFloat(uint16_t h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    uint32_t exponent = (h >> 10) & 0x1fu;
+    uint32_t mantissa = h & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0x1fu) {
+      // Infinity or NaN
+      bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+      // Rebias the exponent from 15 to 127
+      bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+      bits = sign;
+    } else {
+      // Subnormal half values are normal floats
+      exponent = 113;
+      while ((mantissa & 0x400u) == 0) {
+        mantissa <<= 1;
+        exponent--;
+      }
+      bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+ private:
+  /// Start of the distances, or nullptr if none are viewed
+  const void *values = nullptr;
+
+  /// Number of points
+  size_t n = 0;
+
+  /// Whether the distances are condensed rather than dense
+  bool condensed = false;
+
+  /// Whether the distances are float16 rather than float32
+  bool half = false;
+
+  /// Start of the file mapping, or nullptr if the distances are not mapped
+  void *mapping = nullptr;
+
+  /// Length of the file mapping in bytes
+  size_t mappingBytes = 0;
+};
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_DISTANCE_MATRIX_HPP_
@@ -17,13 +17,14 @@ namespace km {
 class FastPAM1 : public km::KMedoids {
  public:
   /**
-   * @brief Runs the FastPAM1 algorithm to identify a dataset's medoids.
+   * @brief Runs the FastPAM1 algorithm to identify the medoids of the
+   * transposed data held in data.
    *
-   * @param inputData Input data to cluster
+   * @param initMedoids Optional medoids to start SWAP from, skipping BUILD
    */
   void fitFastPAM1(
-          const arma::fmat &inputData,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat);
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids = std::nullopt);
 
   /**
    * @brief Performs the BUILD step of FastPAM1.
@@ -0,0 +1,32 @@
+#ifndef HEADERS_ALGORITHMS_FIT_PROGRESS_HPP_
+#define HEADERS_ALGORITHMS_FIT_PROGRESS_HPP_
+
+#include <string>
+
+namespace km {
+/**
+ * @brief Progress of a fit, passed to the progress callback of KMedoids
+ * after each medoid chosen in BUILD and after each SWAP iteration, or after
+ * each restart when several restarts run concurrently.
+ */
+struct FitProgress {
+  /// Phase of the fit, "build", "swap" or "restart"
+  std::string phase;
+
+  /// Number of medoids chosen in BUILD, of SWAP iterations performed, or of
+  /// restarts finished
+  size_t step = 0;
+
+  /// Number of medoids to choose in BUILD, maximum number of SWAP
+  /// iterations, or number of restarts
+  size_t total = 0;
+
+  /// Average distance from each point to its closest current medoid, or
+  /// the lowest loss of the restarts finished
+  float loss = 0;
+
+  /// Number of distance computations performed by the fit so far
+  size_t distanceComputations = 0;
+};
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_FIT_PROGRESS_HPP_
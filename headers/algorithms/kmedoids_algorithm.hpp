@@ -3,6 +3,8 @@
 
 #include <omp.h>
 #include <armadillo>
+#include <atomic>
+#include <chrono>
 #include <optional>
 #include <vector>
 #include <fstream>
@@ -10,8 +12,16 @@
 #include <tuple>
 #include <functional>
 #include <unordered_map>
+#include <random>
 #include <string>
 
+#include "distance_matrix.hpp"
+#include "fit_progress.hpp"
+#include "mapped_data.hpp"
+#include "model_file.hpp"
+#include "medoid_tree.hpp"
+#include "workspace.hpp"
+
 namespace km {
 /**
  * @brief KMedoids class. Creates a KMedoids object that can be used to find the medoids
@@ -22,6 +32,9 @@ namespace km {
  * @param maxIter The maximum number of SWAP steps the algorithm runs
  * @param buildConfidence Parameter that affects the width of BUILD confidence intervals
  * @param swapConfidence Parameter that affects the width of SWAP confidence intervals
+ * @param buildMethod Initialization used by BanditPAM before SWAP: "bandit"
+ * (the BanditPAM BUILD step), "lab" (linear approximate BUILD), or
+ * "kmedoids++" (k-medoids++ seeding)
  */
 class KMedoids {
  public:
@@ -38,7 +51,8 @@ class KMedoids {
           bool usePerm = true,
           size_t cacheWidth = 1000,
           bool parallelize = true,
-          size_t seed = 0);
+          size_t seed = 0,
+          const std::string &buildMethod = "bandit");
 
   ~KMedoids();
 
@@ -47,13 +61,414 @@ class KMedoids {
    *
    * @param inputData Input data to cluster
    * @param loss The loss function used during medoid computation
+   * @param distMat Optional precomputed distance matrix
+   * @param initMedoids Optional indices of the medoids to start SWAP from.
+   * If given, the BUILD step is skipped (warm start)
    *
-   * @throws if the input data is empty.
+   * @throws if the input data is empty or the initial medoids are invalid.
    */
   void fit(
           const arma::fmat &inputData,
           const std::string &loss,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat);
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids = std::nullopt);
+
+  /**
+   * @brief Finds medoids for data that is already transposed, i.e. stored
+   * with one column per point, without copying it.
+   *
+   * A row-major buffer of points, such as a C-contiguous numpy array, has
+   * this layout. The buffer is used in place as the data matrix, so it must
+   * not be modified or freed until the next fit; partialFit copies it.
+   *
+   * @param transposedData Input data to cluster, one column per point
+   * @param loss The loss function used during medoid computation
+   * @param distMat Optional precomputed distance matrix
+   * @param initMedoids Optional indices of the medoids to start SWAP from.
+   * If given, the BUILD step is skipped (warm start)
+   *
+   * @throws if the input data is empty or the initial medoids are invalid.
+   */
+  void fitTransposed(
+          const arma::fmat &transposedData,
+          const std::string &loss,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids = std::nullopt);
+
+  /**
+   * @brief Finds medoids for a dataset stored in the mapped data format,
+   * without reading it into memory.
+   *
+   * The file is memory-mapped and its coordinates are used by the distance
+   * functions in place, so neither the input nor its transpose is held in
+   * memory; the pages of each batch of reference points are prefetched as
+   * it is drawn. The mapping is kept until the next fit. Write files with
+   * MappedData::write.
+   *
+   * @param path Path of the file in the mapped data format
+   * @param loss The loss function used during medoid computation
+   * @param initMedoids Optional indices of the medoids to start SWAP from.
+   * If given, the BUILD step is skipped (warm start)
+   *
+   * @throws If the algorithm is not BanditPAM, the file cannot be mapped,
+   * the dataset is empty, or the initial medoids are invalid.
+   */
+  void fitMapped(
+          const std::string &path,
+          const std::string &loss,
+          std::optional<arma::urowvec> initMedoids = std::nullopt);
+
+  /**
+   * @brief Sets a condensed or float16 distance matrix, held in memory
+   * owned by the caller, to be used by subsequent fits instead of distances
+   * computed from the data.
+   *
+   * The distances are read in place and must outlive their use. A dense
+   * distance matrix passed to fit takes precedence.
+   *
+   * @param values Distances: the n x n matrix in row-major order, or its
+   * upper triangle without the diagonal, row by row, if condensed
+   * @param n Number of points
+   * @param condensed Whether the distances are condensed
+   * @param half Whether the distances are float16 rather than float32
+   */
+  void setDistanceMatrix(
+          const void *values,
+          size_t n,
+          bool condensed,
+          bool half);
+
+  /**
+   * @brief Memory-maps a distance matrix stored in a file to be used by
+   * subsequent fits instead of distances computed from the data.
+   *
+   * See DistanceMatrix::open for the supported formats. A dense distance
+   * matrix passed to fit takes precedence.
+   *
+   * @param path Path of the .npy or raw file
+   * @param dtype Type of the values of a raw file, "float32" or "float16"
+   *
+   * @throws If the file cannot be mapped or is not in a supported format
+   */
+  void loadDistanceMatrix(
+          const std::string &path,
+          const std::string &dtype = "float32");
+
+  /**
+   * @brief Stops using the distance matrix set by setDistanceMatrix or
+   * loadDistanceMatrix.
+   */
+  void clearDistanceMatrix();
+
+  /**
+   * @brief Sets a function to be called with the progress of subsequent
+   * fits, from the thread running the fit.
+   *
+   * BanditPAM reports after each medoid chosen in BUILD and after each SWAP
+   * iteration; the other algorithms do not report progress.
+   *
+   * @param callback Function called with the progress, or an empty function
+   * to stop reporting
+   */
+  void setProgressCallback(std::function<void(const FitProgress &)> callback);
+
+  /**
+   * @brief Asks the running fit to stop, and may be called from any thread.
+   *
+   * BanditPAM checks for the request after each medoid chosen in BUILD and
+   * after each SWAP iteration, PAM and FastPAM1 after each SWAP iteration.
+   * The fit then stops with the best medoids found so far: if BUILD is
+   * stopped, only the medoids chosen so far are kept and SWAP is skipped. A
+   * request made while no fit is running stops the next fit.
+   */
+  void requestCancel();
+
+  /**
+   * @brief Returns whether the last fit was stopped by requestCancel.
+   *
+   * @returns true if the last fit was cancelled and false otherwise
+   */
+  bool getCancelled() const;
+
+  /**
+   * @brief Returns whether the last fit ran out of its time or distance
+   * budget before it converged.
+   *
+   * @returns true if the budget was exhausted and false otherwise
+   */
+  bool getBudgetExhausted() const;
+
+  /**
+   * @brief Adds points to a fitted model and updates its medoids.
+   *
+   * The new points are appended to the data, the permutation and the cache,
+   * and are assigned to their closest medoids. At most maxSwapIter SWAP
+   * iterations are then run in which only the new points are considered as
+   * replacement medoids, so the work grows with the number of new points
+   * rather than with the total number of points. Call fit with the current
+   * medoids as initial medoids for a full SWAP over all points.
+   *
+   * @param inputData New datapoints, one per row
+   * @param maxSwapIter Maximum number of SWAP iterations to run
+   *
+   * @throws If the model has not been fit with BanditPAM, was fit with a
+   * distance matrix, or the new points have a different dimension
+   */
+  void partialFit(const arma::fmat &inputData, size_t maxSwapIter = 1);
+
+  /**
+   * @brief Finds medoids for the input data for each of several numbers of
+   * medoids, e.g. to select k with the elbow method.
+   *
+   * The greedy BUILD step is run once, up to the largest k; the first k of
+   * its medoids are the BUILD medoids for k. SWAP is then run from them for
+   * each k in turn, sharing the distance cache and the permutation of
+   * reference points. The medoids and losses for each k are available from
+   * getKRangeMedoids, getKRangeBuildMedoids, getKRangeLosses and
+   * getKRangeBuildLosses, and the model is left fitted with the last k.
+   *
+   * @param inputData Input data to cluster
+   * @param loss The loss function used during medoid computation
+   * @param ks Numbers of medoids to fit
+   *
+   * @throws If the algorithm is not BanditPAM, the input data is empty, or
+   * any k is 0 or larger than the number of points
+   */
+  void fitKRange(
+          const arma::fmat &inputData,
+          const std::string &loss,
+          const arma::urowvec &ks);
+
+  /**
+   * @brief Finds medoids for each of several numbers of medoids, like
+   * fitKRange, for data that is already transposed, i.e. stored with one
+   * column per point, without copying it.
+   *
+   * The buffer is used in place as the data matrix, as by fitTransposed, so
+   * it must not be modified or freed until the next fit.
+   *
+   * @param transposedData Input data to cluster, one column per point
+   * @param loss The loss function used during medoid computation
+   * @param ks Numbers of medoids to fit
+   *
+   * @throws If the algorithm is not BanditPAM, the input data is empty, or
+   * any k is 0 or larger than the number of points
+   */
+  void fitKRangeTransposed(
+          const arma::fmat &transposedData,
+          const std::string &loss,
+          const arma::urowvec &ks);
+
+  /**
+   * @brief Assigns points to the closest of the final medoids.
+   *
+   * Query points are processed in blocks of predictBatchSize, in parallel.
+   * For the L2 and cosine losses the distances of a block to all medoids
+   * come from a single matrix product with the medoid matrix; the other
+   * losses are computed point by point.
+   *
+   * @param inputData Datapoints to assign, one per row
+   * @param distances If not null, the distance from each point to its
+   * closest medoid, written in place
+   *
+   * @returns The index of the closest medoid of each point
+   *
+   * @throws If the model has not been fit or the points have a different
+   * dimension than the data that was fit
+   */
+  arma::urowvec predict(
+          const arma::fmat &inputData,
+          arma::frowvec *distances = nullptr) const;
+
+  /**
+   * @brief Assigns points that are already transposed, i.e. stored with one
+   * column per point, to the closest of the final medoids, like predict.
+   *
+   * @param transposedData Datapoints to assign, one per column
+   * @param distances If not null, the distance from each point to its
+   * closest medoid, written in place
+   *
+   * @returns The index of the closest medoid of each point
+   *
+   * @throws If the model has not been fit or the points have a different
+   * dimension than the data that was fit
+   */
+  arma::urowvec predictTransposed(
+          const arma::fmat &transposedData,
+          arma::frowvec *distances = nullptr) const;
+
+  /**
+   * @brief Returns the coordinates of the final medoids used by predict.
+   *
+   * @returns The medoids, one per column, or an empty matrix if the model
+   * has not been fit or was loaded without them
+   */
+  arma::fmat getMedoidCoordinates() const;
+
+  /**
+   * @brief Saves the hyperparameters and the fitted state of the model in
+   * a versioned binary format.
+   *
+   * @param path Path of the file to write
+   * @param includeCoordinates Whether to embed the coordinates of the final
+   * medoids, which predict needs after the model is loaded
+   *
+   * @throws If the file cannot be written
+   */
+  void saveModel(const std::string &path, bool includeCoordinates = true) const;
+
+  /**
+   * @brief Loads a model saved by saveModel, replacing the hyperparameters
+   * and the fitted state of this one. The file is memory-mapped, and the
+   * training data is not needed to predict if the coordinates of the
+   * medoids were embedded.
+   *
+   * @param path Path of the file to read
+   *
+   * @throws If the file cannot be read or is not a model
+   */
+  void loadModel(const std::string &path);
+
+  /**
+   * @brief Returns the model in the format written by saveModel.
+   *
+   * @param includeCoordinates Whether to embed the coordinates of the final
+   * medoids
+   *
+   * @returns The bytes of the model
+   */
+  std::string serializeModel(bool includeCoordinates = true) const;
+
+  /**
+   * @brief Loads a model from bytes returned by serializeModel.
+   *
+   * @param bytes The bytes of the model
+   *
+   * @throws If the bytes are not a model
+   */
+  void deserializeModel(const std::string &bytes);
+
+  /**
+   * @brief Computes the distances between all pairs of points with the
+   * given loss, writing them into a buffer owned by the caller.
+   *
+   * Only the upper triangle is computed, in square tiles of
+   * distanceTileSize points processed in parallel, and each distance is
+   * written to both of its positions of a dense matrix. For the L2 and
+   * cosine losses the distances of a tile come from one matrix product.
+   * The buffer may be memory-mapped, in which case the matrix never needs
+   * to fit in memory at once.
+   *
+   * @param inputData Datapoints, one per row
+   * @param loss The loss function to compute distances with
+   * @param out Buffer of n x n values in row-major order, or of n (n - 1) / 2
+   * values if condensed, where n is the number of points
+   * @param condensed Whether to write the condensed matrix, the upper
+   * triangle without the diagonal row by row, as returned by scipy's pdist
+   * @param half Whether to write float16 rather than float32 values
+   *
+   * @throws If the loss function is not recognized
+   */
+  void computeDistanceMatrix(
+          const arma::fmat &inputData,
+          const std::string &loss,
+          void *out,
+          bool condensed = false,
+          bool half = false);
+
+  /**
+   * @brief Computes the distances between all pairs of points held one per
+   * column, as computeDistanceMatrix does for points held one per row.
+   *
+   * @param points Datapoints, one per column
+   * @param loss The loss function to compute distances with
+   * @param out Buffer the distances are written into
+   * @param condensed Whether to write the condensed matrix
+   * @param half Whether to write float16 rather than float32 values
+   *
+   * @throws If the loss function is not recognized
+   */
+  void computeDistanceMatrixTransposed(
+          const arma::fmat &points,
+          const std::string &loss,
+          void *out,
+          bool condensed = false,
+          bool half = false);
+
+  /**
+   * @brief Returns the final medoids for each k of the last call to
+   * fitKRange.
+   *
+   * @returns Final medoids, in the order of the ks given to fitKRange
+   */
+  std::vector<arma::urowvec> getKRangeMedoids() const;
+
+  /**
+   * @brief Returns the BUILD medoids for each k of the last call to
+   * fitKRange, each a prefix of those for any larger k.
+   *
+   * @returns BUILD medoids, in the order of the ks given to fitKRange
+   */
+  std::vector<arma::urowvec> getKRangeBuildMedoids() const;
+
+  /**
+   * @brief Returns the final average loss for each k of the last call to
+   * fitKRange.
+   *
+   * @returns Final losses, in the order of the ks given to fitKRange
+   */
+  arma::frowvec getKRangeLosses() const;
+
+  /**
+   * @brief Returns the average loss after BUILD for each k of the last call
+   * to fitKRange.
+   *
+   * @returns BUILD losses, in the order of the ks given to fitKRange
+   */
+  arma::frowvec getKRangeBuildLosses() const;
+
+  /**
+   * @brief Returns the labels of the points for each k of the last call to
+   * fitKRange.
+   *
+   * @returns Index of the closest final medoid of each point, in the order
+   * of the ks given to fitKRange
+   */
+  std::vector<arma::urowvec> getKRangeLabels() const;
+
+  /**
+   * @brief Returns the number of SWAP iterations for each k of the last
+   * call to fitKRange.
+   *
+   * @returns SWAP iterations, in the order of the ks given to fitKRange
+   */
+  arma::urowvec getKRangeSteps() const;
+
+  /**
+   * @brief Returns the time spent in SWAP for each k of the last call to
+   * fitKRange.
+   *
+   * @returns SWAP times in milliseconds, in the order of the ks given to
+   * fitKRange
+   */
+  arma::frowvec getKRangeSwapTimes() const;
+
+  /**
+   * @brief Returns the number of distances computed by SWAP for each k of
+   * the last call to fitKRange.
+   *
+   * @returns SWAP distance computations, in the order of the ks given to
+   * fitKRange
+   */
+  arma::urowvec getKRangeSwapDistanceComputations() const;
+
+  /**
+   * @brief Returns the time spent in the BUILD shared by every k of the
+   * last call to fitKRange.
+   *
+   * @returns BUILD time in milliseconds
+   */
+  float getKRangeBuildTime() const;
 
   /**
    * @brief Returns the medoids at the end of the BUILD step.
@@ -111,6 +526,24 @@ class KMedoids {
    */
   void setAlgorithm(const std::string &newAlgorithm);
 
+  /**
+   * @brief Returns the initialization used by BanditPAM before SWAP.
+   *
+   * @returns The name of the initialization: "bandit", "lab", or "kmedoids++"
+   */
+  std::string getBuildMethod() const;
+
+  /**
+   * @brief Sets the initialization used by BanditPAM before SWAP.
+   *
+   * @param newBuildMethod The new initialization to use: "bandit" (the
+   * BanditPAM BUILD step), "lab" (linear approximate BUILD), or
+   * "kmedoids++" (k-medoids++ seeding)
+   *
+   * @throws If the initialization is unrecognized
+   */
+  void setBuildMethod(const std::string &newBuildMethod);
+
   /**
    * @brief Returns the maximum number of SWAP steps during clustering.
    *
@@ -126,6 +559,280 @@ class KMedoids {
    */
   void setMaxIter(size_t newMaxIter);
 
+  /**
+   * @brief Returns the maximum number of swaps BanditPAM applies in a single
+   * SWAP iteration.
+   *
+   * @returns The maximum number of swaps per SWAP iteration
+   */
+  size_t getMaxSwapsPerIter() const;
+
+  /**
+   * @brief Sets the maximum number of swaps BanditPAM applies in a single
+   * SWAP iteration.
+   *
+   * Besides the best swap, up to newMaxSwapsPerIter - 1 further swaps of
+   * other medoids are applied when their clusters are not affected by the
+   * swaps already made and an exact evaluation confirms they still reduce
+   * the loss.
+   *
+   * @param newMaxSwapsPerIter The new maximum number of swaps per iteration
+   *
+   * @throws If newMaxSwapsPerIter is 0
+   */
+  void setMaxSwapsPerIter(size_t newMaxSwapsPerIter);
+
+  /**
+   * @brief Returns whether BanditPAM reuses the statistics of its swap arms
+   * across SWAP iterations.
+   *
+   * @returns true if arm statistics are reused and false otherwise
+   */
+  bool getReuseArmStats() const;
+
+  /**
+   * @brief Sets whether BanditPAM reuses the statistics of its swap arms
+   * across SWAP iterations.
+   *
+   * When set, the arms are sampled along a fixed permutation of the
+   * reference points and their estimates are kept between iterations.
+   * After a swap, only the returns of the reference points whose closest
+   * medoids changed are recomputed, as in BanditPAM++. Sigma is estimated
+   * from the carried squared returns instead of separate sigma batches.
+   *
+   * @param newReuseArmStats Whether to reuse arm statistics
+   */
+  void setReuseArmStats(bool newReuseArmStats);
+
+  /**
+   * @brief Returns whether BanditPAM estimates the standard deviation of its
+   * arms from the sampling rounds themselves.
+   *
+   * @returns true if sigma is estimated online and false otherwise
+   */
+  bool getOnlineSigma() const;
+
+  /**
+   * @brief Sets whether BanditPAM estimates the standard deviation of its
+   * arms from the sampling rounds themselves.
+   *
+   * When set, the separate batch drawn by buildSigma and swapSigma is
+   * skipped. Each arm's standard deviation is instead updated with every
+   * batch it is sampled on, so the first batch serves both to estimate
+   * sigma and as the first sample of the arm.
+   *
+   * @param newOnlineSigma Whether to estimate sigma online
+   */
+  void setOnlineSigma(bool newOnlineSigma);
+
+  /**
+   * @brief Returns the number of restarts BanditPAM runs per fit.
+   *
+   * @returns The number of restarts
+   */
+  size_t getNInit() const;
+
+  /**
+   * @brief Sets the number of restarts BanditPAM runs per fit.
+   *
+   * BanditPAM runs the restarts concurrently over the same data and
+   * distance cache, each with its own random stream and order of reference
+   * points, and keeps the medoids of the restart with the lowest average
+   * loss. The distance computation counters cover all restarts, and the
+   * distance budget is split evenly between them.
+   *
+   * @param newNInit The number of restarts
+   *
+   * @throws If newNInit is 0
+   */
+  void setNInit(size_t newNInit);
+
+  /**
+   * @brief Returns whether assignments use a metric tree over the medoids.
+   *
+   * @returns true if the medoid tree is used and false otherwise
+   */
+  bool getUseMedoidTree() const;
+
+  /**
+   * @brief Sets whether assignments use a metric tree over the medoids.
+   *
+   * When set, the closest and second closest medoids of each point are
+   * found with a vantage-point tree over the current medoids instead of a
+   * scan over all of them, so that each assignment pass costs about
+   * O(n log k) distances for large k. The tree is rebuilt whenever the
+   * medoids change. It is only used with metric losses and without a
+   * distance matrix; otherwise the medoids are scanned as before.
+   *
+   * @param newUseMedoidTree Whether to use the medoid tree
+   */
+  void setUseMedoidTree(bool newUseMedoidTree);
+
+  /**
+   * @brief Returns whether duplicate points are collapsed before fitting.
+   *
+   * @returns true if duplicates are collapsed and false otherwise
+   */
+  bool getCollapseDuplicates() const;
+
+  /**
+   * @brief Sets whether duplicate points are collapsed before fitting.
+   *
+   * When set, fit hashes the points and replaces the copies of each point
+   * by a single point weighted by its number of copies. BUILD, SWAP and
+   * the loss then weigh each point by its count, so that the medoids
+   * minimize the same objective as on the original data at the cost of
+   * the unique points only. Labels and medoid indices refer to the rows
+   * of the original data. Only BanditPAM supports it, without a distance
+   * matrix and without reuseArmStats.
+   *
+   * @param newCollapseDuplicates Whether to collapse duplicate points
+   */
+  void setCollapseDuplicates(bool newCollapseDuplicates);
+
+  /**
+   * @brief Returns the tolerance within which the bandits consider arms
+   * tied.
+   *
+   * @returns The elimination tolerance
+   */
+  float getTolerance() const;
+
+  /**
+   * @brief Sets the tolerance within which the bandits of BUILD and SWAP
+   * consider arms tied, 0 for exact elimination.
+   *
+   * A round of BanditPAM normally ends once every arm but the best one has
+   * been eliminated, so near-ties are sampled until they are computed
+   * exactly. With a tolerance, the round ends as soon as the smallest upper
+   * confidence bound is within the tolerance of the lower confidence bound
+   * of every remaining arm, and the arm with the smallest upper confidence
+   * bound is chosen, which is then within the tolerance of the best arm
+   * with high probability.
+   *
+   * @param newTolerance The elimination tolerance
+   *
+   * @throws If the tolerance is negative
+   */
+  void setTolerance(float newTolerance);
+
+  /**
+   * @brief Returns whether the tolerance is relative to the magnitude of
+   * the best arm's upper confidence bound rather than absolute.
+   *
+   * @returns true if the tolerance is relative and false otherwise
+   */
+  bool getRelativeTolerance() const;
+
+  /**
+   * @brief Sets whether the tolerance is relative to the magnitude of the
+   * best arm's upper confidence bound, which is the estimated change in
+   * loss of the best arm, rather than absolute.
+   *
+   * @param newRelativeTolerance Whether the tolerance is relative
+   */
+  void setRelativeTolerance(bool newRelativeTolerance);
+
+  /**
+   * @brief Returns the number of seconds each fit may take, or 0 if fits
+   * are not limited in time.
+   *
+   * @returns The time budget in seconds
+   */
+  float getTimeBudget() const;
+
+  /**
+   * @brief Sets the number of seconds each fit may take, 0 for no limit.
+   *
+   * Once half of the time or distance budget is used, BanditPAM narrows the
+   * confidence intervals of BUILD and SWAP with the budget left, so that
+   * arms are eliminated sooner. Once the budget is used up, the remaining
+   * medoids of BUILD are seeded as in k-medoids++ and SWAP stops after its
+   * current iteration, so the fit still returns nMedoids medoids and sets
+   * the budget exhausted flag. PAM and FastPAM1 only check the budget
+   * between SWAP iterations.
+   *
+   * @param newTimeBudget The time budget in seconds
+   *
+   * @throws If the budget is negative
+   */
+  void setTimeBudget(float newTimeBudget);
+
+  /**
+   * @brief Returns the number of distance computations each fit may
+   * perform, or 0 if fits are not limited.
+   *
+   * @returns The distance budget
+   */
+  size_t getDistanceBudget() const;
+
+  /**
+   * @brief Sets the number of distance computations each fit may perform,
+   * including cache hits, 0 for no limit. See setTimeBudget.
+   *
+   * @param newDistanceBudget The distance budget
+   */
+  void setDistanceBudget(size_t newDistanceBudget);
+
+  /**
+   * @brief Returns the path checkpoints are written to, or an empty string
+   * if they are not written.
+   *
+   * @returns The checkpoint path
+   */
+  std::string getCheckpointPath() const;
+
+  /**
+   * @brief Sets the path BanditPAM fits write checkpoints to, or an empty
+   * string to write none.
+   *
+   * A checkpoint is written after BUILD and after each SWAP iteration, and
+   * replaces the previous one atomically. It holds the medoids, the number
+   * of SWAP iterations, the permutation of reference points and the state
+   * of the random number generator, so that a fit killed midway can be
+   * resumed with setResumePath. Checkpoints are only written by fit with a
+   * single restart.
+   *
+   * @param newCheckpointPath The checkpoint path
+   */
+  void setCheckpointPath(const std::string &newCheckpointPath);
+
+  /**
+   * @brief Returns whether checkpoints include the distance cache.
+   *
+   * @returns true if the cache is saved and false otherwise
+   */
+  bool getCheckpointCache() const;
+
+  /**
+   * @brief Sets whether checkpoints include the distance cache, which
+   * spares the resumed fit from recomputing the cached distances at the
+   * cost of n * cacheWidth floats per checkpoint.
+   *
+   * @param newCheckpointCache Whether to save the cache
+   */
+  void setCheckpointCache(bool newCheckpointCache);
+
+  /**
+   * @brief Returns the checkpoint the next fit resumes from, or an empty
+   * string if it starts afresh.
+   *
+   * @returns The path of the checkpoint to resume from
+   */
+  std::string getResumePath() const;
+
+  /**
+   * @brief Sets a checkpoint for the next BanditPAM fit to resume from.
+   *
+   * The next fit must be on the same data with the same loss and number of
+   * medoids as the checkpointed one. It skips BUILD and continues SWAP from
+   * the checkpointed medoids, permutation and random state. The path is
+   * only used by the next fit and is cleared afterwards.
+   *
+   * @param newResumePath The path of the checkpoint to resume from
+   */
+  void setResumePath(const std::string &newResumePath);
+
   /**
    * @brief Returns the buildConfidence, a parameter that affects the width
    * of the confidence intervals during the BUILD step.
@@ -163,14 +870,15 @@ class KMedoids {
   void setSwapConfidence(size_t newSwapConfidence);
 
   /**
-   * @brief Sets the random seed for armadillo.
+   * @brief Sets the random seed and reseeds the random number generator of
+   * this instance.
    *
    * @param newSeed The new seed value to use
    */
   void setSeed(size_t newSeed);
 
   /**
-   * @brief Gets the value of the last supplied seed used by armadillo
+   * @brief Gets the value of the last supplied seed
    *
    * @param newSeed The new seed value to use
    */
@@ -330,7 +1038,13 @@ class KMedoids {
   float getTimePerSwap() const;
 
   /// The cache which stores pairwise distance computations
-  float *cache;
+  float *cache = nullptr;
+
+  /// Number of reference points (columns) each row of the cache holds
+  size_t cacheColumns = 0;
+
+  /// Number of points (rows) the cache has been allocated for
+  size_t cacheRows = 0;
 
   /// The permutation in which to sample the reference points
   arma::uvec permutation;
@@ -344,6 +1058,32 @@ class KMedoids {
   /// Determines whether we use a user-provided distance matrix
   bool useDistMat = false;
 
+  /// Condensed, float16 or mapped distance matrix set for the next fits
+  DistanceMatrix distanceMatrix;
+
+  /// Function called with the progress of fits, if not empty
+  std::function<void(const FitProgress &)> progressCallback;
+
+  /// Set by requestCancel, possibly from another thread, and cleared when a
+  /// fit completes
+  std::atomic<bool> cancelRequested{false};
+
+  /// Whether the last fit was stopped by requestCancel
+  bool cancelled = false;
+
+  /// Model whose fit this model runs one restart of, and whose cancel
+  /// requests it follows, or nullptr
+  const KMedoids *restartOf = nullptr;
+
+  /// Whether the running fit writes checkpoints to checkpointPath
+  bool checkpointing = false;
+
+  /// Whether the last fit ran out of its time or distance budget
+  bool budgetExhausted = false;
+
+  /// Time at which the running fit started, for the time budget
+  std::chrono::steady_clock::time_point fitStart;
+
 
  protected:
   /**
@@ -381,6 +1121,115 @@ class KMedoids {
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::urowvec *medoidIndices);
 
+  /**
+   * @brief Draws an index uniformly at random with the generator of this
+   * instance.
+   *
+   * @param bound Number of possible indices
+   *
+   * @returns An index in [0, bound)
+   */
+  size_t randomIndex(size_t bound);
+
+  /**
+   * @brief Draws a number uniformly at random with the generator of this
+   * instance.
+   *
+   * @returns A number in [0, 1)
+   */
+  double randomUniform();
+
+  /**
+   * @brief Draws a uniformly random permutation of the points, as
+   * arma::randperm(n) does with the global generator.
+   *
+   * @param n Number of points
+   *
+   * @returns The permutation
+   */
+  arma::uvec randomPermutation(size_t n);
+
+  /**
+   * @brief Draws distinct points uniformly at random and in random order, as
+   * arma::randperm(n, m) does with the global generator, without allocating
+   * once sampleIndices has n elements.
+   *
+   * @param n Number of points
+   * @param m Number of points to draw, at most n
+   * @param out Array of m indices, written in place
+   */
+  void randomSample(size_t n, size_t m, arma::uword *out);
+
+  /**
+   * @brief Computes the loss between a query point and a medoid given by
+   * its coordinates.
+   *
+   * @param queries Query points, one per column
+   * @param q Index of the query point in queries
+   * @param medoids Medoid coordinates, one per column
+   * @param k Index of the medoid in medoids
+   *
+   * @returns The loss between the query point and the medoid
+   */
+  float queryLoss(
+          const arma::fmat &queries,
+          const size_t q,
+          const arma::fmat &medoids,
+          const size_t k) const;
+
+  /**
+   * @brief Returns whether the loss satisfies the triangle inequality, so
+   * that the medoid tree can prune medoids.
+   *
+   * @returns true if the loss is a metric and false otherwise
+   */
+  bool isMetricLoss() const;
+
+  /**
+   * @brief Builds a vantage-point tree over the given medoids.
+   *
+   * @param medoids Medoid coordinates, one per column
+   * @param tree Tree to build, written in place
+   *
+   * @returns The number of distances computed
+   */
+  size_t buildMedoidTree(
+          const arma::fmat &medoids,
+          MedoidTree *tree) const;
+
+  /**
+   * @brief Rebuilds medoidTree over the given medoids of the dataset if
+   * they differ from the medoids it was last built over.
+   *
+   * @param data Transposed data to cluster
+   * @param medoidIndices Indices of the medoids in the dataset
+   */
+  void refreshMedoidTree(
+          const arma::fmat &data,
+          const arma::urowvec &medoidIndices);
+
+  /**
+   * @brief Finds the closest and second closest medoids of a query point
+   * with a medoid tree.
+   *
+   * @param tree Tree over the medoids
+   * @param queries Query points, one per column
+   * @param q Index of the query point in queries
+   * @param best Distance to the closest medoid, written in place
+   * @param second Distance to the second closest medoid, written in place
+   * @param assignment Column of the closest medoid in the tree's
+   * coordinates, written in place
+   *
+   * @returns The number of distances computed
+   */
+  size_t searchMedoidTree(
+          const MedoidTree &tree,
+          const arma::fmat &queries,
+          const size_t q,
+          float *best,
+          float *second,
+          arma::uword *assignment) const;
+
   /**
    * @brief A wrapper around the given loss function that caches distances
    * between the given points.
@@ -462,6 +1311,209 @@ class KMedoids {
                   const size_t i,
                   const size_t j) const;
 
+  /**
+   * @brief Returns the hyperparameters and the fitted state of the model.
+   *
+   * @param includeCoordinates Whether to include the coordinates of the
+   * final medoids
+   *
+   * @returns The model in the form it is saved in
+   */
+  ModelFile toModelFile(bool includeCoordinates) const;
+
+  /**
+   * @brief Replaces the hyperparameters and the fitted state of the model.
+   *
+   * @param model The model to load
+   *
+   * @throws If the model has invalid hyperparameters or medoids
+   */
+  void fromModelFile(const ModelFile &model);
+
+  /**
+   * @brief Resets the distance computation and cache counters, the
+   * cancelled and budget flags and the budget clock before a fit.
+   */
+  void resetCounters();
+
+  /**
+   * @brief Adds the counts of each thread to the distance computation and
+   * cache counters and clears them.
+   *
+   * Must not be called from within a parallel loop.
+   */
+  void flushCounters();
+
+  /**
+   * @brief Returns the fraction of the time or distance budget used by the
+   * running fit, whichever is larger.
+   *
+   * @returns The fraction of the budget used, 0 if there is no budget
+   */
+  float budgetUsed() const;
+
+  /**
+   * @brief Returns whether the running fit has used up its budget.
+   *
+   * @returns true if the fit must stop and false otherwise
+   */
+  bool budgetSpent();
+
+  /**
+   * @brief Returns the factor by which the bandits scale the logarithmic
+   * term of their confidence intervals.
+   *
+   * The factor is 1 until half of the budget is used and then decreases
+   * quadratically to 0 when it is used up, which narrows the intervals
+   * linearly in the budget left.
+   *
+   * @returns The factor, in [0, 1]
+   */
+  float budgetConfidence();
+
+  /**
+   * @brief Passes the progress of the fit to the progress callback, if any.
+   *
+   * @param phase Phase of the fit, "build", "swap" or "restart"
+   * @param step Number of medoids chosen, SWAP iterations performed or
+   * restarts finished
+   * @param total Number of medoids to choose, maximum SWAP iterations or
+   * number of restarts
+   * @param loss Average distance from each point to its closest medoid
+   */
+  void reportProgress(
+          const char *phase,
+          size_t step,
+          size_t total,
+          float loss);
+
+  /**
+   * @brief Returns whether the running fit has been asked to stop.
+   *
+   * @returns true if the fit must stop and false otherwise
+   */
+  bool fitCancelled();
+
+  /**
+   * @brief Runs the chosen algorithm on the transposed data held in data.
+   *
+   * @param loss The loss function used during medoid computation
+   * @param distMat Optional precomputed distance matrix
+   * @param initMedoids Optional indices of the medoids to start SWAP from
+   *
+   * @throws if the data is empty or the initial medoids are invalid.
+   */
+  void fitData(
+          const std::string &loss,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids);
+
+  /**
+   * @brief Clears the medoids, labels, losses and coordinates of a fit that
+   * failed part of the way through.
+   */
+  void clearFit();
+
+  /**
+   * @brief Assigns points to the closest of the final medoids.
+   *
+   * @param inputData Datapoints to assign
+   * @param transposed Whether the points are columns rather than rows
+   * @param distances If not null, the distance from each point to its
+   * closest medoid, written in place
+   *
+   * @returns The index of the closest medoid of each point
+   *
+   * @throws If the model has not been fit or the points have a different
+   * dimension than the data that was fit
+   */
+  arma::urowvec predictData(
+          const arma::fmat &inputData,
+          bool transposed,
+          arma::frowvec *distances) const;
+
+  /**
+   * @brief Checks that a range of k can be fit to a number of points.
+   *
+   * @param n Number of points
+   * @param ks Numbers of medoids to fit
+   *
+   * @throws If the algorithm is not BanditPAM, there are no points, or any
+   * k is 0 or larger than the number of points
+   */
+  void checkKRange(size_t n, const arma::urowvec &ks) const;
+
+  /**
+   * @brief Runs BanditPAM for each of several numbers of medoids on the
+   * transposed data held in data.
+   *
+   * @param loss The loss function used during medoid computation
+   * @param ks Numbers of medoids to fit
+   */
+  void fitKRangeData(const std::string &loss, const arma::urowvec &ks);
+
+  /**
+   * @brief Releases the data of the previous fit, unmapping it if it was
+   * mapped, so that data no longer aliases memory it does not own.
+   */
+  void releaseData();
+
+  /**
+   * @brief Copies data into memory owned by the model if it aliases memory
+   * it does not own, so that it can be grown and is no longer affected by
+   * writes to that memory.
+   */
+  void ownData();
+
+  /**
+   * @brief Replaces data by its unique points and records the number of
+   * copies of each, unless every point is unique.
+   *
+   * @throws If there are fewer unique points than medoids
+   */
+  void collapseData();
+
+  /**
+   * @brief Maps the labels and medoid indices of a fit on the unique points
+   * back to the rows of the original data.
+   */
+  void expandResults();
+
+  /**
+   * @brief Returns the number of original rows a point of data stands for.
+   *
+   * @param point Index of the point in data
+   *
+   * @returns The weight of the point, 1 if duplicates were not collapsed
+   */
+  float pointWeight(size_t point) const {
+    return pointWeights.n_elem == 0 ? 1 : pointWeights(point);
+  }
+
+  /**
+   * @brief Returns the number of original rows of the data.
+   *
+   * @returns The sum of the weights of the points of data
+   */
+  size_t totalWeight() const {
+    return pointWeights.n_elem == 0 ? data.n_cols : rowPoints.n_elem;
+  }
+
+  /**
+   * @brief Returns the weighted average of the distances of the points of
+   * data to their closest medoid.
+   *
+   * @param distances Distance from each point of data to its closest medoid
+   *
+   * @returns The average distance over the original rows
+   */
+  float meanLoss(const arma::frowvec &distances) const {
+    if (pointWeights.n_elem == 0) {
+      return arma::mean(distances);
+    }
+    return arma::dot(distances, pointWeights) / rowPoints.n_elem;
+  }
+
   /**
    * @brief Checks whether algorithm choice is valid. The given
    * algorithm must be either "BanditPAM", "PAM", or "FastPAM1".
@@ -472,6 +1524,17 @@ class KMedoids {
    */
   void checkAlgorithm(const std::string &algorithm) const;
 
+  /**
+   * @brief Checks whether user-supplied initial medoids are valid: there
+   * must be exactly nMedoids distinct indices, all within the dataset.
+   *
+   * @param initMedoids Indices of the initial medoids
+   * @param n Number of datapoints in the dataset
+   *
+   * @throws If the initial medoids are invalid.
+   */
+  void checkInitMedoids(const arma::urowvec &initMedoids, size_t n) const;
+
   /// Number of medoids to use -- the "k" in k-medoids
   size_t nMedoids;
 
@@ -481,9 +1544,65 @@ class KMedoids {
   /// Maximum number of SWAP steps to perform
   size_t maxIter;
 
+  /// Initialization used by BanditPAM before SWAP
+  std::string buildMethod = "bandit";
+
+  /// Maximum number of non-conflicting swaps applied per SWAP iteration
+  size_t maxSwapsPerIter = 1;
+
+  /// Whether swap arm statistics are carried across SWAP iterations
+  bool reuseArmStats = false;
+
+  /// Whether sigma is estimated from the bandit sampling rounds
+  bool onlineSigma = false;
+
+  /// Number of restarts BanditPAM runs per fit, keeping the best
+  size_t nInit = 1;
+
+  /// Bandit rounds end once the best arm is within this of all others
+  float tolerance = 0;
+
+  /// Whether tolerance is relative to the best upper confidence bound
+  bool relativeTolerance = false;
+
+  /// Path checkpoints are written to, if not empty
+  std::string checkpointPath;
+
+  /// Whether checkpoints include the distance cache
+  bool checkpointCache = false;
+
+  /// Checkpoint the next fit resumes from, if not empty
+  std::string resumePath;
+
+  /// Seconds each fit may take, or 0 for no limit
+  float timeBudget = 0;
+
+  /// Distance computations each fit may perform, or 0 for no limit
+  size_t distanceBudget = 0;
+
+  /// Whether assignments use a metric tree over the medoids
+  bool useMedoidTree = false;
+
+  /// Whether duplicate points are collapsed before fitting
+  bool collapseDuplicates = false;
+
   /// Data to be clustered
   arma::fmat data;
 
+  /// Number of original rows each point of data stands for, or empty if
+  /// duplicates were not collapsed
+  arma::frowvec pointWeights;
+
+  /// Index in data of the point of each original row, when collapsed
+  arma::uvec rowPoints;
+
+  /// First original row of each point of data, when collapsed
+  arma::uvec pointRows;
+
+  /// File mapping that data aliases after fitMapped; after fitTransposed,
+  /// data aliases the caller's memory instead
+  MappedData mappedData;
+
   /// Cluster assignments of each point
   arma::urowvec labels;
 
@@ -493,6 +1612,43 @@ class KMedoids {
   /// Indices of the medoids after clustering
   arma::urowvec medoidIndicesFinal;
 
+  /// Final medoids for each k of the last call to fitKRange
+  std::vector<arma::urowvec> kRangeMedoids;
+
+  /// BUILD medoids for each k of the last call to fitKRange
+  std::vector<arma::urowvec> kRangeBuildMedoids;
+
+  /// Final average loss for each k of the last call to fitKRange
+  arma::frowvec kRangeLosses;
+
+  /// Average loss after BUILD for each k of the last call to fitKRange
+  arma::frowvec kRangeBuildLosses;
+
+  /// Labels for each k of the last call to fitKRange
+  std::vector<arma::urowvec> kRangeLabels;
+
+  /// SWAP iterations for each k of the last call to fitKRange
+  arma::urowvec kRangeSteps;
+
+  /// Milliseconds spent in SWAP for each k of the last call to fitKRange
+  arma::frowvec kRangeSwapTimes;
+
+  /// Distances computed by SWAP for each k of the last call to fitKRange
+  arma::urowvec kRangeSwapDistanceComputations;
+
+  /// Milliseconds spent in the shared BUILD of the last call to fitKRange
+  float kRangeBuildTime = 0;
+
+  /// Coordinates of the final medoids, one per column, used by predict
+  arma::fmat medoidCoordinates;
+
+  /// Number of query points predict assigns at a time
+  size_t predictBatchSize = 1024;
+
+  /// Number of points on each side of the tiles computeDistanceMatrix
+  /// computes at a time, so that both blocks of points stay in cache
+  size_t distanceTileSize = 256;
+
   /// Function pointer to the loss function to use
   float (KMedoids::*lossFn)(
           const arma::fmat &data,
@@ -524,6 +1680,15 @@ class KMedoids {
   /// The random seed with which to perform the clustering
   size_t seed = 0;
 
+  /// Random number generator of this instance, seeded by setSeed. All
+  /// randomness is drawn from it rather than from armadillo's generator, so
+  /// that instances fit concurrently from different threads are independent
+  /// and reproducible
+  std::mt19937_64 rng;
+
+  /// Permutation of the points whose prefix randomSample shuffles in place
+  arma::uvec sampleIndices;
+
   /// Used for floatcomparisons, primarily number of "arms" remaining
   const float precision = 0.001;
 
@@ -536,32 +1701,59 @@ class KMedoids {
   /// Number of points to sample per reference batch
   size_t batchSize = 100;
 
+  /**
+   * @brief Distance and cache counts of one OpenMP thread, padded to a
+   * cache line so that the threads of a loop do not contend for one.
+   */
+  struct alignas(64) ThreadCounts {
+    size_t misc = 0;
+    size_t build = 0;
+    size_t swap = 0;
+    size_t cacheWrites = 0;
+    size_t cacheHits = 0;
+    size_t cacheMisses = 0;
+  };
+
+  /// Counts of each OpenMP thread since the last call to flushCounters,
+  /// indexed by omp_get_thread_num
+  std::vector<ThreadCounts> threadCounts;
+
+  // The totals below only change when flushCounters adds the per-thread
+  // counts between parallel loops, and are atomic because a progress
+  // callback or another thread may read them while a fit runs
+
   /// The number of non-cache distance computations we compute
   /// in the BUILD step. For debugging only.
-  size_t numMiscDistanceComputations = 0;
+  std::atomic<size_t> numMiscDistanceComputations{0};
 
   /// The number of non-cache distance computations we compute
   /// in the BUILD step. For debugging only.
-  size_t numBuildDistanceComputations = 0;
+  std::atomic<size_t> numBuildDistanceComputations{0};
 
   /// The number of non-cache distance computations we compute.
   /// For debugging only.
-  size_t numSwapDistanceComputations = 0;
+  std::atomic<size_t> numSwapDistanceComputations{0};
 
   /// The number of cache hits (distance computations we reuse).
   /// For debugging only.
-  size_t numCacheWrites = 0;
+  std::atomic<size_t> numCacheWrites{0};
 
   /// The number of cache writes (distance computations we save).
   /// For debugging only.
-  size_t numCacheHits = 0;
+  std::atomic<size_t> numCacheHits{0};
 
   /// The number of cache misses, i.e., distance computations we
   /// need to compute. For debugging only.
-  size_t numCacheMisses = 0;
+  std::atomic<size_t> numCacheMisses{0};
 
-  /// The number of milliseconds taken per swap step, on average
+  /// The number of milliseconds taken by SWAP in the last fit
   size_t totalSwapTime = 0;
+
+  /// Preallocated buffers reused across the rounds of BUILD and SWAP
+  Workspace workspace;
+
+  /// Metric tree over the medoids of the last assignment pass
+  MedoidTree medoidTree;
 };
 }  // namespace km
 #endif  // HEADERS_ALGORITHMS_KMEDOIDS_ALGORITHM_HPP_
@@ -0,0 +1,101 @@
+#ifndef HEADERS_ALGORITHMS_MAPPED_DATA_HPP_
+#define HEADERS_ALGORITHMS_MAPPED_DATA_HPP_
+
+#include <armadillo>
+#include <cstdint>
+#include <string>
+
+namespace km {
+/**
+ * @brief Read-only memory map of a dataset stored on disk in the layout of
+ * the transposed data matrix.
+ *
+ * The file starts with a header of headerBytes bytes: the magic string
+ * "BPAMDATA", the format version and the number of features and points.
+ * It is followed by the float32 coordinates in column-major order, one
+ * column per point, which is the layout of the data member of KMedoids. The
+ * mapped coordinates can therefore be used by the distance functions
+ * directly, with pages read from disk as they are first touched, so the
+ * dataset need not fit in memory.
+ */
+class MappedData {
+ public:
+  MappedData() = default;
+
+  ~MappedData();
+
+  MappedData(const MappedData &) = delete;
+
+  MappedData &operator=(const MappedData &) = delete;
+
+  /**
+   * @brief Writes points to a file in the mapped data format.
+   *
+   * @param path Path of the file to write
+   * @param inputData Points to write, one per row
+   *
+   * @throws If the file cannot be written
+   */
+  static void write(const std::string &path, const arma::fmat &inputData);
+
+  /**
+   * @brief Maps a file in the mapped data format, closing any file
+   * previously mapped.
+   *
+   * @param path Path of the file to map
+   *
+   * @throws If the file cannot be opened or is not in the expected format
+   */
+  void open(const std::string &path);
+
+  /**
+   * @brief Unmaps the file, if any. Matrices aliasing the mapped
+   * coordinates must not be used afterwards.
+   */
+  void close();
+
+  /**
+   * @brief Returns whether a file is currently mapped.
+   *
+   * @returns true if a file is mapped and false otherwise
+   */
+  bool isOpen() const;
+
+  /**
+   * @brief Returns a matrix aliasing the mapped coordinates, one column per
+   * point, without copying them.
+   *
+   * @returns The transposed data matrix backed by the mapping
+   */
+  arma::fmat matrix() const;
+
+  /**
+   * @brief Advises the kernel that the given points will be read soon, so
+   * that their pages are read ahead while the current round computes.
+   *
+   * @param points Indices of the points
+   * @param count Number of points
+   */
+  void prefetch(const arma::uword *points, size_t count) const;
+
+  /// Number of bytes before the coordinates in the file
+  static constexpr size_t headerBytes = 64;
+
+  /// Version of the format written by write
+  static constexpr uint32_t version = 1;
+
+ private:
+  /// Start of the mapping, or nullptr if no file is mapped
+  void *mapping = nullptr;
+
+  /// Length of the mapping in bytes
+  size_t mappingBytes = 0;
+
+  /// Number of features of each point
+  size_t nFeatures = 0;
+
+  /// Number of points
+  size_t nPoints = 0;
+};
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_MAPPED_DATA_HPP_
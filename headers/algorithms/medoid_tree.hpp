@@ -0,0 +1,55 @@
+#ifndef HEADERS_ALGORITHMS_MEDOID_TREE_HPP_
+#define HEADERS_ALGORITHMS_MEDOID_TREE_HPP_
+
+#include <armadillo>
+
+namespace km {
+/**
+ * @brief Vantage-point tree over the current set of medoids.
+ *
+ * Used to find the closest and second closest medoids of a point without
+ * computing its distance to every medoid, which only holds when the loss is
+ * a metric. The tree is stored implicitly in order: the node spanning the
+ * positions [lo, hi) has its vantage point at order(lo), the medoids within
+ * radii(lo) of the vantage point at [lo + 1, mid), and the remaining ones at
+ * [mid, hi), where mid is given by split(lo, hi).
+ */
+struct MedoidTree {
+  /**
+   * @brief Returns the first position of the outer subtree of a node.
+   *
+   * @param lo First position spanned by the node
+   * @param hi One past the last position spanned by the node
+   *
+   * @returns The first position of the outer subtree
+   */
+  static size_t split(size_t lo, size_t hi) {
+    return lo + 1 + (hi - lo - 1) / 2;
+  }
+
+  /// A subtree still to be searched, with a lower bound on its distance
+  struct Frame {
+    size_t lo;
+    size_t hi;
+    float bound;
+  };
+
+  /// Bound on the number of pending subtrees during a search, which is at
+  /// most one more than the depth of the tree
+  static constexpr size_t maxPending = 128;
+
+  /// Coordinates of the medoids, one per column
+  arma::fmat coordinates;
+
+  /// Indices of the medoids in the dataset, if built over the dataset
+  arma::urowvec medoidIndices;
+
+  /// Columns of coordinates in tree order
+  arma::uvec order;
+
+  /// Median distance from the vantage point of the node starting at each
+  /// position to the other medoids of the node
+  arma::fvec radii;
+};
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_MEDOID_TREE_HPP_
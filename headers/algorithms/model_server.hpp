@@ -0,0 +1,229 @@
+#ifndef HEADERS_ALGORITHMS_MODEL_SERVER_HPP_
+#define HEADERS_ALGORITHMS_MODEL_SERVER_HPP_
+
+#include <armadillo>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "kmedoids_algorithm.hpp"
+
+namespace km {
+/// Request types of the model server protocol, described in serve.cpp
+const uint32_t ASSIGN_REQUEST = 1;
+const uint32_t STATS_REQUEST = 2;
+const uint32_t INFO_REQUEST = 3;
+
+/// Largest number of coordinates accepted in one assignment request
+const uint64_t MAX_REQUEST_VALUES = uint64_t(1) << 28;
+
+/**
+ * @brief Histogram of non-negative integers in power-of-two buckets, which
+ * can be read while it is recorded to.
+ */
+class Histogram {
+ public:
+  /**
+   * @brief Records a value in the bucket [2^(b-1), 2^b) that holds it, or
+   * bucket 0 if it is 0.
+   *
+   * @param value Value to record
+   */
+  void record(uint64_t value);
+
+  /**
+   * @brief Returns the histogram as a JSON object with the count, mean,
+   * maximum, the upper bounds of the buckets holding the median and the
+   * 90th and 99th percentiles, and the count of each non-empty bucket
+   * keyed by its exclusive upper bound.
+   *
+   * @returns The histogram as JSON
+   */
+  std::string json() const;
+
+ private:
+  /**
+   * @brief Returns the exclusive upper bound of a bucket.
+   *
+   * @param bucket Index of the bucket
+   *
+   * @returns The upper bound of the bucket
+   */
+  static uint64_t upper(size_t bucket);
+
+  /// Number of values recorded in each bucket
+  std::array<std::atomic<uint64_t>, 48> counts{};
+
+  /// Sum of the values recorded
+  std::atomic<uint64_t> sum{0};
+
+  /// Largest value recorded
+  std::atomic<uint64_t> max{0};
+};
+
+/**
+ * @brief Points of an assignment request and, once it is done, their
+ * labels and distances or an error.
+ */
+struct AssignRequest {
+  /// Coordinates of the points, one point after the other
+  const float *points = nullptr;
+
+  /// Number of points
+  size_t nPoints = 0;
+
+  /// Time at which the request was received
+  std::chrono::steady_clock::time_point received;
+
+  /// Index of the closest medoid of each point
+  arma::urowvec labels;
+
+  /// Distance from each point to its closest medoid
+  arma::frowvec distances;
+
+  /// Error message if the points could not be assigned, or empty
+  std::string error;
+
+  /// Set once the request is done
+  std::promise<void> done;
+};
+
+/**
+ * @brief Coalesces the assignment requests of all connections into
+ * predict passes over the model, run on a single thread.
+ */
+class Batcher {
+ public:
+  /**
+   * @brief Creates a batcher assigning points to the medoids of a model,
+   * which must outlive it.
+   *
+   * @param model Model whose medoid coordinates are set
+   * @param maxBatchPoints Largest number of points of a predict pass,
+   * unless a single request has more
+   * @param maxWait Longest time a request waits for others to join its pass
+   */
+  Batcher(
+          const KMedoids &model,
+          size_t maxBatchPoints,
+          std::chrono::microseconds maxWait);
+
+  /**
+   * @brief Queues a request and waits until it is done, or rejects it if
+   * the batcher is stopping.
+   *
+   * @param request Request to assign, which sets its labels and distances
+   * or its error
+   */
+  void submit(AssignRequest *request);
+
+  /**
+   * @brief Runs predict passes over the queued requests until stop is
+   * called and the queue is empty.
+   */
+  void run();
+
+  /**
+   * @brief Stops run once the queued requests are done, and rejects new
+   * ones.
+   */
+  void stop();
+
+  /**
+   * @brief Returns the request counts and histograms as JSON.
+   *
+   * @returns The statistics as JSON
+   */
+  std::string stats() const;
+
+  /// Number of features of the points of each request
+  const size_t nFeatures;
+
+ private:
+  /**
+   * @brief Assigns the points of a batch of requests in one predict pass.
+   *
+   * @param batch Requests to assign, which are then done
+   */
+  void assign(const std::vector<AssignRequest *> &batch);
+
+  /// Model whose medoids the points are assigned to
+  const KMedoids &model;
+
+  /// Largest number of points of a predict pass
+  const size_t maxBatchPoints;
+
+  /// Longest time a request waits for others to join its pass
+  const std::chrono::microseconds maxWait;
+
+  /// Guards the queue and the stopping flag
+  std::mutex mutex;
+
+  /// Notified when a request is queued or the batcher stops
+  std::condition_variable ready;
+
+  /// Requests waiting for a predict pass, oldest first
+  std::deque<AssignRequest *> queue;
+
+  /// Number of points of the queued requests
+  size_t queuedPoints = 0;
+
+  /// Whether stop was called
+  bool stopping = false;
+
+  /// Number of requests and points assigned, and of predict passes
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> points{0};
+  std::atomic<uint64_t> batches{0};
+
+  /// Microseconds from receiving to answering each request
+  Histogram latency;
+
+  /// Microseconds each request waited for its predict pass
+  Histogram queueing;
+
+  /// Microseconds of each predict pass
+  Histogram predicting;
+
+  /// Number of requests and of points of each predict pass
+  Histogram batchRequests;
+  Histogram batchPoints;
+};
+
+/**
+ * @brief Returns the answer to info requests: the number of medoids, the
+ * number of features, the loss function and the average loss of the fit
+ * of a model, as JSON.
+ *
+ * @param model Model being served
+ *
+ * @returns The information as JSON
+ */
+std::string modelInfo(const KMedoids &model);
+
+/**
+ * @brief Answers the requests read from a connection until it is closed or
+ * sends a malformed request. The socket I/O is left to the caller.
+ *
+ * @param read Reads exactly the given number of bytes into a buffer,
+ * returning false if the connection ended first
+ * @param write Writes the given bytes, returning false if the connection
+ * ended first
+ * @param batcher Batcher that assigns the points
+ * @param info Answer to info requests
+ */
+void serveRequests(
+        const std::function<bool(void *, size_t)> &read,
+        const std::function<bool(const void *, size_t)> &write,
+        Batcher *batcher,
+        const std::string &info);
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_MODEL_SERVER_HPP_
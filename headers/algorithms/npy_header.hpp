@@ -0,0 +1,88 @@
+#ifndef HEADERS_ALGORITHMS_NPY_HEADER_HPP_
+#define HEADERS_ALGORITHMS_NPY_HEADER_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace km {
+/**
+ * @brief Reads the preamble of a .npy file: the magic string, the version,
+ * the header length and the header itself.
+ *
+ * @param file Start of the file
+ * @param bytes Size of the file in bytes
+ * @param header The header, a Python dict literal, written in place
+ * @param offset Position of the array data in the file, written in place
+ *
+ * @returns true if the file starts with a valid preamble and false otherwise
+ */
+inline bool readNpyHeader(
+        const char *file,
+        size_t bytes,
+        std::string *header,
+        size_t *offset) {
+  if (bytes < 10 || std::memcmp(file, "\x93NUMPY", 6) != 0) {
+    return false;
+  }
+  size_t headerLength = 0;
+  if (file[6] == 1) {
+    headerLength = static_cast<unsigned char>(file[8]) |
+                   (static_cast<unsigned char>(file[9]) << 8);
+    *offset = 10 + headerLength;
+  } else if (bytes >= 12) {
+    uint32_t length;
+    std::memcpy(&length, file + 8, sizeof(length));
+    headerLength = length;
+    *offset = 12 + headerLength;
+  } else {
+    return false;
+  }
+  if (*offset > bytes) {
+    return false;
+  }
+  header->assign(file + *offset - headerLength, headerLength);
+  return true;
+}
+
+/**
+ * @brief Returns the value of the given key in the header of a .npy file,
+ * which is a Python dict literal, or an empty string. The quotes or
+ * parentheses around strings and tuples are removed.
+ *
+ * @param header Header of the file
+ * @param key Key to look up
+ *
+ * @returns The value of the key
+ */
+inline std::string npyHeaderValue(
+        const std::string &header,
+        const std::string &key) {
+  const size_t position = header.find("'" + key + "'");
+  if (position == std::string::npos) {
+    return "";
+  }
+  size_t first = header.find(':', position);
+  if (first == std::string::npos) {
+    return "";
+  }
+  first = header.find_first_not_of(' ', first + 1);
+  if (first == std::string::npos) {
+    return "";
+  }
+  const char open = header[first];
+  size_t last;
+  if (open == '\'') {
+    last = header.find('\'', first + 1);
+    return last == std::string::npos
+           ? "" : header.substr(first + 1, last - first - 1);
+  } else if (open == '(') {
+    last = header.find(')', first);
+    return last == std::string::npos
+           ? "" : header.substr(first + 1, last - first - 1);
+  }
+  last = header.find_first_of(",}", first);
+  return header.substr(first, last - first);
+}
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_NPY_HEADER_HPP_
@@ -17,13 +17,14 @@ namespace km {
 class PAM : public km::KMedoids {
  public:
   /**
-  * @brief Runs PAM to identify a dataset's medoids.
+  * @brief Runs PAM to identify the medoids of the transposed data held in
+  * data.
   *
-  * @param inputData Input data to cluster
+  * @param initMedoids Optional medoids to start SWAP from, skipping BUILD
   */
   void fitPAM(
-          const arma::fmat &inputData,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat);
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids = std::nullopt);
 
   /**
   * @brief Performs the BUILD step of PAM.
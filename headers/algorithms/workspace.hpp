@@ -0,0 +1,58 @@
+#ifndef HEADERS_ALGORITHMS_WORKSPACE_HPP_
+#define HEADERS_ALGORITHMS_WORKSPACE_HPP_
+
+#include <armadillo>
+
+namespace km {
+/**
+ * @brief Preallocated buffers for the per-round temporaries of BanditPAM.
+ *
+ * Each round of the BUILD and SWAP steps samples reference points, selects
+ * the arms to evaluate, and estimates their rewards. Rather than allocating
+ * fresh Armadillo objects in every round, these buffers are sized once per
+ * call to fit() and the algorithms take non-owning views of the required
+ * length into them.
+ */
+struct Workspace {
+  /**
+   * @brief Sizes the buffers for a problem with n points and k medoids.
+   *
+   * Buffers are only reallocated when they are smaller than required, so
+   * repeated fits on datasets of similar size do not touch the allocator.
+   *
+   * @param n Number of datapoints
+   * @param k Number of medoids
+   * @param batchSize Number of reference points sampled per round
+   * @param nThreads Maximum number of OpenMP threads that use the workspace
+   * @param withSquares Whether to also size the buffer for squared returns
+   */
+  void reserve(
+          size_t n,
+          size_t k,
+          size_t batchSize,
+          size_t nThreads,
+          bool withSquares = false);
+
+  /**
+   * @brief Frees all buffers held by the workspace.
+   */
+  void release();
+
+  /// Reference points, when they are not read from the fixed permutation
+  arma::uvec referencePoints;
+
+  /// Indices of the arms (candidate points) evaluated in a round
+  arma::uvec targets;
+
+  /// Results of buildTarget (1 x T) or swapTarget (k x T), column-major
+  arma::fvec results;
+
+  /// Sums of squared returns matching results, when sigma is estimated from
+  /// the sampling rounds; kept in double so that their variance survives
+  arma::vec squares;
+
+  /// Per-thread scratch space for the samples used to estimate sigma
+  arma::fmat sigmaSamples;
+};
+}  // namespace km
+#endif  // HEADERS_ALGORITHMS_WORKSPACE_HPP_
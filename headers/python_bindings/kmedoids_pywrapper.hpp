@@ -6,11 +6,19 @@
 #include <pybind11/numpy.h>
 #include <carma>
 #include <armadillo>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "kmedoids_algorithm.hpp"
 
 namespace km {
+class FitHandle;
+
 /**
  *  @brief Python wrapper for KMedoids class. Allows Python code to call
  *  the C++ code.
@@ -22,17 +30,99 @@ class KMedoidsWrapper : public km::KMedoids {
    * @brief Python binding for fitting a KMedoids object to the
    *
    * This is the primary function of the KMedoids module: this finds the build and swap
-   * medoids for the desired data
+   * medoids for the desired data. C-contiguous float32 input is used in
+   * place, without a copy; it must not be modified until the next fit.
+   * The GIL is released during the fit, so different instances can be fit
+   * concurrently from different threads; a single instance must not be used
+   * from several threads at once.
    *
    * @param inputData Input data to find the medoids of
    * @param loss The loss function used during medoid computation
-   * @param k The number of medoids to compute
+   * @param kw Optional keyword arguments: k, the number of medoids to
+   * compute; dist_mat, a precomputed distance matrix, dense or condensed as
+   * returned by scipy's pdist, in float32 or float16; dist_mat_path, the
+   * path of a .npy or raw condensed distance matrix to memory-map instead,
+   * with dist_mat_dtype the type of a raw file; and init_medoids, the
+   * indices of the medoids to start SWAP from instead of running BUILD
    */
   void fitPython(
           const pybind11::array_t<float> &inputData,
           const std::string &loss,
           pybind11::kwargs kw);
 
+  /**
+   * @brief Python binding for fitting a KMedoids object in a background
+   * thread.
+   *
+   * The model must not be used until the fit is done, which result() of the
+   * returned handle waits for.
+   *
+   * @param inputData Input data to find the medoids of
+   * @param loss The loss function used during medoid computation
+   * @param kw The keyword arguments of fitPython, and callback, a function
+   * called from the background thread with a dict of the progress of the
+   * fit after each BUILD step and SWAP iteration
+   *
+   * @returns Handle of the running fit
+   */
+  std::unique_ptr<FitHandle> fitAsyncPython(
+          const pybind11::array_t<float> &inputData,
+          const std::string &loss,
+          pybind11::kwargs kw);
+
+  /**
+   * @brief Python binding for fitting a KMedoids object to a dataset stored
+   * in the mapped data format
+   *
+   * @param path Path of the file written by write_mapped_data
+   * @param loss The loss function used during medoid computation
+   */
+  void fitMappedPython(const std::string &path, const std::string &loss);
+
+  /**
+   * @brief Python binding for adding points to a fitted KMedoids object
+   *
+   * @param inputData New datapoints, one per row
+   * @param maxIter Maximum number of SWAP iterations over the new points
+   */
+  void partialFitPython(
+          const pybind11::array_t<float> &inputData,
+          size_t maxIter);
+
+  /**
+   * @brief Python binding for fitting a KMedoids object for several numbers
+   * of medoids
+   *
+   * @param inputData Input data to find the medoids of
+   * @param loss The loss function used during medoid computation
+   * @param ks Numbers of medoids to fit
+   *
+   * @returns A dict with the numbers of medoids ("k"), the final medoids for
+   * each k ("medoids"), the average loss after SWAP ("loss") and after
+   * BUILD ("build_loss") for each k, the labels ("labels"), SWAP iterations
+   * ("steps"), SWAP milliseconds ("swap_time") and SWAP distance
+   * computations ("swap_distance_computations") for each k, and the
+   * milliseconds of the shared BUILD ("build_time")
+   */
+  pybind11::dict fitKRangePython(
+          const pybind11::array_t<float> &inputData,
+          const std::string &loss,
+          const std::vector<size_t> &ks);
+
+  /**
+   * @brief Python binding for assigning points to the final medoids
+   *
+   * @param inputData Datapoints to assign, one per row
+   * @param returnDistances Whether to also return the distance from each
+   * point to its closest medoid
+   *
+   * @returns The labels as a numpy array, or a tuple of the labels and the
+   * distances if returnDistances is true
+   */
+  pybind11::object predictPython(
+          const pybind11::array_t<float> &inputData,
+          bool returnDistances);
+
   /**
    * @brief Returns the build medoids
    *
@@ -131,15 +221,186 @@ class KMedoidsWrapper : public km::KMedoids {
    * The average time per swap step by the last call to .fit()
    */
   float getTimePerSwapPython();
+
+ private:
+  /**
+   * @brief Converts the arguments of fitPython, which requires the GIL.
+   *
+   * @param inputData Input data to find the medoids of
+   * @param loss The loss function used during medoid computation
+   * @param kw The keyword arguments of fitPython
+   *
+   * @returns Function running the fit, which does not require the GIL
+   */
+  std::function<void()> prepareFitPython(
+          const pybind11::array_t<float> &inputData,
+          const std::string &loss,
+          pybind11::kwargs kw);
+
+  /// Array whose memory the data matrix aliases while a zero-copy fit runs
+  pybind11::object dataOwner;
+
+  /// Array whose memory the distance matrix of the last fit is read from
+  pybind11::object distMatOwner;
+};
+
+/**
+ *  @brief Handle of a fit running in a background thread, returned by
+ *  KMedoids.fit_async.
+ *
+ *  Dropping the handle cancels the fit and waits for it to stop.
+ */
+class FitHandle {
+ public:
+  /**
+   * @brief Starts fitting a model in a background thread.
+   *
+   * @param kmedoids Model to fit, kept alive by the handle's Python object
+   * @param run Function running the fit without the GIL
+   * @param callback Python function called with the progress, or None
+   */
+  FitHandle(
+          KMedoidsWrapper *kmedoids,
+          std::function<void()> run,
+          pybind11::object callback);
+
+  ~FitHandle();
+
+  FitHandle(const FitHandle &) = delete;
+
+  FitHandle &operator=(const FitHandle &) = delete;
+
+  /**
+   * @brief Returns whether the fit has finished, was cancelled, or failed.
+   *
+   * @returns true if the fit is over and false otherwise
+   */
+  bool done();
+
+  /**
+   * @brief Asks the fit to stop with the best medoids found so far.
+   */
+  void cancel();
+
+  /**
+   * @brief Returns the last progress reported by the fit.
+   *
+   * @returns A dict with the phase, step, total, loss and
+   * distance_computations of the fit, or None before the first report
+   */
+  pybind11::object progress();
+
+  /**
+   * @brief Waits for the fit to be over.
+   *
+   * @param timeout Maximum number of seconds to wait, or None to wait until
+   * the fit is over
+   *
+   * @returns The fitted model
+   *
+   * @throws The error of the fit if it failed, or TimeoutError if the fit
+   * is not over after timeout seconds
+   */
+  pybind11::object result(pybind11::object timeout);
+
+ private:
+  /**
+   * @brief Records the progress of the fit and passes it to the callback,
+   * from the background thread.
+   *
+   * @param progress Progress of the fit
+   */
+  void update(const FitProgress &progress);
+
+  /// Model being fit
+  KMedoidsWrapper *kmedoids;
+
+  /// Python function called with the progress, or None
+  pybind11::object callback;
+
+  /// Whether callback is a function rather than None
+  bool hasCallback;
+
+  /// Thread running the fit
+  std::thread worker;
+
+  /// Guards the members below, which the background thread writes
+  std::mutex mutex;
+
+  /// Signalled when the fit is over
+  std::condition_variable finishedCondition;
+
+  /// Whether the fit is over
+  bool finished = false;
+
+  /// Whether progress has been reported yet
+  bool hasProgress = false;
+
+  /// Last progress reported by the fit
+  FitProgress latest;
+
+  /// Error of the fit or of the callback, if any
+  std::exception_ptr error;
 };
 
 // TODO(@motiwari): Encapsulate these
 
+  /**
+  * @brief Binding for the C++ function MappedData::write
+  *
+  * @param path Path of the file to write
+  * @param inputData Points to write, one per row
+  */
+  void writeMappedDataPython(
+        const std::string &path,
+        const pybind11::array_t<float> &inputData);
+
+  /**
+  * @brief Binding for the C++ function KMedoids::computeDistanceMatrix
+  *
+  * @param inputData Datapoints, one per row
+  * @param loss The loss function to compute distances with
+  * @param out Array to write the distances into, float32 or float16 of
+  * shape (n, n) or condensed of shape (n * (n - 1) / 2,), e.g. a memory-mapped
+  * array from numpy.lib.format.open_memmap; or None to allocate one
+  * @param condensed Whether to allocate a condensed array if out is None
+  * @param dtype Type of the array to allocate if out is None
+  * @param parallelize Whether to compute the tiles in parallel
+  *
+  * @returns The array of distances
+  */
+  pybind11::array computeDistanceMatrixPython(
+        const pybind11::array_t<float,
+                pybind11::array::c_style | pybind11::array::forcecast>
+                &inputData,
+        const std::string &loss,
+        pybind11::object out,
+        bool condensed,
+        pybind11::object dtype,
+        bool parallelize);
+
   /**
   * @brief Binding for the C++ function KMedoids::fit
   */
   void fit_python(pybind11::class_ <km::KMedoidsWrapper> *cls);
 
+  /**
+  * @brief Binding for KMedoids.fit_async and the FitHandle it returns
+  */
+  void fit_async_python(
+          pybind11::module *m,
+          pybind11::class_ <km::KMedoidsWrapper> *cls);
+
+  /**
+  * @brief Binding for KMedoids.save, KMedoids.load and pickling
+  */
+  void model_file_python(pybind11::class_ <km::KMedoidsWrapper> *cls);
+
+  /**
+  * @brief Binding for the C++ function KMedoids::predict
+  */
+  void predict_python(pybind11::class_ <km::KMedoidsWrapper> *cls);
+
   /**
   * @brief Binding for the C++ function KMedoids::getMedoidsBuild()
   */
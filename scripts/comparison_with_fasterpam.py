@@ -47,7 +47,7 @@ def run_fasterpam(data, seed):
 
 
 def run_bandit(data, seed):
-    diss = euclidean_distances(data)
+    diss = banditpam.compute_distance_matrix(data, "L2")
     km = banditpam.KMedoids(5, parallelize=True, dist_mat=diss)
     print(km.algorithm)
     km.seed = seed
@@ -64,7 +64,7 @@ def run_bandit(data, seed):
 
 
 def run_old_bandit(data, seed):
-    diss = euclidean_distances(data)
+    diss = banditpam.compute_distance_matrix(data, "L2")
     km = banditpam.KMedoids(
         n_medoids=5,
         parallelize=True,
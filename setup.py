@@ -550,6 +550,12 @@ def main():
                 os.path.join("src", "algorithms", "banditpam.cpp"),
                 os.path.join("src", "algorithms", "banditpam_orig.cpp"),
                 os.path.join("src", "algorithms", "fastpam1.cpp"),
+                os.path.join("src", "algorithms", "workspace.cpp"),
+                os.path.join("src", "algorithms", "mapped_data.cpp"),
+                os.path.join("src", "algorithms", "distance_matrix.cpp"),
+                os.path.join("src", "algorithms", "checkpoint.cpp"),
+                os.path.join("src", "algorithms", "model_file.cpp"),
+                os.path.join("src", "algorithms", "data_loader.cpp"),
                 os.path.join(
                     "src", "python_bindings", "kmedoids_pywrapper.cpp"
                 ),
@@ -558,6 +564,16 @@ def main():
                     "src", "python_bindings", "build_medoids_python.cpp"
                 ),
                 os.path.join("src", "python_bindings", "fit_python.cpp"),
+                os.path.join(
+                    "src", "python_bindings", "fit_async_python.cpp"
+                ),
+                os.path.join(
+                    "src", "python_bindings", "distance_matrix_python.cpp"
+                ),
+                os.path.join("src", "python_bindings", "predict_python.cpp"),
+                os.path.join(
+                    "src", "python_bindings", "model_file_python.cpp"
+                ),
                 os.path.join("src", "python_bindings", "labels_python.cpp"),
                 os.path.join("src", "python_bindings", "steps_python.cpp"),
                 os.path.join("src", "python_bindings", "loss_python.cpp"),
@@ -8,16 +8,314 @@
 #include "banditpam.hpp"
 
 #include <armadillo>
+#include <algorithm>
 #include <unordered_map>
 #include <cmath>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
 #include <vector>
 
+#include "checkpoint.hpp"
+
 namespace km {
   void BanditPAM::fitBanditPAM(
-          const arma::fmat &inputData,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat) {
-    data = arma::trans(inputData);
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids) {
+    initializeFit();
+    checkpointing = !checkpointPath.empty() && nInit == 1;
+    if (nInit == 1) {
+      fitOnce(distMat, initMedoids);
+      return;
+    }
+
+    // Each restart is fit by its own model, so that the restarts can run
+    // on separate threads while sharing the data and the distance cache
+    std::vector<std::unique_ptr<BanditPAM>> restarts;
+    for (size_t restart = 0; restart < nInit; restart++) {
+      restarts.push_back(makeRestart(restart));
+    }
+
+    std::vector<std::exception_ptr> errors(nInit);
+    size_t finished = 0;
+    float bestLoss = std::numeric_limits<float>::infinity();
+    #pragma omp parallel for if (this->parallelize) schedule(dynamic, 1)
+    for (size_t restart = 0; restart < nInit; restart++) {
+      BanditPAM *model = restarts[restart].get();
+      try {
+        model->fitOnce(distMat, initMedoids);
+        // SWAP may stop at maxIter before it records the loss
+        model->averageLoss = model->calcLoss(
+                model->data, distMat, &model->medoidIndicesFinal);
+      } catch (...) {
+        errors[restart] = std::current_exception();
+      }
+      model->flushCounters();
+
+      #pragma omp critical
+      {
+        // The counters cover every restart, including those that failed
+        numMiscDistanceComputations += model->numMiscDistanceComputations;
+        numBuildDistanceComputations += model->numBuildDistanceComputations;
+        numSwapDistanceComputations += model->numSwapDistanceComputations;
+        numCacheWrites += model->numCacheWrites;
+        numCacheHits += model->numCacheHits;
+        numCacheMisses += model->numCacheMisses;
+        if (!errors[restart]) {
+          finished++;
+          bestLoss = std::min(bestLoss, model->averageLoss);
+          reportProgress("restart", finished, nInit, bestLoss);
+        }
+      }
+    }
+
+    for (const std::exception_ptr &error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+    // Ties go to the earliest restart, so that the result does not depend
+    // on the order in which the threads finish
+    const BanditPAM *best = restarts.front().get();
+    for (const std::unique_ptr<BanditPAM> &model : restarts) {
+      cancelled = cancelled || model->cancelled;
+      budgetExhausted = budgetExhausted || model->budgetExhausted;
+      if (model->averageLoss < best->averageLoss) {
+        best = model.get();
+      }
+    }
+
+    averageLoss = best->averageLoss;
+    medoidIndicesBuild = best->medoidIndicesBuild;
+    medoidIndicesFinal = best->medoidIndicesFinal;
+    labels = best->labels;
+    buildLoss = best->buildLoss;
+    steps = best->steps;
+    totalSwapTime = best->totalSwapTime;
+  }
+
+  void BanditPAM::fitOnce(
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids) {
+    arma::fmat medoidMatrix(data.n_rows, nMedoids);
+    arma::urowvec medoidIndices(nMedoids);
+    steps = 0;
+    if (initMedoids) {
+      // Warm start: SWAP begins directly from the given medoids
+      medoidIndices = initMedoids.value();
+      for (size_t k = 0; k < nMedoids; k++) {
+        medoidMatrix.unsafe_col(k) = data.unsafe_col(medoidIndices(k));
+      }
+    } else if (!resumePath.empty()) {
+      // Resume: SWAP continues from the checkpointed medoids
+      BanditPAM::restoreCheckpoint(&medoidIndices, &medoidMatrix);
+    } else if (buildMethod == "lab") {
+      BanditPAM::buildLAB(data, distMat, &medoidIndices, &medoidMatrix);
+    } else if (buildMethod == "kmedoids++") {
+      BanditPAM::buildKMedoidsPlusPlus(
+              data, distMat, &medoidIndices, &medoidMatrix);
+    } else {
+      BanditPAM::build(data, distMat, &medoidIndices, &medoidMatrix);
+    }
+
+    if (resumePath.empty()) {
+      buildLoss = KMedoids::calcLoss(data, distMat, &medoidIndices);
+      medoidIndicesBuild = medoidIndices;
+      if (!fitCancelled()) {
+        saveCheckpoint(medoidIndices);
+      }
+    }
+    arma::urowvec assignments(data.n_cols);
+    const auto swapStart = std::chrono::steady_clock::now();
+    if (nMedoids > 1 && !fitCancelled() && !budgetSpent()) {
+      BanditPAM::swap(
+              data,
+              distMat,
+              &medoidIndices,
+              &medoidMatrix,
+              &assignments);
+    } else {
+      arma::frowvec bestDistances(data.n_cols);
+      arma::frowvec secondBestDistances(data.n_cols);
+      calcBestDistancesSwap(
+              data,
+              distMat,
+              &medoidIndices,
+              &bestDistances,
+              &secondBestDistances,
+              &assignments,
+              false);
+    }
+    totalSwapTime = static_cast<size_t>(
+            std::chrono::duration<float, std::milli>(
+                    std::chrono::steady_clock::now() - swapStart).count());
+
+    medoidIndicesFinal = medoidIndices;
+    labels = assignments;
+  }
+
+  std::unique_ptr<BanditPAM> BanditPAM::makeRestart(const size_t restart) {
+    auto model = std::make_unique<BanditPAM>();
+    ModelFile settings = toModelFile(false);
+    settings.buildMedoids.reset();
+    settings.medoids.reset();
+    settings.labels.reset();
+    model->fromModelFile(settings);
+    model->nInit = 1;
+    model->restartOf = this;
+    model->lossFn = lossFn;
+    // The restarts themselves are spread over the threads, so each runs
+    // its BUILD and SWAP loops on a single thread
+    model->parallelize = false;
+    model->fitStart = fitStart;
+    if (distanceBudget > 0) {
+      model->distanceBudget = (distanceBudget + nInit - 1) / nInit;
+    }
+
+    // The data, the distance matrix and the cache are shared read-only, or
+    // in the case of the cache, only ever filled with the same distances
+    model->data = arma::fmat(
+            const_cast<float *>(data.memptr()),
+            data.n_rows,
+            data.n_cols,
+            false,
+            false);
+    model->pointWeights = pointWeights;
+    model->rowPoints = rowPoints;
+    model->pointRows = pointRows;
+    model->useDistMat = useDistMat;
+    if (distanceMatrix.isOpen()) {
+      model->distanceMatrix.viewOf(distanceMatrix);
+    }
+    model->batchSize = batchSize;
+    model->cache = cache;
+    model->cacheColumns = cacheColumns;
+    model->cacheRows = cacheRows;
+    model->reindex = reindex;
+    model->permutation = permutation;
+    model->workspace.reserve(
+            data.n_cols,
+            nMedoids,
+            batchSize,
+            omp_get_max_threads(),
+            onlineSigma || reuseArmStats);
+
+    // The first restart draws the reference points a single fit would;
+    // every other one has its own random stream and order of points
+    if (restart == 0) {
+      model->rng = rng;
+      model->permutationIdx = permutationIdx;
+    } else {
+      std::seed_seq streamSeed{
+              static_cast<uint64_t>(seed), static_cast<uint64_t>(restart)};
+      model->rng.seed(streamSeed);
+      model->shufflePermutation();
+    }
+    return model;
+  }
+
+  void BanditPAM::fitKRangeBanditPAM(const arma::urowvec &ks) {
+    // The cache, the permutation and the workspace are shared by every k
+    const size_t maxK = ks.max();
+    nMedoids = maxK;
+    initializeFit();
+
+    // BUILD is greedy, so the first k medoids of the BUILD for the largest
+    // k are the BUILD for k
+    arma::fmat buildMatrix(data.n_rows, maxK);
+    arma::urowvec buildIndices(maxK);
+    arma::frowvec prefixLosses;
+    const auto buildStart = std::chrono::steady_clock::now();
+    if (buildMethod == "lab") {
+      BanditPAM::buildLAB(data, std::nullopt, &buildIndices, &buildMatrix);
+    } else if (buildMethod == "kmedoids++") {
+      BanditPAM::buildKMedoidsPlusPlus(
+              data, std::nullopt, &buildIndices, &buildMatrix);
+    } else {
+      BanditPAM::build(
+              data, std::nullopt, &buildIndices, &buildMatrix, &prefixLosses);
+    }
+    kRangeBuildTime = std::chrono::duration<float, std::milli>(
+            std::chrono::steady_clock::now() - buildStart).count();
+
+    kRangeMedoids.clear();
+    kRangeBuildMedoids.clear();
+    kRangeLabels.clear();
+    kRangeLosses.set_size(ks.n_elem);
+    kRangeBuildLosses.set_size(ks.n_elem);
+    kRangeSteps.set_size(ks.n_elem);
+    kRangeSwapTimes.set_size(ks.n_elem);
+    kRangeSwapDistanceComputations.set_size(ks.n_elem);
+    for (size_t r = 0; r < ks.n_elem; r++) {
+      if (r > 0 && (fitCancelled() || budgetSpent())) {
+        // Keep the results for the numbers of medoids already done
+        kRangeLosses.resize(r);
+        kRangeBuildLosses.resize(r);
+        kRangeSteps.resize(r);
+        kRangeSwapTimes.resize(r);
+        kRangeSwapDistanceComputations.resize(r);
+        break;
+      }
+      // A cancelled BUILD may have chosen fewer medoids than asked for
+      nMedoids = std::min(ks(r), buildIndices.n_elem);
+      arma::urowvec medoidIndices = buildIndices.head(nMedoids);
+      arma::fmat medoidMatrix = buildMatrix.head_cols(nMedoids);
+      if (prefixLosses.n_elem >= nMedoids) {
+        buildLoss = prefixLosses(nMedoids - 1);
+      } else {
+        buildLoss = KMedoids::calcLoss(data, std::nullopt, &medoidIndices);
+      }
+      medoidIndicesBuild = medoidIndices;
+
+      arma::urowvec assignments(data.n_cols);
+      steps = 0;
+      const auto swapStart = std::chrono::steady_clock::now();
+      flushCounters();
+      const size_t swapDistanceComputations = numSwapDistanceComputations;
+      if (nMedoids > 1 && !fitCancelled() && !budgetSpent()) {
+        BanditPAM::swap(
+                data,
+                std::nullopt,
+                &medoidIndices,
+                &medoidMatrix,
+                &assignments);
+        // SWAP may stop at maxIter before it records the loss
+        averageLoss = KMedoids::calcLoss(data, std::nullopt, &medoidIndices);
+      } else {
+        arma::frowvec bestDistances(data.n_cols);
+        arma::frowvec secondBestDistances(data.n_cols);
+        calcBestDistancesSwap(
+                data,
+                std::nullopt,
+                &medoidIndices,
+                &bestDistances,
+                &secondBestDistances,
+                &assignments,
+                false);
+      }
+
+      const float swapTime = std::chrono::duration<float, std::milli>(
+              std::chrono::steady_clock::now() - swapStart).count();
+      totalSwapTime = static_cast<size_t>(swapTime);
+      flushCounters();
+
+      medoidIndicesFinal = medoidIndices;
+      labels = assignments;
+      kRangeMedoids.push_back(medoidIndices);
+      kRangeBuildMedoids.push_back(medoidIndicesBuild);
+      kRangeLabels.push_back(assignments);
+      kRangeLosses(r) = averageLoss;
+      kRangeBuildLosses(r) = buildLoss;
+      kRangeSteps(r) = steps;
+      kRangeSwapTimes(r) = swapTime;
+      kRangeSwapDistanceComputations(r) =
+              numSwapDistanceComputations - swapDistanceComputations;
+    }
+  }
 
+  void BanditPAM::initializeFit() {
     // Note: even if we are using a distance matrix, we compute the permutation
     // in the block below because it is used elsewhere in the call stack
     // TODO(@motiwari): Remove need for data or permutation through when using
@@ -26,69 +324,332 @@ namespace km {
       size_t n = data.n_cols;
       size_t m = fmin(n, cacheWidth);
       cache = new float[n * m];
+      cacheColumns = m;
+      cacheRows = n;
 
       #pragma omp parallel for if (this->parallelize)
       for (size_t idx = 0; idx < m * n; idx++) {
         cache[idx] = -1;  // TODO(@motiwari): need better value here
       }
 
-      permutation = arma::randperm(n);
+      permutation = randomPermutation(n);
       permutationIdx = 0;
       reindex = {};  // TODO(@motiwari): Can this intialization be removed?
       // TODO(@motiwari): Can we parallelize this?
       for (size_t counter = 0; counter < m; counter++) {
         reindex[permutation[counter]] = counter;
       }
+    } else if (this->usePerm || this->reuseArmStats) {
+      // The reference points are read from the permutation in place
+      permutation = randomPermutation(data.n_cols);
+      permutationIdx = 0;
+    }
+
+    // Size the per-round buffers once so that BUILD and SWAP do not allocate
+    workspace.reserve(
+            data.n_cols,
+            nMedoids,
+            batchSize,
+            omp_get_max_threads(),
+            onlineSigma || reuseArmStats);
+  }
+
+  bool BanditPAM::finishBuildStep(
+          const size_t k,
+          const arma::frowvec &bestDistances,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids,
+          arma::frowvec *prefixLosses) {
+    reportProgress("build", k + 1, nMedoids, meanLoss(bestDistances));
+    // Only sweeps over k stop short; a single fit must keep nMedoids
+    // medoids, so its BUILD seeds the rest instead
+    if (prefixLosses == nullptr || k + 1 == nMedoids || !fitCancelled()) {
+      return false;
+    }
+    medoidIndices->resize(k + 1);
+    medoids->resize(medoids->n_rows, k + 1);
+    prefixLosses->resize(k + 1);
+    return true;
+  }
+
+  bool BanditPAM::withinTolerance(
+          const arma::fmat &lcbs,
+          const arma::umat &candidates,
+          const float minUcb) const {
+    if (tolerance <= 0) {
+      return false;
+    }
+    const float slack = relativeTolerance
+                        ? tolerance * std::fabs(minUcb)
+                        : tolerance;
+    for (size_t i = 0; i < candidates.n_elem; i++) {
+      if (candidates(i) && minUcb - lcbs(i) > slack) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void BanditPAM::saveCheckpoint(const arma::urowvec &medoidIndices) {
+    if (!checkpointing) {
+      return;
+    }
+    Checkpoint checkpoint;
+    checkpoint.nPoints = data.n_cols;
+    checkpoint.nFeatures = data.n_rows;
+    checkpoint.loss = getLossFn();
+    checkpoint.steps = steps;
+    checkpoint.buildLoss = buildLoss;
+    checkpoint.buildMedoids = medoidIndicesBuild;
+    checkpoint.medoids = medoidIndices;
+    checkpoint.permutation = permutation;
+    checkpoint.permutationIdx = permutationIdx;
+    std::ostringstream rngState;
+    rngState << rng;
+    checkpoint.rngState = rngState.str();
+    if (checkpointCache && this->useCache) {
+      checkpoint.cacheRows = cacheRows;
+      checkpoint.cacheColumns = cacheColumns;
+      checkpoint.cache.assign(cache, cache + cacheRows * cacheColumns);
+    }
+    checkpoint.write(checkpointPath);
+  }
+
+  void BanditPAM::restoreCheckpoint(
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids) {
+    Checkpoint checkpoint;
+    checkpoint.read(resumePath);
+    if (checkpoint.nPoints != data.n_cols ||
+        checkpoint.nFeatures != data.n_rows ||
+        checkpoint.loss != getLossFn() ||
+        checkpoint.medoids.n_elem != nMedoids ||
+        checkpoint.buildMedoids.n_elem != nMedoids ||
+        arma::any(checkpoint.medoids >= data.n_cols) ||
+        arma::any(checkpoint.buildMedoids >= data.n_cols)) {
+      throw std::invalid_argument(
+              "Error: the checkpoint " + resumePath + " was written for "
+              "other data, loss or number of medoids");
+    }
+
+    *medoidIndices = checkpoint.medoids;
+    for (size_t k = 0; k < nMedoids; k++) {
+      medoids->unsafe_col(k) = data.unsafe_col((*medoidIndices)(k));
+    }
+    medoidIndicesBuild = checkpoint.buildMedoids;
+    buildLoss = checkpoint.buildLoss;
+    steps = checkpoint.steps;
+
+    std::istringstream rngState(checkpoint.rngState);
+    rngState >> rng;
+    if (!rngState) {
+      throw std::invalid_argument(
+              "Error: " + resumePath + " is not a checkpoint");
+    }
+
+    if (checkpoint.permutation.n_elem == data.n_cols) {
+      permutation = checkpoint.permutation;
+      permutationIdx = checkpoint.permutationIdx;
+    }
+    if (this->useCache) {
+      // The cache columns belong to the points in the prefix of the
+      // permutation
+      reindex = {};
+      for (size_t counter = 0; counter < cacheColumns; counter++) {
+        reindex[permutation[counter]] = counter;
+      }
+      if (checkpoint.cacheRows == cacheRows &&
+          checkpoint.cacheColumns == cacheColumns &&
+          checkpoint.permutation.n_elem == data.n_cols) {
+        std::copy(checkpoint.cache.begin(), checkpoint.cache.end(), cache);
+      }
     }
+  }
 
+  void BanditPAM::shufflePermutation() {
+    const size_t N = permutation.n_elem;
+    // The cache columns belong to the points in the prefix of the
+    // permutation, so points are only reordered within the prefix and
+    // within the rest to keep the cached distances valid
+    const size_t m = this->useCache ? std::min(cacheColumns, N) : 0;
+    if (m > 0) {
+      std::shuffle(permutation.begin(), permutation.begin() + m, rng);
+    }
+    if (m < N) {
+      std::shuffle(permutation.begin() + m, permutation.end(), rng);
+    }
+    permutationIdx = 0;
+  }
+
+  void BanditPAM::partialFitBanditPAM(
+          const arma::fmat &inputData,
+          const size_t maxSwapIter) {
+    const size_t oldN = data.n_cols;
+    const size_t N = oldN + inputData.n_rows;
+
+    // NOTE: Armadillo cannot grow a matrix in place, so the existing
+    //  coordinates are copied once; no distances are recomputed for them
+    data.insert_cols(oldN, arma::trans(inputData));
+    if (this->useCache) {
+      growCache(oldN, N);
+    }
+    if (permutation.n_elem == oldN) {
+      extendPermutation(oldN, N);
+    }
+    workspace.reserve(
+            N,
+            nMedoids,
+            batchSize,
+            omp_get_max_threads(),
+            onlineSigma || reuseArmStats);
+
+    arma::urowvec medoidIndices = medoidIndicesFinal;
     arma::fmat medoidMatrix(data.n_rows, nMedoids);
-    arma::urowvec medoidIndices(nMedoids);
-    steps = 0;
-    BanditPAM::build(data, distMat, &medoidIndices, &medoidMatrix);
+    for (size_t k = 0; k < nMedoids; k++) {
+      medoidMatrix.unsafe_col(k) = data.unsafe_col(medoidIndices(k));
+    }
 
-    buildLoss = KMedoids::calcLoss(data, distMat, &medoidIndices);
+    // Assign the new points to their closest medoids
+    labels.resize(N);
+    float newLoss = 0;
+    #pragma omp parallel for if (this->parallelize) reduction(+:newLoss)
+    for (size_t i = oldN; i < N; i++) {
+      float best = std::numeric_limits<float>::infinity();
+      for (size_t k = 0; k < nMedoids; k++) {
+        float cost = KMedoids::cachedLoss(
+                data,
+                std::nullopt,
+                i,
+                medoidIndices(k),
+                0);  // 0 for MISC
+        if (cost < best) {
+          best = cost;
+          labels(i) = k;
+        }
+      }
+      newLoss += best;
+    }
 
-    medoidIndicesBuild = medoidIndices;
-    arma::urowvec assignments(data.n_cols);
-    if (nMedoids > 1) {
-      BanditPAM::swap(
-              data,
-              distMat,
-              &medoidIndices,
-              &medoidMatrix,
-              &assignments);
+    steps = 0;
+    if (maxSwapIter == 0 || nMedoids == 1) {
+      averageLoss = (averageLoss * oldN + newLoss) / N;
+      return;
     }
 
+    // Only the new points are candidates, for at most maxSwapIter iterations
+    const size_t fullMaxIter = maxIter;
+    maxIter = maxSwapIter;
+    BanditPAM::swap(
+            data,
+            std::nullopt,
+            &medoidIndices,
+            &medoidMatrix,
+            &labels,
+            oldN);
+    maxIter = fullMaxIter;
+
     medoidIndicesFinal = medoidIndices;
-    labels = assignments;
+    averageLoss = KMedoids::calcLoss(data, std::nullopt, &medoidIndices);
   }
 
-  arma::frowvec BanditPAM::buildSigma(
-          const arma::fmat &data,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
-          const arma::frowvec &bestDistances,
-          const bool useAbsolute) {
-    size_t N = data.n_cols;
-    arma::uvec referencePoints;
-    // TODO(@motiwari): Make this wraparound properly as
-    //  last batch_size elements are dropped
+  void BanditPAM::growCache(const size_t oldN, const size_t N) {
+    const size_t m = cacheColumns;
+    if (N <= cacheRows) {
+      // Rows beyond oldN were cleared when the cache was allocated
+      return;
+    }
+
+    const size_t newRows = std::max(N, 2 * cacheRows);
+    float *grown = new float[newRows * m];
+    std::copy(cache, cache + (oldN * m), grown);
+    #pragma omp parallel for if (this->parallelize)
+    for (size_t idx = oldN * m; idx < newRows * m; idx++) {
+      grown[idx] = -1;
+    }
+    delete[] cache;
+    cache = grown;
+    cacheRows = newRows;
+  }
+
+  void BanditPAM::extendPermutation(const size_t oldN, const size_t N) {
+    permutation.resize(N);
+    for (size_t i = oldN; i < N; i++) {
+      const size_t r = randomIndex(i + 1);
+      permutation(i) = permutation(r);
+      permutation(r) = i;
+
+      if (this->useCache && r < cacheColumns) {
+        // The displaced point leaves the cached prefix; point i takes over
+        // its cache column, whose distances are no longer valid
+        reindex.erase(permutation(i));
+        reindex[i] = r;
+        for (size_t row = 0; row < N; row++) {
+          cache[(cacheColumns * row) + r] = -1;
+        }
+      }
+    }
+  }
+
+  arma::uvec BanditPAM::drawReferencePoints(
+          const size_t N,
+          const size_t tmpBatchSize,
+          const bool exact) {
+    if (pointWeights.n_elem != 0 && !exact) {
+      // Sampling original rows rather than unique points draws each point
+      // in proportion to its weight, so that sample means stay unbiased
+      // estimates of the weighted mean
+      arma::uword *referenceMem = workspace.referencePoints.memptr();
+      randomSample(rowPoints.n_elem, tmpBatchSize, referenceMem);
+      for (size_t j = 0; j < tmpBatchSize; j++) {
+        referenceMem[j] = rowPoints(referenceMem[j]);
+      }
+      return arma::uvec(referenceMem, tmpBatchSize, false, true);
+    }
+    // TODO(@motiwari): Make this wraparound properly
+    //  as last batch_size elements are dropped
     if (usePerm) {
-      if ((permutationIdx + batchSize - 1) >= N) {
+      if ((permutationIdx + tmpBatchSize - 1) >= N) {
         permutationIdx = 0;
       }
-      // inclusive of both indices
-      referencePoints = permutation.subvec(
-              permutationIdx,
-              permutationIdx + batchSize - 1);
-      permutationIdx += batchSize;
-    } else {
-      referencePoints = arma::randperm(N, batchSize);
+      // view of the permutation from permutationIdx onwards
+      arma::uword *referenceMem = permutation.memptr() + permutationIdx;
+      permutationIdx += tmpBatchSize;
+      if (mappedData.isOpen()) {
+        // The next batch is known in advance, so its pages can be read from
+        // disk while this one is used
+        mappedData.prefetch(referenceMem, tmpBatchSize);
+        if (permutationIdx + tmpBatchSize <= N) {
+          mappedData.prefetch(referenceMem + tmpBatchSize, tmpBatchSize);
+        }
+      }
+      return arma::uvec(referenceMem, tmpBatchSize, false, true);
     }
 
-    arma::fvec sample(batchSize);
-    arma::frowvec updated_sigma(N);
+    randomSample(N, tmpBatchSize, workspace.referencePoints.memptr());
+    if (mappedData.isOpen()) {
+      mappedData.prefetch(workspace.referencePoints.memptr(), tmpBatchSize);
+    }
+    return arma::uvec(
+            workspace.referencePoints.memptr(), tmpBatchSize, false, true);
+  }
+
+  void BanditPAM::buildSigma(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::frowvec &bestDistances,
+          const bool useAbsolute,
+          arma::frowvec *sigma) {
+    size_t N = data.n_cols;
+    const arma::uvec referencePoints = drawReferencePoints(N, batchSize);
+
     #pragma omp parallel for if (this->parallelize)
     for (size_t i = 0; i < N; i++) {
+      // Each thread writes its samples to its own workspace column
+      arma::fvec sample(
+              workspace.sigmaSamples.colptr(omp_get_thread_num()),
+              batchSize,
+              false,
+              true);
       for (size_t j = 0; j < batchSize; j++) {
         // 0 for MISC
         float cost =
@@ -102,43 +663,34 @@ namespace km {
           sample(j) -= bestDistances(referencePoints(j));
         }
       }
-      updated_sigma(i) = arma::stddev(sample);
+      (*sigma)(i) = arma::stddev(sample);
     }
-    return updated_sigma;
   }
 
-  arma::frowvec BanditPAM::buildTarget(
+  void BanditPAM::buildTarget(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::uvec *target,
           const arma::frowvec *bestDistances,
           const bool useAbsolute,
-          const bool exact = false) {
+          const bool exact,
+          arma::frowvec *results,
+          arma::rowvec *sumSquares) {
     size_t N = data.n_cols;
     size_t tmpBatchSize = batchSize;
     if (exact) {
       tmpBatchSize = N;
     }
-    arma::frowvec results(target->n_rows, arma::fill::zeros);
-    arma::uvec referencePoints;
-    // TODO(@motiwari): Make this wraparound properly
-    //  as last batch_size elements are dropped
-    if (usePerm) {
-      if ((permutationIdx + tmpBatchSize - 1) >= N) {
-        permutationIdx = 0;
-      }
-      // inclusive of both indices
-      referencePoints = permutation.subvec(
-              permutationIdx,
-              permutationIdx + tmpBatchSize - 1);
-      permutationIdx += tmpBatchSize;
-    } else {
-      referencePoints = arma::randperm(N, tmpBatchSize);
-    }
+    const arma::uvec referencePoints =
+            drawReferencePoints(N, tmpBatchSize, exact);
+    // Exact passes visit each unique point once, so each return is weighed
+    // by the number of rows the point stands for
+    const float weightTotal = exact ? totalWeight() : tmpBatchSize;
 
     #pragma omp parallel for if (this->parallelize)
     for (size_t i = 0; i < target->n_rows; i++) {
         float total = 0;
+        double squares = 0;
       for (size_t j = 0; j < referencePoints.n_rows; j++) {
           float cost =
             KMedoids::cachedLoss(
@@ -147,101 +699,172 @@ namespace km {
                     (*target)(i),
                     referencePoints(j),
                     1);  // 1 for BUILD
-          if (useAbsolute) {
-            total += cost;
-          } else {
-            total += cost < (*bestDistances)(referencePoints(j))
-                       ? cost : (*bestDistances)(referencePoints(j));
-            total -= (*bestDistances)(referencePoints(j));
+          if (!useAbsolute) {
+            cost = cost < (*bestDistances)(referencePoints(j))
+                     ? cost : (*bestDistances)(referencePoints(j));
+            cost -= (*bestDistances)(referencePoints(j));
           }
+          const float weight = exact ? pointWeight(referencePoints(j)) : 1;
+          total += weight * cost;
+          squares += weight * static_cast<double>(cost) * cost;
+      }
+      (*results)(i) = total / weightTotal;
+      if (sumSquares != nullptr) {
+        (*sumSquares)(i) = squares;
       }
-      results(i) = total / tmpBatchSize;
     }
-    return results;
   }
 
   void BanditPAM::build(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           arma::urowvec *medoidIndices,
-          arma::fmat *medoids) {
+          arma::fmat *medoids,
+          arma::frowvec *prefixLosses) {
     size_t N = data.n_cols;
-    arma::frowvec N_mat(N);
-    N_mat.fill(N);
     size_t p = N;
     bool useAbsolute = true;
+    if (prefixLosses != nullptr) {
+      prefixLosses->set_size(nMedoids);
+    }
     arma::frowvec estimates(N, arma::fill::zeros);
     arma::frowvec bestDistances(N);
     bestDistances.fill(std::numeric_limits<float>::infinity());
     arma::frowvec sigma(N);
+    arma::rowvec m2(N);
     arma::urowvec candidates(N, arma::fill::ones);
     arma::frowvec lcbs(N);
     arma::frowvec ucbs(N);
     arma::frowvec numSamples(N, arma::fill::zeros);
     arma::frowvec exactMask(N, arma::fill::zeros);
 
+    // Assume buildConfidence is given in logspace
+    const float adjust = buildConfidence + std::log(static_cast<float>(p));
+    arma::uword *targetsMem = workspace.targets.memptr();
+    float *resultsMem = workspace.results.memptr();
+    double *squaresMem = workspace.squares.memptr();
+
+    arma::urowvec isMedoid(N, arma::fill::zeros);
+
     // TODO(@motiwari): #pragma omp parallel for if (this->parallelize)?
     for (size_t k = 0; k < nMedoids; k++) {
+      if (budgetSpent() || (prefixLosses == nullptr && fitCancelled())) {
+        // Out of budget or cancelled: seed the remaining medoids at one
+        // pass each
+        seedMedoids(
+                data,
+                distMat,
+                k,
+                &bestDistances,
+                &isMedoid,
+                medoidIndices,
+                medoids,
+                prefixLosses);
+        break;
+      }
       // instantiate medoids one-by-one
       permutationIdx = 0;
       candidates.fill(1);
       numSamples.fill(0);
       exactMask.fill(0);
       estimates.fill(0);
-      // compute std dev amongst batch of reference points
-      sigma = buildSigma(data, distMat, bestDistances, useAbsolute);
+      if (onlineSigma) {
+        // sigma is estimated from the sampling rounds themselves
+        m2.fill(0);
+      } else {
+        // compute std dev amongst batch of reference points
+        buildSigma(data, distMat, bestDistances, useAbsolute, &sigma);
+      }
 
+      bool tied = false;
       while (arma::sum(candidates) > precision) {
-        // TODO(@motiwari): Do not need a matrix for this comparison,
-        //  use broadcasting
-        arma::umat compute_exactly =
-                ((numSamples + batchSize) >= N_mat) != exactMask;
-        if (arma::accu(compute_exactly) > 0) {
-          arma::uvec targets = find(compute_exactly);
-          arma::frowvec result = buildTarget(
+        // Narrows the intervals as the budget runs out
+        const float roundAdjust = adjust * budgetConfidence();
+
+        // compute exactly if it's been sampled more than N times and
+        // hasn't been computed exactly already
+        size_t T = 0;
+        for (size_t i = 0; i < N; i++) {
+          if (((numSamples(i) + batchSize) >= N) != (exactMask(i) != 0)) {
+            targetsMem[T++] = i;
+          }
+        }
+        if (T > 0) {
+          const arma::uvec targets(targetsMem, T, false, true);
+          arma::frowvec result(resultsMem, T, false, true);
+          buildTarget(
                   data,
                   distMat,
                   &targets,
                   &bestDistances,
                   useAbsolute,
-                  (true ? N > 0 : false));
-          estimates.cols(targets) = result;
-          ucbs.cols(targets) = result;
-          lcbs.cols(targets) = result;
-          exactMask.cols(targets).fill(1);
-          numSamples.cols(targets) += N;
-          candidates.cols(targets).fill(0);
+                  true,
+                  &result);
+          for (size_t t = 0; t < T; t++) {
+            const size_t i = targets(t);
+            estimates(i) = result(t);
+            ucbs(i) = result(t);
+            lcbs(i) = result(t);
+            exactMask(i) = 1;
+            numSamples(i) += N;
+            candidates(i) = 0;
+          }
         }
         if (arma::sum(candidates) < precision) {
           break;
         }
-        arma::uvec targets = arma::find(candidates);
-        arma::frowvec result = buildTarget(
+
+        T = 0;
+        for (size_t i = 0; i < N; i++) {
+          if (candidates(i)) {
+            targetsMem[T++] = i;
+          }
+        }
+        const arma::uvec targets(targetsMem, T, false, true);
+        arma::frowvec result(resultsMem, T, false, true);
+        arma::rowvec squares(squaresMem, onlineSigma ? T : 0, false, true);
+        buildTarget(
                 data,
                 distMat,
                 &targets,
                 &bestDistances,
                 useAbsolute,
-                false);
-        // update the running average
-        estimates.cols(targets) =
-                ((numSamples.cols(targets) % estimates.cols(targets)) +
-                 (result * batchSize)) /
-                (batchSize + numSamples.cols(targets));
-        numSamples.cols(targets) += batchSize;
-        arma::frowvec adjust(targets.n_rows);
-        adjust.fill(p);
-        // Assume buildConfidence is given in logspace
-        adjust = buildConfidence + arma::log(adjust);
-        arma::frowvec confBoundDelta =
-                sigma.cols(targets) %
-                arma::sqrt(adjust / numSamples.cols(targets));
-        ucbs.cols(targets) = estimates.cols(targets) + confBoundDelta;
-        lcbs.cols(targets) = estimates.cols(targets) - confBoundDelta;
-        candidates = (lcbs < ucbs.min()) && (exactMask == 0);
-      }
-
-      medoidIndices->at(k) = lcbs.index_min();
+                false,
+                &result,
+                onlineSigma ? &squares : nullptr);
+        for (size_t t = 0; t < T; t++) {
+          const size_t i = targets(t);
+          if (onlineSigma) {
+            sigma(i) = mergeVariance(
+                    numSamples(i),
+                    estimates(i),
+                    batchSize,
+                    result(t),
+                    squares(t),
+                    &m2(i));
+          }
+          // update the running average
+          estimates(i) =
+                  ((numSamples(i) * estimates(i)) + (result(t) * batchSize)) /
+                  (batchSize + numSamples(i));
+          numSamples(i) += batchSize;
+          const float confBoundDelta =
+                  sigma(i) * std::sqrt(roundAdjust / numSamples(i));
+          ucbs(i) = estimates(i) + confBoundDelta;
+          lcbs(i) = estimates(i) - confBoundDelta;
+        }
+        const float minUcb = ucbs.min();
+        for (size_t i = 0; i < N; i++) {
+          candidates(i) = (lcbs(i) < minUcb) && (exactMask(i) == 0);
+        }
+        if (withinTolerance(lcbs, candidates, minUcb)) {
+          tied = true;
+          break;
+        }
+      }
+
+      medoidIndices->at(k) = tied ? ucbs.index_min() : lcbs.index_min();
+      isMedoid((*medoidIndices)(k)) = 1;
       medoids->unsafe_col(k) = data.unsafe_col((*medoidIndices)(k));
 
       // don't need to do this on final iteration
@@ -257,43 +880,247 @@ namespace km {
           bestDistances(i) = cost;
         }
       }
+      if (prefixLosses != nullptr) {
+        // The loss of the first k + 1 medoids, for sweeps over k
+        (*prefixLosses)(k) = meanLoss(bestDistances);
+      }
       // use difference of loss for sigma and sampling, not absolute
       useAbsolute = false;
+      if (finishBuildStep(
+              k, bestDistances, medoidIndices, medoids, prefixLosses)) {
+        break;
+      }
     }
   }
 
-  arma::fmat BanditPAM::swapSigma(
+  void BanditPAM::buildLAB(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids) {
+    size_t N = data.n_cols;
+    // Subsample size suggested for LAB by Schubert and Rousseeuw
+    size_t sampleSize = std::min(
+            N,
+            static_cast<size_t>(10 + std::ceil(std::sqrt(N))));
+    arma::frowvec bestDistances(N);
+    bestDistances.fill(std::numeric_limits<float>::infinity());
+    arma::urowvec isMedoid(N, arma::fill::zeros);
+    arma::uvec sample(sampleSize);
+    arma::frowvec totals(sampleSize);
+
+    for (size_t k = 0; k < nMedoids; k++) {
+      if (budgetSpent() || fitCancelled()) {
+        seedMedoids(
+                data,
+                distMat,
+                k,
+                &bestDistances,
+                &isMedoid,
+                medoidIndices,
+                medoids);
+        break;
+      }
+      // Draw a subsample of the points that are not yet medoids
+      arma::uvec draw(std::min(N, sampleSize + k));
+      randomSample(N, draw.n_elem, draw.memptr());
+      size_t S = 0;
+      for (size_t i = 0; i < draw.n_elem && S < sampleSize; i++) {
+        if (!isMedoid(draw(i))) {
+          sample(S++) = draw(i);
+        }
+      }
+
+      // Evaluate each candidate's loss on the subsample only
+      #pragma omp parallel for if (this->parallelize)
+      for (size_t i = 0; i < S; i++) {
+        float total = 0;
+        for (size_t j = 0; j < S; j++) {
+          float cost = KMedoids::cachedLoss(
+                  data,
+                  distMat,
+                  sample(i),
+                  sample(j),
+                  1);  // 1 for BUILD
+          total += pointWeight(sample(j)) *
+                   std::fmin(cost, bestDistances(sample(j)));
+        }
+        totals(i) = total;
+      }
+
+      medoidIndices->at(k) = sample(totals.head(S).index_min());
+      isMedoid((*medoidIndices)(k)) = 1;
+      medoids->unsafe_col(k) = data.unsafe_col((*medoidIndices)(k));
+
+      #pragma omp parallel for if (this->parallelize)
+      for (size_t i = 0; i < N; i++) {
+        float cost = KMedoids::cachedLoss(
+                data,
+                distMat,
+                i,
+                (*medoidIndices)(k),
+                0);  // 0 for MISC
+        if (cost < bestDistances(i)) {
+          bestDistances(i) = cost;
+        }
+      }
+      finishBuildStep(k, bestDistances, medoidIndices, medoids, nullptr);
+    }
+  }
+
+  void BanditPAM::buildKMedoidsPlusPlus(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids) {
+    size_t N = data.n_cols;
+    arma::frowvec bestDistances(N);
+    bestDistances.fill(std::numeric_limits<float>::infinity());
+    arma::urowvec isMedoid(N, arma::fill::zeros);
+    seedMedoids(
+            data,
+            distMat,
+            0,
+            &bestDistances,
+            &isMedoid,
+            medoidIndices,
+            medoids);
+  }
+
+  void BanditPAM::seedMedoids(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const size_t first,
+          arma::frowvec *bestDistances,
+          arma::urowvec *isMedoid,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids,
+          arma::frowvec *prefixLosses) {
+    size_t N = data.n_cols;
+    for (size_t k = first; k < nMedoids; k++) {
+      size_t next = 0;
+      if (k == 0) {
+        // A uniform row, so that each point is drawn in proportion to its
+        // weight
+        next = pointWeights.n_elem == 0
+               ? randomIndex(N) : rowPoints(randomIndex(rowPoints.n_elem));
+      } else {
+        // Sample proportionally to the weighted distance to the closest
+        // medoid
+        double total = 0;
+        for (size_t i = 0; i < N; i++) {
+          total += pointWeight(i) * (*bestDistances)(i);
+        }
+        if (total > 0) {
+          const double threshold = randomUniform() * total;
+          double cumulative = 0;
+          for (size_t i = 0; i < N; i++) {
+            if ((*isMedoid)(i) || (*bestDistances)(i) <= 0) {
+              continue;
+            }
+            next = i;
+            cumulative += pointWeight(i) * (*bestDistances)(i);
+            if (cumulative >= threshold) {
+              break;
+            }
+          }
+        } else {
+          // Every point coincides with a medoid; take any other point
+          while ((*isMedoid)(next)) {
+            next++;
+          }
+        }
+      }
+
+      medoidIndices->at(k) = next;
+      (*isMedoid)(next) = 1;
+      medoids->unsafe_col(k) = data.unsafe_col(next);
+
+      #pragma omp parallel for if (this->parallelize)
+      for (size_t i = 0; i < N; i++) {
+        float cost = KMedoids::cachedLoss(
+                data,
+                distMat,
+                i,
+                next,
+                1);  // 1 for BUILD
+        if (cost < (*bestDistances)(i)) {
+          (*bestDistances)(i) = cost;
+        }
+      }
+      if (prefixLosses != nullptr) {
+        (*prefixLosses)(k) = meanLoss(*bestDistances);
+      }
+      if (finishBuildStep(
+              k, *bestDistances, medoidIndices, medoids, prefixLosses)) {
+        break;
+      }
+    }
+  }
+
+  float BanditPAM::mergeVariance(
+          const double count,
+          const double mean,
+          const double batchCount,
+          const double batchMean,
+          const double batchSumSquares,
+          double *m2) {
+    // Chan et al.'s pairwise form of Welford's update: the batch's sum of
+    // squared deviations is merged with that of the earlier samples. The
+    // batch's is the difference of two close sums, so it is taken in double
+    // precision, where it only rounds below zero when the batch is constant
+    const double batchM2 = std::fmax(
+            0.0,
+            batchSumSquares - batchCount * batchMean * batchMean);
+    const double delta = batchMean - mean;
+    const double total = count + batchCount;
+    *m2 += batchM2 + delta * delta * count * batchCount / total;
+    return static_cast<float>(std::sqrt(*m2 / (total - 1)));
+  }
+
+  void BanditPAM::addSquaredReturns(
+          const float cost,
+          const float bestDistance,
+          const float secondBestDistance,
+          const size_t assignment,
+          const size_t col,
+          const double sign,
+          arma::mat *sumSquares) {
+    // Every arm gains cost - bestDistance when cost is smaller, except the
+    // arm replacing the point's own medoid, which falls back to the second
+    // best distance otherwise
+    const double common = std::fmin(cost, bestDistance) - bestDistance;
+    const double own = std::fmin(cost, secondBestDistance) - bestDistance;
+    if (common != 0) {
+      sumSquares->col(col) += sign * common * common;
+    }
+    (*sumSquares)(assignment, col) += sign * (own * own - common * common);
+  }
+
+  void BanditPAM::swapSigma(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::frowvec *bestDistances,
           const arma::frowvec *secondBestDistances,
-          const arma::urowvec *assignments) {
+          const arma::urowvec *assignments,
+          arma::fmat *sigma,
+          const size_t firstCandidate) {
     size_t N = data.n_cols;
     size_t K = nMedoids;
-    arma::fmat updated_sigma(K, N, arma::fill::zeros);
-    arma::uvec referencePoints;
-    // TODO(@motiwari): Make this wraparound properly
-    //  as last batch_size elements are dropped
-    if (usePerm) {
-      if ((permutationIdx + batchSize - 1) >= N) {
-        permutationIdx = 0;
-      }
-      // inclusive of both indices
-      referencePoints = permutation.subvec(
-              permutationIdx,
-              permutationIdx + batchSize - 1);
-      permutationIdx += batchSize;
-    } else {
-      referencePoints = arma::randperm(N, batchSize);
-    }
+    const arma::uvec referencePoints = drawReferencePoints(N, batchSize);
 
-    arma::fvec sample(batchSize);
     // for each considered swap
     #pragma omp parallel for if (this->parallelize)
-    for (size_t i = 0; i < K * N; i++) {
+    for (size_t i = K * firstCandidate; i < K * N; i++) {
       // extract data point of swap
       size_t n = i / K;
       size_t k = i % K;
+      // Each thread writes its samples to its own workspace column
+      arma::fvec sample(
+              workspace.sigmaSamples.colptr(omp_get_thread_num()),
+              batchSize,
+              false,
+              true);
 
       // calculate change in loss for some subset of the data
       for (size_t j = 0; j < batchSize; j++) {
@@ -317,12 +1144,11 @@ namespace km {
         }
         sample(j) -= (*bestDistances)(referencePoints(j));
       }
-      updated_sigma(k, n) = arma::stddev(sample);
+      (*sigma)(k, n) = arma::stddev(sample);
     }
-    return updated_sigma;
   }
 
-  arma::fmat BanditPAM::swapTarget(
+  void BanditPAM::swapTarget(
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::urowvec *medoidIndices,
@@ -330,10 +1156,15 @@ namespace km {
           const arma::frowvec *bestDistances,
           const arma::frowvec *secondBestDistances,
           const arma::urowvec *assignments,
-          const bool exact = false) {
+          const bool exact,
+          arma::fmat *results,
+          arma::mat *sumSquares) {
     const size_t N = data.n_cols;
     const size_t T = targets->n_rows;
-    arma::fmat results(nMedoids, T, arma::fill::zeros);
+    results->zeros();
+    if (sumSquares != nullptr) {
+      sumSquares->zeros();
+    }
 
     // Targets should be a list of indices for target CANDIDATE points
     // Then update all corresponding EXISTING MEDOID indices targets.
@@ -357,23 +1188,8 @@ namespace km {
     if (exact) {
       tmpBatchSize = N;
     }
-
-    arma::uvec referencePoints;
-    // TODO(@motiwari): Make this wraparound properly
-    //  as last batch_size elements are dropped
-    // TODO(@motiwari): Break this duplicated code into a function
-    if (usePerm) {
-      if ((permutationIdx + tmpBatchSize - 1) >= N) {
-        permutationIdx = 0;
-      }
-      // inclusive of both indices
-      referencePoints = permutation.subvec(
-              permutationIdx,
-              permutationIdx + tmpBatchSize - 1);
-      permutationIdx += tmpBatchSize;
-    } else {
-      referencePoints = arma::randperm(N, tmpBatchSize);
-    }
+    const arma::uvec referencePoints =
+            drawReferencePoints(N, tmpBatchSize, exact);
 
     // TODO(@motiwari): Declare variables outside of loops
     #pragma omp parallel for if (this->parallelize)
@@ -388,27 +1204,39 @@ namespace km {
                         referencePoints(j),
                         2);  // 2 for SWAP
         size_t k = (*assignments)(referencePoints(j));
+        // Exact passes weigh each unique point by its number of rows
+        const float weight = exact ? pointWeight(referencePoints(j)) : 1;
         if (cost < (*bestDistances)(referencePoints(j))) {
           // We might be able to change this to
           // .eachrow(every column but k)
           // since arma does this in-place and it should not introduce
           // complexity
-          results.col(i) +=
-                  cost - (*bestDistances)(referencePoints(j));
+          results->col(i) +=
+                  weight * (cost - (*bestDistances)(referencePoints(j)));
         }
 
         // If cost < bd, this second term will subtract off the "new cost"
         // added by the all-column call above inside the if
-        results(k, i) +=
+        (*results)(k, i) += weight * (
                 std::fmin(cost,
                           (*secondBestDistances)(referencePoints(j))) -
-                std::fmin(cost, (*bestDistances)(referencePoints(j)));
+                std::fmin(cost, (*bestDistances)(referencePoints(j))));
+
+        if (sumSquares != nullptr) {
+          addSquaredReturns(
+                  cost,
+                  (*bestDistances)(referencePoints(j)),
+                  (*secondBestDistances)(referencePoints(j)),
+                  k,
+                  i,
+                  1,
+                  sumSquares);
+        }
       }
     }
     // TODO(@motiwari): we can probably avoid this division
     //  if we look at total loss, not average loss
-    results /= tmpBatchSize;
-    return results;
+    *results /= exact ? totalWeight() : tmpBatchSize;
   }
 
   void BanditPAM::swap(
@@ -416,11 +1244,18 @@ namespace km {
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           arma::urowvec *medoidIndices,
           arma::fmat *medoids,
-          arma::urowvec *assignments) {
+          arma::urowvec *assignments,
+          const size_t firstCandidate) {
     size_t N = data.n_cols;
     size_t p = N;
+    // Carried arm statistics assume that every point is a candidate
+    const bool reuse = reuseArmStats && firstCandidate == 0;
 
     arma::fmat sigma(nMedoids, N, arma::fill::zeros);
+    arma::mat m2;
+    if (onlineSigma && !reuse) {
+      m2.set_size(nMedoids, N);
+    }
 
     arma::frowvec bestDistances(N);
     arma::frowvec secondBestDistances(N);
@@ -432,6 +1267,12 @@ namespace km {
     arma::fmat ucbs(nMedoids, N);
     arma::umat numSamples(nMedoids, N, arma::fill::zeros);
 
+    // Assume swapConfidence is given in logspace
+    const float adjust = swapConfidence + std::log(static_cast<float>(p));
+    arma::uword *targetsMem = workspace.targets.memptr();
+    float *resultsMem = workspace.results.memptr();
+    double *squaresMem = workspace.squares.memptr();
+
     // calculate quantities needed for swap, bestDistances and sigma
     calcBestDistancesSwap(
             data,
@@ -442,116 +1283,225 @@ namespace km {
             assignments,
             swapPerformed);
 
+    // Arm statistics carried across iterations when reuseArmStats is set:
+    // the sums of each arm's returns and squared returns over a prefix of
+    // the permutation, the prefix length of each candidate, and the state
+    // the sums were taken at. Sigma is estimated from the squared returns,
+    // so no separate sigma batches are drawn
+    arma::mat armSums;
+    arma::mat armSumSquares;
+    arma::uvec armSamples;
+    arma::frowvec statsBestDistances;
+    arma::frowvec statsSecondBestDistances;
+    arma::urowvec statsAssignments;
+    if (reuse) {
+      armSums.zeros(nMedoids, N);
+      armSumSquares.zeros(nMedoids, N);
+      armSamples.zeros(N);
+      statsBestDistances = bestDistances;
+      statsSecondBestDistances = secondBestDistances;
+      statsAssignments = *assignments;
+    }
+
     // continue making swaps while loss is decreasing
     while (swapPerformed && steps < maxIter) {
         steps++;
         permutationIdx = 0;
+        bool tied = false;
 
-        sigma = swapSigma(
-                data,
-                distMat,
-                &bestDistances,
-                &secondBestDistances,
-                assignments);
+        if (!onlineSigma && !reuse) {
+          swapSigma(
+                  data,
+                  distMat,
+                  &bestDistances,
+                  &secondBestDistances,
+                  assignments,
+                  &sigma,
+                  firstCandidate);
+        }
 
-        // Reset variables when starting a new swap
-        candidates.fill(1);
-        exactMask.fill(0);
-        estimates.fill(0);
-        numSamples.fill(0);
-
-        // while there is at least one candidate (float comparison issues)
-        while (arma::accu(candidates) > 1.5) {
-          // compute exactly if it's been samples more than N times and
-          // hasn't been computed exactly already
-          arma::umat compute_exactly =
-                  ((numSamples + batchSize) >= N) != (exactMask);
-
-          // Get unique candidate medoids from the candidates (second index)
-          // Store all k x T in estimates
-          // TODO(@motiwari): Move this declaration outside loop
-          // Need unique values over second index
-          // Sum the different columns
-          // if any index appears in at least one, compute it exactly
-          // TODO(@motiwari): make sure we're only computing exactly
-          // for the relevant candidates
-          arma::uvec compute_exactly_targets =
-                  arma::find(arma::sum(compute_exactly, 0) >= 1);
-
-          if (compute_exactly_targets.size() > 0) {
-            arma::fmat result = swapTarget(
+        if (reuse) {
+          // Only the contributions of reference points whose closest
+          // medoids changed are recomputed; the rest carry over
+          swapCorrectArmStats(
+                  data,
+                  distMat,
+                  &bestDistances,
+                  &secondBestDistances,
+                  assignments,
+                  &armSamples,
+                  &statsBestDistances,
+                  &statsSecondBestDistances,
+                  &statsAssignments,
+                  &armSums,
+                  &armSumSquares);
+          tied = swapReusingArmStats(
+                  data,
+                  distMat,
+                  &bestDistances,
+                  &secondBestDistances,
+                  assignments,
+                  &sigma,
+                  &armSums,
+                  &armSumSquares,
+                  &armSamples,
+                  &candidates,
+                  &exactMask,
+                  &estimates,
+                  &lcbs,
+                  &ucbs);
+        } else {
+          // Reset variables when starting a new swap
+          candidates.fill(1);
+          exactMask.fill(0);
+          estimates.fill(0);
+          numSamples.fill(0);
+          if (onlineSigma) {
+            m2.fill(0);
+          }
+          if (firstCandidate > 0) {
+            // Points before firstCandidate are treated as already computed
+            // arms that can never be selected
+            candidates.cols(0, firstCandidate - 1).zeros();
+            exactMask.cols(0, firstCandidate - 1).ones();
+            numSamples.cols(0, firstCandidate - 1).fill(N);
+            lcbs.cols(0, firstCandidate - 1).fill(
+                    std::numeric_limits<float>::infinity());
+            ucbs.cols(0, firstCandidate - 1).fill(
+                    std::numeric_limits<float>::infinity());
+          }
+
+          // while there is at least one candidate (float comparison issues)
+          while (arma::accu(candidates) > 1.5) {
+            // Narrows the intervals as the budget runs out
+            const float roundAdjust = adjust * budgetConfidence();
+
+            // compute exactly if it's been samples more than N times and
+            // hasn't been computed exactly already.
+            // If any arm of a candidate (column) needs to be computed
+            // exactly, compute the whole column exactly
+            // TODO(@motiwari): make sure we're only computing exactly
+            // for the relevant candidates
+            size_t T = 0;
+            for (size_t n = 0; n < N; n++) {
+              for (size_t k = 0; k < nMedoids; k++) {
+                if (((numSamples(k, n) + batchSize) >= N) !=
+                    (exactMask(k, n) != 0)) {
+                  targetsMem[T++] = n;
+                  break;
+                }
+              }
+            }
+
+            if (T > 0) {
+              const arma::uvec compute_exactly_targets(
+                      targetsMem, T, false, true);
+              arma::fmat result(resultsMem, nMedoids, T, false, true);
+              swapTarget(
+                      data,
+                      distMat,
+                      medoidIndices,
+                      &compute_exactly_targets,
+                      &bestDistances,
+                      &secondBestDistances,
+                      assignments,
+                      true,
+                      &result);
+
+              // result will be k x T
+              // Now update the correct indices
+              for (size_t t = 0; t < T; t++) {
+                const size_t n = compute_exactly_targets(t);
+                for (size_t k = 0; k < nMedoids; k++) {
+                  estimates(k, n) = result(k, t);
+                  ucbs(k, n) = result(k, t);
+                  lcbs(k, n) = result(k, t);
+                  exactMask(k, n) = 1;
+                  numSamples(k, n) += N;
+                }
+              }
+              const float minUcb = ucbs.min();
+              for (size_t i = 0; i < candidates.n_elem; i++) {
+                candidates(i) = (lcbs(i) < minUcb) && (exactMask(i) == 0);
+              }
+            }
+            if (arma::accu(candidates) < precision) {
+              break;
+            }
+
+            // candidate_targets should be of size T
+            // if any index appears in at least one column, sample it
+            T = 0;
+            for (size_t n = 0; n < N; n++) {
+              for (size_t k = 0; k < nMedoids; k++) {
+                if (candidates(k, n)) {
+                  targetsMem[T++] = n;
+                  break;
+                }
+              }
+            }
+            const arma::uvec candidate_targets(targetsMem, T, false, true);
+
+            // result will be k x T
+            arma::fmat result(resultsMem, nMedoids, T, false, true);
+            arma::mat squares(
+                    squaresMem, nMedoids, onlineSigma ? T : 0, false, true);
+            swapTarget(
                     data,
                     distMat,
                     medoidIndices,
-                    &compute_exactly_targets,
+                    &candidate_targets,
                     &bestDistances,
                     &secondBestDistances,
                     assignments,
-                    (true ? N > 0 : false));
-
-            // result will be k x T
-            // Now update the correct indices
-            estimates.cols(compute_exactly_targets) = result;
-            ucbs.cols(compute_exactly_targets) = result;
-            lcbs.cols(compute_exactly_targets) = result;
-            exactMask.cols(compute_exactly_targets).fill(1);
-            numSamples.cols(compute_exactly_targets) += N;
-            candidates = (lcbs < ucbs.min()) && (exactMask == 0);
-          }
-          if (arma::accu(candidates) < precision) {
-            break;
-          }
+                    false,
+                    &result,
+                    onlineSigma ? &squares : nullptr);
 
-          // candidate_targets should be of size T
-          // Sum the different columns
-          // if any index appears in at least one column, sample it
-          arma::uvec candidate_targets = arma::find(
-                  arma::sum(candidates, 0) >= 1);
+            // numSamples should be k x N
+            // select the T of N columns that are candidates
+            for (size_t t = 0; t < T; t++) {
+              const size_t n = candidate_targets(t);
+              for (size_t k = 0; k < nMedoids; k++) {
+                if (onlineSigma) {
+                  // The first batch of each iteration also estimates sigma
+                  sigma(k, n) = mergeVariance(
+                          numSamples(k, n),
+                          estimates(k, n),
+                          batchSize,
+                          result(k, t),
+                          squares(k, t),
+                          &m2(k, n));
+                }
+                estimates(k, n) =
+                        ((numSamples(k, n) * estimates(k, n))
+                         + (result(k, t) * batchSize)) /
+                        (batchSize + numSamples(k, n));
+                numSamples(k, n) += batchSize;
+                const float confBoundDelta =
+                        sigma(k, n) * std::sqrt(roundAdjust / numSamples(k, n));
+                ucbs(k, n) = estimates(k, n) + confBoundDelta;
+                lcbs(k, n) = estimates(k, n) - confBoundDelta;
+              }
+            }
 
-          // result will be k x T
-          arma::fmat result = swapTarget(
-                  data,
-                  distMat,
-                  medoidIndices,
-                  &candidate_targets,
-                  &bestDistances,
-                  &secondBestDistances,
-                  assignments,
-                  false);
-
-          // candidate_targets should be of size T, 1
-          estimates.cols(candidate_targets) =
-                  ((numSamples.cols(candidate_targets)
-                    % estimates.cols(candidate_targets))
-                   + (result * batchSize)) / (batchSize +
-                                              numSamples.cols(
-                                                      candidate_targets));
-
-          // numSamples should be k x N
-          // select the T of N columns that are candidates
-          numSamples.cols(candidate_targets) += batchSize;
-
-          arma::fmat adjust(nMedoids, candidate_targets.size());
-          // TODO(@motiwari): Move this ::fill to the previous line
-          adjust.fill(p);
-          // Assume swapConfidence is given in logspace
-          adjust = swapConfidence + arma::log(adjust);
-          arma::fmat confBoundDelta = sigma.cols(candidate_targets) %
-                                      arma::sqrt(adjust / numSamples.cols(
-                                              candidate_targets));
-          ucbs.cols(candidate_targets) = estimates.cols(candidate_targets)
-                                         + confBoundDelta;
-          lcbs.cols(candidate_targets) = estimates.cols(candidate_targets)
-                                         - confBoundDelta;
-
-          candidates = (lcbs < ucbs.min()) && (exactMask == 0);
-      }
+            const float minUcb = ucbs.min();
+            for (size_t i = 0; i < candidates.n_elem; i++) {
+              candidates(i) = (lcbs(i) < minUcb) && (exactMask(i) == 0);
+            }
+            if (withinTolerance(lcbs, candidates, minUcb)) {
+              tied = true;
+              break;
+            }
+          }
+        }
 
       // Perform the medoid switch
-      arma::uword newMedoid = lcbs.index_min();
+      arma::uword newMedoid = tied ? ucbs.index_min() : lcbs.index_min();
       size_t k = newMedoid % nMedoids;
       size_t n = newMedoid / nMedoids;
       swapPerformed = (*medoidIndices)(k) != n;
+      const size_t swappedCluster = (*assignments)(n);
 
       if (swapPerformed) {
         (*medoidIndices)(k) = n;
@@ -566,6 +1516,350 @@ namespace km {
               &secondBestDistances,
               assignments,
               swapPerformed);
+
+      if (swapPerformed && maxSwapsPerIter > 1) {
+        swapNonConflicting(
+                data,
+                distMat,
+                &estimates,
+                &ucbs,
+                k,
+                swappedCluster,
+                medoidIndices,
+                medoids,
+                &bestDistances,
+                &secondBestDistances,
+                assignments);
+      }
+
+      reportProgress("swap", steps, maxIter, meanLoss(bestDistances));
+      saveCheckpoint(*medoidIndices);
+      if (fitCancelled() || budgetSpent()) {
+        break;
+      }
+    }
+  }
+
+  void BanditPAM::swapTargetWindow(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::uvec *targets,
+          const arma::uvec *armSamples,
+          const arma::frowvec *bestDistances,
+          const arma::frowvec *secondBestDistances,
+          const arma::urowvec *assignments,
+          arma::fmat *results,
+          arma::mat *sumSquares) {
+    const size_t N = data.n_cols;
+    const size_t T = targets->n_rows;
+    results->zeros();
+    if (sumSquares != nullptr) {
+      sumSquares->zeros();
+    }
+
+    #pragma omp parallel for if (this->parallelize)
+    for (size_t i = 0; i < T; i++) {
+      const size_t n = (*targets)(i);
+      const size_t end =
+              std::min(N, static_cast<size_t>((*armSamples)(n) + batchSize));
+      for (size_t pos = (*armSamples)(n); pos < end; pos++) {
+        const size_t j = permutation(pos);
+        float cost = KMedoids::cachedLoss(data, distMat, n, j, 2);  // SWAP
+        if (cost < (*bestDistances)(j)) {
+          results->col(i) += cost - (*bestDistances)(j);
+        }
+        (*results)((*assignments)(j), i) +=
+                std::fmin(cost, (*secondBestDistances)(j)) -
+                std::fmin(cost, (*bestDistances)(j));
+        if (sumSquares != nullptr) {
+          addSquaredReturns(
+                  cost,
+                  (*bestDistances)(j),
+                  (*secondBestDistances)(j),
+                  (*assignments)(j),
+                  i,
+                  1,
+                  sumSquares);
+        }
+      }
+    }
+  }
+
+  void BanditPAM::swapCorrectArmStats(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::frowvec *bestDistances,
+          const arma::frowvec *secondBestDistances,
+          const arma::urowvec *assignments,
+          const arma::uvec *armSamples,
+          arma::frowvec *statsBestDistances,
+          arma::frowvec *statsSecondBestDistances,
+          arma::urowvec *statsAssignments,
+          arma::mat *armSums,
+          arma::mat *armSumSquares) {
+    const size_t N = data.n_cols;
+
+    // Positions in the permutation of the reference points that changed,
+    // in increasing order so that each arm can stop at its prefix length
+    arma::uword *changedMem = workspace.targets.memptr();
+    size_t C = 0;
+    for (size_t pos = 0; pos < N; pos++) {
+      const size_t j = permutation(pos);
+      if ((*bestDistances)(j) != (*statsBestDistances)(j) ||
+          (*secondBestDistances)(j) != (*statsSecondBestDistances)(j) ||
+          (*assignments)(j) != (*statsAssignments)(j)) {
+        changedMem[C++] = pos;
+      }
+    }
+
+    if (C > 0) {
+      #pragma omp parallel for if (this->parallelize)
+      for (size_t n = 0; n < N; n++) {
+        for (size_t c = 0; c < C && changedMem[c] < (*armSamples)(n); c++) {
+          const size_t j = permutation(changedMem[c]);
+          float cost = KMedoids::cachedLoss(data, distMat, n, j, 2);  // SWAP
+
+          // Remove the return under the old medoids...
+          if (cost < (*statsBestDistances)(j)) {
+            armSums->col(n) -= cost - (*statsBestDistances)(j);
+          }
+          (*armSums)((*statsAssignments)(j), n) -=
+                  std::fmin(cost, (*statsSecondBestDistances)(j)) -
+                  std::fmin(cost, (*statsBestDistances)(j));
+
+          // ...and add the return under the current ones
+          if (cost < (*bestDistances)(j)) {
+            armSums->col(n) += cost - (*bestDistances)(j);
+          }
+          (*armSums)((*assignments)(j), n) +=
+                  std::fmin(cost, (*secondBestDistances)(j)) -
+                  std::fmin(cost, (*bestDistances)(j));
+
+          addSquaredReturns(
+                  cost,
+                  (*statsBestDistances)(j),
+                  (*statsSecondBestDistances)(j),
+                  (*statsAssignments)(j),
+                  n,
+                  -1,
+                  armSumSquares);
+          addSquaredReturns(
+                  cost,
+                  (*bestDistances)(j),
+                  (*secondBestDistances)(j),
+                  (*assignments)(j),
+                  n,
+                  1,
+                  armSumSquares);
+        }
+      }
+    }
+
+    *statsBestDistances = *bestDistances;
+    *statsSecondBestDistances = *secondBestDistances;
+    *statsAssignments = *assignments;
+  }
+
+  void BanditPAM::swapArmBounds(
+          const size_t n,
+          const size_t N,
+          const float adjust,
+          arma::fmat *sigma,
+          const arma::mat *armSums,
+          const arma::mat *armSumSquares,
+          const arma::uvec *armSamples,
+          arma::umat *exactMask,
+          arma::fmat *estimates,
+          arma::fmat *lcbs,
+          arma::fmat *ucbs) {
+    const size_t samples = (*armSamples)(n);
+    for (size_t k = 0; k < nMedoids; k++) {
+      if (samples == 0) {
+        (*estimates)(k, n) = 0;
+        (*lcbs)(k, n) = -std::numeric_limits<float>::infinity();
+        (*ucbs)(k, n) = std::numeric_limits<float>::infinity();
+        (*exactMask)(k, n) = 0;
+        continue;
+      }
+
+      (*estimates)(k, n) = (*armSums)(k, n) / samples;
+      if (samples >= N) {
+        (*lcbs)(k, n) = (*estimates)(k, n);
+        (*ucbs)(k, n) = (*estimates)(k, n);
+        (*exactMask)(k, n) = 1;
+      } else {
+        // Sample standard deviation over the prefix, which is unbounded
+        // until the prefix holds two returns
+        const double m2 = (*armSumSquares)(k, n) -
+                (*armSums)(k, n) * (*armSums)(k, n) / samples;
+        (*sigma)(k, n) = samples > 1
+                ? std::sqrt(std::fmax(0.0, m2) / (samples - 1))
+                : std::numeric_limits<float>::infinity();
+        const float confBoundDelta =
+                (*sigma)(k, n) * std::sqrt(adjust / samples);
+        (*lcbs)(k, n) = (*estimates)(k, n) - confBoundDelta;
+        (*ucbs)(k, n) = (*estimates)(k, n) + confBoundDelta;
+        (*exactMask)(k, n) = 0;
+      }
+    }
+  }
+
+  bool BanditPAM::swapReusingArmStats(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::frowvec *bestDistances,
+          const arma::frowvec *secondBestDistances,
+          const arma::urowvec *assignments,
+          arma::fmat *sigma,
+          arma::mat *armSums,
+          arma::mat *armSumSquares,
+          arma::uvec *armSamples,
+          arma::umat *candidates,
+          arma::umat *exactMask,
+          arma::fmat *estimates,
+          arma::fmat *lcbs,
+          arma::fmat *ucbs) {
+    const size_t N = data.n_cols;
+    // Assume swapConfidence is given in logspace
+    const float adjust = swapConfidence + std::log(static_cast<float>(N));
+    arma::uword *targetsMem = workspace.targets.memptr();
+    float *resultsMem = workspace.results.memptr();
+    double *squaresMem = workspace.squares.memptr();
+
+    // Narrowed as the budget runs out
+    float roundAdjust = adjust * budgetConfidence();
+    for (size_t n = 0; n < N; n++) {
+      swapArmBounds(
+              n, N, roundAdjust, sigma, armSums, armSumSquares, armSamples,
+              exactMask, estimates, lcbs, ucbs);
+    }
+    float minUcb = ucbs->min();
+    for (size_t i = 0; i < candidates->n_elem; i++) {
+      (*candidates)(i) = ((*lcbs)(i) < minUcb) && ((*exactMask)(i) == 0);
+    }
+
+    // while there is at least one candidate (float comparison issues)
+    while (arma::accu(*candidates) > 1.5) {
+      roundAdjust = adjust * budgetConfidence();
+
+      // Every candidate continues from where its prefix of the
+      // permutation ends, until it has been computed exactly
+      size_t T = 0;
+      for (size_t n = 0; n < N; n++) {
+        for (size_t k = 0; k < nMedoids; k++) {
+          if ((*candidates)(k, n)) {
+            targetsMem[T++] = n;
+            break;
+          }
+        }
+      }
+      const arma::uvec candidateTargets(targetsMem, T, false, true);
+
+      // result will be k x T
+      arma::fmat result(resultsMem, nMedoids, T, false, true);
+      arma::mat squares(squaresMem, nMedoids, T, false, true);
+      swapTargetWindow(
+              data,
+              distMat,
+              &candidateTargets,
+              armSamples,
+              bestDistances,
+              secondBestDistances,
+              assignments,
+              &result,
+              &squares);
+
+      for (size_t t = 0; t < T; t++) {
+        const size_t n = candidateTargets(t);
+        armSums->col(n) += arma::conv_to<arma::vec>::from(result.col(t));
+        armSumSquares->col(n) += squares.col(t);
+        (*armSamples)(n) =
+                std::min(N, static_cast<size_t>((*armSamples)(n) + batchSize));
+        swapArmBounds(
+                n, N, roundAdjust, sigma, armSums, armSumSquares, armSamples,
+                exactMask, estimates, lcbs, ucbs);
+      }
+
+      minUcb = ucbs->min();
+      for (size_t i = 0; i < candidates->n_elem; i++) {
+        (*candidates)(i) = ((*lcbs)(i) < minUcb) && ((*exactMask)(i) == 0);
+      }
+      if (withinTolerance(*lcbs, *candidates, minUcb)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void BanditPAM::swapNonConflicting(
+          const arma::fmat &data,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          const arma::fmat *estimates,
+          const arma::fmat *ucbs,
+          const size_t swappedMedoid,
+          const size_t swappedCluster,
+          arma::urowvec *medoidIndices,
+          arma::fmat *medoids,
+          arma::frowvec *bestDistances,
+          arma::frowvec *secondBestDistances,
+          arma::urowvec *assignments) {
+    // Clusters whose members may have changed during this iteration
+    std::vector<bool> touched(nMedoids, false);
+    touched[swappedMedoid] = true;
+    touched[swappedCluster] = true;
+    // Medoids for which a further swap has already been evaluated
+    std::vector<bool> tried(touched);
+
+    const arma::uvec improving = arma::find(*ucbs < 0);
+    const arma::uvec order = arma::sort_index(estimates->elem(improving));
+    arma::uword *targetsMem = workspace.targets.memptr();
+    float *resultsMem = workspace.results.memptr();
+
+    size_t swapsPerformed = 1;
+    for (size_t i = 0;
+         i < order.n_elem && swapsPerformed < maxSwapsPerIter;
+         i++) {
+      const arma::uword arm = improving(order(i));
+      const size_t k = arm % nMedoids;
+      const size_t n = arm / nMedoids;
+      if (tried[k] || touched[(*assignments)(n)]) {
+        continue;
+      }
+      tried[k] = true;
+
+      // The estimate was made before this iteration's swaps, so verify the
+      // swap exactly against the current medoids before applying it
+      targetsMem[0] = n;
+      const arma::uvec target(targetsMem, 1, false, true);
+      arma::fmat result(resultsMem, nMedoids, 1, false, true);
+      swapTarget(
+              data,
+              distMat,
+              medoidIndices,
+              &target,
+              bestDistances,
+              secondBestDistances,
+              assignments,
+              true,
+              &result);
+      if (result(k, 0) >= 0) {
+        continue;
+      }
+
+      touched[k] = true;
+      touched[(*assignments)(n)] = true;
+      (*medoidIndices)(k) = n;
+      medoids->col(k) = data.col(n);
+      swapsPerformed++;
+
+      calcBestDistancesSwap(
+              data,
+              distMat,
+              medoidIndices,
+              bestDistances,
+              secondBestDistances,
+              assignments,
+              true);
     }
   }
 }  // namespace km
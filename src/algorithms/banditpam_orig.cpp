@@ -14,9 +14,7 @@
 
 namespace km {
   void BanditPAM_orig::fitBanditPAM_orig(
-          const arma::fmat &inputData,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat) {
-    data = arma::trans(inputData);
 
     // Note: even if we are using a distance matrix,
     // we compute the permutation
@@ -27,13 +25,15 @@ namespace km {
       size_t n = data.n_cols;
       size_t m = fmin(n, cacheWidth);
       cache = new float[n * m];
+      cacheColumns = m;
+      cacheRows = n;
 
       #pragma omp parallel for if (this->parallelize)
       for (size_t idx = 0; idx < m * n; idx++) {
         cache[idx] = -1;  // TODO(@motiwari): need better value here
       }
 
-      permutation = arma::randperm(n);
+      permutation = randomPermutation(n);
       permutationIdx = 0;
       reindex = {};  // TODO(@motiwari): Can this be removed?
       // TODO(@motiwari): Can we parallelize this?
@@ -82,7 +82,8 @@ namespace km {
               permutationIdx + batchSize - 1);
       permutationIdx += batchSize;
     } else {
-      referencePoints = arma::randperm(N, batchSize);
+      referencePoints.set_size(batchSize);
+      randomSample(N, batchSize, referencePoints.memptr());
     }
 
     arma::fvec sample(batchSize);
@@ -133,7 +134,8 @@ namespace km {
               permutationIdx + tmpBatchSize - 1);
       permutationIdx += tmpBatchSize;
     } else {
-      referencePoints = arma::randperm(N, tmpBatchSize);
+      referencePoints.set_size(tmpBatchSize);
+      randomSample(N, tmpBatchSize, referencePoints.memptr());
     }
 
     #pragma omp parallel for if (this->parallelize)
@@ -284,7 +286,8 @@ namespace km {
               permutationIdx + batchSize - 1);
       permutationIdx += batchSize;
     } else {
-      referencePoints = arma::randperm(N, batchSize);
+      referencePoints.set_size(batchSize);
+      randomSample(N, batchSize, referencePoints.memptr());
     }
 
     arma::fvec sample(batchSize);
@@ -353,7 +356,8 @@ namespace km {
               permutationIdx + tmpBatchSize - 1);
       permutationIdx += tmpBatchSize;
     } else {
-      referencePoints = arma::randperm(N, tmpBatchSize);
+      referencePoints.set_size(tmpBatchSize);
+      randomSample(N, tmpBatchSize, referencePoints.memptr());
     }
 
     // TODO(@motiwari): Declare variables outside of loops
@@ -0,0 +1,148 @@
+/**
+ * @file checkpoint.cpp
+ * @date 2026-10-16
+ *
+ * Contains the reader and writer of the checkpoints from which long
+ * BanditPAM fits are resumed.
+ */
+
+#include "checkpoint.hpp"
+
+#include <armadillo>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace km {
+  namespace {
+    const char magic[8] = {'B', 'P', 'A', 'M', 'C', 'K', 'P', 'T'};
+
+    template <typename T>
+    void writeValue(std::ofstream &out, const T &value) {
+      out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    void readValue(std::ifstream &in, T *value) {
+      in.read(reinterpret_cast<char *>(value), sizeof(*value));
+    }
+
+    void writeString(std::ofstream &out, const std::string &value) {
+      writeValue<uint64_t>(out, value.size());
+      out.write(value.data(), value.size());
+    }
+
+    void readString(std::ifstream &in, std::string *value) {
+      uint64_t size = 0;
+      readValue(in, &size);
+      if (!in || size > (1u << 20)) {
+        in.setstate(std::ios::failbit);
+        return;
+      }
+      value->resize(size);
+      in.read(&(*value)[0], size);
+    }
+
+    /**
+     * @brief Writes indices as 64-bit integers, whatever the width of
+     * arma::uword.
+     */
+    template <typename Indices>
+    void writeIndices(std::ofstream &out, const Indices &indices) {
+      writeValue<uint64_t>(out, indices.n_elem);
+      for (size_t i = 0; i < indices.n_elem; i++) {
+        writeValue<uint64_t>(out, indices(i));
+      }
+    }
+
+    template <typename Indices>
+    void readIndices(std::ifstream &in, uint64_t bound, Indices *indices) {
+      uint64_t size = 0;
+      readValue(in, &size);
+      if (!in || size > bound) {
+        in.setstate(std::ios::failbit);
+        return;
+      }
+      indices->set_size(size);
+      for (size_t i = 0; i < size; i++) {
+        uint64_t index = 0;
+        readValue(in, &index);
+        (*indices)(i) = index;
+      }
+    }
+  }  // namespace
+
+  void Checkpoint::write(const std::string &path) const {
+    const std::string temporary = path + ".tmp";
+    {
+      std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+      if (!out) {
+        throw std::invalid_argument("Error: cannot write " + temporary);
+      }
+      out.write(magic, sizeof(magic));
+      writeValue(out, version);
+      writeValue(out, nPoints);
+      writeValue(out, nFeatures);
+      writeString(out, loss);
+      writeValue(out, steps);
+      writeValue(out, buildLoss);
+      writeIndices(out, buildMedoids);
+      writeIndices(out, medoids);
+      writeIndices(out, permutation);
+      writeValue(out, permutationIdx);
+      writeString(out, rngState);
+      writeValue(out, cacheRows);
+      writeValue(out, cacheColumns);
+      out.write(reinterpret_cast<const char *>(cache.data()),
+                cache.size() * sizeof(float));
+      out.flush();
+      if (!out) {
+        throw std::invalid_argument("Error: cannot write " + temporary);
+      }
+    }
+#ifdef _WIN32
+    // rename does not replace existing files on Windows
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+      throw std::invalid_argument("Error: cannot write " + path);
+    }
+  }
+
+  void Checkpoint::read(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      throw std::invalid_argument("Error: cannot open " + path);
+    }
+    char fileMagic[sizeof(magic)] = {};
+    uint32_t fileVersion = 0;
+    in.read(fileMagic, sizeof(fileMagic));
+    readValue(in, &fileVersion);
+    if (!in || std::memcmp(fileMagic, magic, sizeof(magic)) != 0 ||
+        fileVersion != version) {
+      throw std::invalid_argument("Error: " + path + " is not a checkpoint");
+    }
+
+    readValue(in, &nPoints);
+    readValue(in, &nFeatures);
+    readString(in, &loss);
+    readValue(in, &steps);
+    readValue(in, &buildLoss);
+    readIndices(in, nPoints, &buildMedoids);
+    readIndices(in, nPoints, &medoids);
+    readIndices(in, nPoints, &permutation);
+    readValue(in, &permutationIdx);
+    readString(in, &rngState);
+    readValue(in, &cacheRows);
+    readValue(in, &cacheColumns);
+    if (in && cacheRows <= nPoints && cacheColumns <= nPoints) {
+      cache.resize(cacheRows * cacheColumns);
+      in.read(reinterpret_cast<char *>(cache.data()),
+              cache.size() * sizeof(float));
+    }
+    if (!in || cacheRows > nPoints || cacheColumns > nPoints) {
+      throw std::invalid_argument("Error: " + path + " is not a checkpoint");
+    }
+  }
+}  // namespace km
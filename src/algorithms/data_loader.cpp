@@ -0,0 +1,416 @@
+/**
+ * @file data_loader.cpp
+ * @date 2026-10-16
+ *
+ * Contains the loaders of datasets in raw, .npy, Armadillo binary and text
+ * form used by the command line program.
+ */
+
+#include "data_loader.hpp"
+#include "npy_header.hpp"
+
+#include <omp.h>
+#include <armadillo>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace km {
+  namespace {
+    const char armaFloat[] = "ARMA_MAT_BIN_FN004";
+    const char armaDouble[] = "ARMA_MAT_BIN_FN008";
+    const size_t armaMagicBytes = sizeof(armaFloat) - 1;
+
+    /// Smallest number of bytes of text worth a chunk of its own
+    const size_t minChunkBytes = 1 << 16;
+
+    bool isSeparator(char c) {
+      return c == ',' || c == ' ' || c == '\t' || c == '\r' || c == ';';
+    }
+
+    /**
+     * @brief Parses the values of a line of text.
+     *
+     * @param line Start of the line
+     * @param end End of the line, excluding the newline
+     * @param values Where the first capacity values are written, if not
+     * nullptr
+     * @param capacity Number of values that fit in values
+     * @param valid Set to false if a value is not a number
+     *
+     * @returns The number of values on the line
+     */
+    size_t parseLine(
+            const char *line,
+            const char *end,
+            float *values,
+            size_t capacity,
+            bool *valid) {
+      size_t count = 0;
+      // strtof needs a terminated string, which the mapping does not have
+      char buffer[64];
+      while (line < end) {
+        if (isSeparator(*line)) {
+          line++;
+          continue;
+        }
+        const char *last = line;
+        while (last < end && !isSeparator(*last)) {
+          last++;
+        }
+        const size_t length = last - line;
+        if (length >= sizeof(buffer)) {
+          *valid = false;
+          return count;
+        }
+        std::memcpy(buffer, line, length);
+        buffer[length] = '\0';
+        char *parsed;
+        const float value = std::strtof(buffer, &parsed);
+        if (parsed != buffer + length) {
+          *valid = false;
+          return count;
+        }
+        if (values != nullptr && count < capacity) {
+          values[count] = value;
+        }
+        count++;
+        line = last;
+      }
+      return count;
+    }
+
+    const char *lineEnd(const char *line, const char *end) {
+      const void *newline = std::memchr(line, '\n', end - line);
+      return newline == nullptr ? end : static_cast<const char *>(newline);
+    }
+
+    bool isBlank(const char *line, const char *end) {
+      return std::all_of(line, end, isSeparator);
+    }
+  }  // namespace
+
+  DataLoader::~DataLoader() {
+    close();
+  }
+
+  arma::fmat DataLoader::load(
+          const std::string &path,
+          const std::string &format,
+          size_t nFeatures,
+          bool parallelize) {
+    const char *file = map(path);
+    const size_t bytes = mappingBytes;
+    try {
+      std::string kind = format;
+      if (kind == "auto") {
+        if (path.size() >= 4 &&
+            path.compare(path.size() - 4, 4, ".npy") == 0) {
+          kind = "npy";
+        } else if (bytes >= armaMagicBytes &&
+                   (std::memcmp(file, armaFloat, armaMagicBytes) == 0 ||
+                    std::memcmp(file, armaDouble, armaMagicBytes) == 0)) {
+          kind = "arma";
+        } else {
+          kind = "csv";
+        }
+      }
+
+      if (kind == "raw") {
+        if (nFeatures == 0) {
+          throw std::invalid_argument(
+                  "Error: the number of features of a raw file must be "
+                  "given");
+        }
+        if (bytes % (nFeatures * sizeof(float)) != 0) {
+          throw std::invalid_argument(
+                  "Error: the size of " + path + " is not a multiple of "
+                  "the size of a point");
+        }
+        // NOTE: the mapping is read-only, so the matrix must never be
+        //  written; strict is false so that reassigning it allocates
+        return arma::fmat(
+                reinterpret_cast<float *>(const_cast<char *>(file)),
+                nFeatures,
+                bytes / (nFeatures * sizeof(float)),
+                false,
+                false);
+      } else if (kind == "npy") {
+        std::string header;
+        size_t offset = 0;
+        if (!readNpyHeader(file, bytes, &header, &offset)) {
+          throw std::invalid_argument("Error: " + path + " is not a .npy file");
+        }
+        const std::string descr = npyHeaderValue(header, "descr");
+        const bool fortran = npyHeaderValue(header, "fortran_order") == "True";
+        const size_t width = descr == "<f4" ? 4 : descr == "<f8" ? 8 : 0;
+        if (width == 0) {
+          throw std::invalid_argument(
+                  "Error: " + path + " must hold float32 or float64 values");
+        }
+
+        // A shape of "(n,)" is a single feature and "(n, d)" is d features
+        const std::string shape = npyHeaderValue(header, "shape");
+        const size_t comma = shape.find(',');
+        const std::string second = comma == std::string::npos
+                                   ? "" : shape.substr(comma + 1);
+        const size_t points = std::strtoull(shape.c_str(), nullptr, 10);
+        const size_t features =
+                second.find_first_of("0123456789") == std::string::npos
+                ? 1 : std::strtoull(second.c_str(), nullptr, 10);
+        if (points == 0 || features == 0 ||
+            (bytes - offset) / width / features < points) {
+          throw std::invalid_argument("Error: " + path + " is truncated");
+        }
+
+        char *values = const_cast<char *>(file) + offset;
+        arma::fmat transposedData;
+        if (width == 4 && !fortran) {
+          // Rows of a C-order array are points, so it is already transposed
+          return arma::fmat(
+                  reinterpret_cast<float *>(values),
+                  features,
+                  points,
+                  false,
+                  false);
+        } else if (width == 4) {
+          const arma::fmat inputData(
+                  reinterpret_cast<float *>(values),
+                  points,
+                  features,
+                  false,
+                  true);
+          transposedData = arma::trans(inputData);
+        } else if (fortran) {
+          const arma::mat inputData(
+                  reinterpret_cast<double *>(values),
+                  points,
+                  features,
+                  false,
+                  true);
+          transposedData = arma::conv_to<arma::fmat>::from(
+                  arma::trans(inputData));
+        } else {
+          const arma::mat inputData(
+                  reinterpret_cast<double *>(values),
+                  features,
+                  points,
+                  false,
+                  true);
+          transposedData = arma::conv_to<arma::fmat>::from(inputData);
+        }
+        close();
+        return transposedData;
+      } else if (kind == "arma") {
+        // The magic string and the dimensions are each on their own line
+        const char *end = file + bytes;
+        const char *magicEnd = lineEnd(file, end);
+        const char *dimensionsEnd = magicEnd < end
+                                    ? lineEnd(magicEnd + 1, end) : end;
+        const std::string magic(file, magicEnd);
+        const bool isDouble = magic == armaDouble;
+        size_t points = 0;
+        size_t features = 0;
+        if (dimensionsEnd < end) {
+          std::istringstream in(std::string(magicEnd + 1, dimensionsEnd));
+          in >> points >> features;
+        }
+        const char *values = dimensionsEnd + 1;
+        const size_t width = isDouble ? sizeof(double) : sizeof(float);
+        if ((!isDouble && magic != armaFloat) || points == 0 ||
+            features == 0 || dimensionsEnd >= end ||
+            static_cast<size_t>(end - values) / width / features < points) {
+          throw std::invalid_argument(
+                  "Error: " + path + " is not an Armadillo binary matrix");
+        }
+
+        // The values are not necessarily aligned, so they are copied out
+        arma::fmat transposedData;
+        if (isDouble) {
+          arma::mat inputData(points, features);
+          std::memcpy(inputData.memptr(), values, inputData.n_elem * width);
+          transposedData = arma::conv_to<arma::fmat>::from(
+                  arma::trans(inputData));
+        } else {
+          arma::fmat inputData(points, features);
+          std::memcpy(inputData.memptr(), values, inputData.n_elem * width);
+          transposedData = arma::trans(inputData);
+        }
+        close();
+        return transposedData;
+      } else if (kind == "csv") {
+        arma::fmat transposedData = parseText(file, bytes, parallelize);
+        close();
+        return transposedData;
+      }
+      throw std::invalid_argument(
+              "Error: unknown data format " + format +
+              "; use auto, raw, npy, arma or csv");
+    } catch (...) {
+      close();
+      throw;
+    }
+  }
+
+  void DataLoader::close() {
+#ifndef _WIN32
+    if (mapping != nullptr) {
+      munmap(mapping, mappingBytes);
+    }
+#endif
+    mapping = nullptr;
+    mappingBytes = 0;
+    contents.clear();
+    contents.shrink_to_fit();
+  }
+
+  const char *DataLoader::map(const std::string &path) {
+    close();
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      throw std::invalid_argument("Error: cannot open " + path);
+    }
+    contents.assign(
+            (std::istreambuf_iterator<char>(in)),
+            std::istreambuf_iterator<char>());
+    if (contents.empty()) {
+      throw std::invalid_argument("Error: " + path + " is empty");
+    }
+    mappingBytes = contents.size();
+    return contents.data();
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::invalid_argument("Error: cannot open " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+      ::close(fd);
+      throw std::invalid_argument("Error: " + path + " is empty");
+    }
+    const size_t bytes = status.st_size;
+    void *mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+      throw std::invalid_argument("Error: cannot map " + path);
+    }
+    mapping = mapped;
+    mappingBytes = bytes;
+    return static_cast<const char *>(mapped);
+#endif
+  }
+
+  arma::fmat DataLoader::parseText(
+          const char *text,
+          size_t bytes,
+          bool parallelize) {
+    const char *end = text + bytes;
+
+    // The first line that is not blank sets the number of features, unless
+    // it is not numeric, in which case it is a header and the next one does
+    const char *body = text;
+    size_t nFeatures = 0;
+    bool headerSkipped = false;
+    while (body < end && nFeatures == 0) {
+      const char *last = lineEnd(body, end);
+      bool valid = true;
+      const size_t count = parseLine(body, last, nullptr, 0, &valid);
+      if (!valid && !headerSkipped) {
+        headerSkipped = true;
+      } else if (!valid) {
+        throw std::invalid_argument(
+                "Error: the first line of the data is not numeric");
+      } else if (count > 0) {
+        nFeatures = count;
+        break;
+      }
+      body = last + 1;
+    }
+    if (nFeatures == 0) {
+      throw std::invalid_argument("Error: the data contains no points");
+    }
+
+    // Split the text into chunks that end at line boundaries
+    const size_t textBytes = end - body;
+    const size_t nChunks = parallelize
+            ? std::max<size_t>(1, std::min<size_t>(
+                    4 * omp_get_max_threads(), textBytes / minChunkBytes))
+            : 1;
+    std::vector<const char *> bounds(nChunks + 1);
+    bounds[0] = body;
+    bounds[nChunks] = end;
+    for (size_t chunk = 1; chunk < nChunks; chunk++) {
+      const char *start = std::max(
+              body + textBytes * chunk / nChunks,
+              bounds[chunk - 1]);
+      const char *last = lineEnd(start, end);
+      bounds[chunk] = last < end ? last + 1 : end;
+    }
+
+    // Count the points of each chunk, then parse them into their columns
+    std::vector<size_t> firstPoint(nChunks + 1, 0);
+    #pragma omp parallel for if (parallelize)
+    for (size_t chunk = 0; chunk < nChunks; chunk++) {
+      size_t count = 0;
+      for (const char *line = bounds[chunk]; line < bounds[chunk + 1];) {
+        const char *last = lineEnd(line, bounds[chunk + 1]);
+        count += !isBlank(line, last);
+        line = last + 1;
+      }
+      firstPoint[chunk + 1] = count;
+    }
+    for (size_t chunk = 0; chunk < nChunks; chunk++) {
+      firstPoint[chunk + 1] += firstPoint[chunk];
+    }
+
+    arma::fmat transposedData(nFeatures, firstPoint[nChunks]);
+    // Exceptions cannot leave a parallel region, so each chunk records the
+    // first malformed point it finds
+    std::vector<size_t> malformed(nChunks, transposedData.n_cols);
+    #pragma omp parallel for if (parallelize)
+    for (size_t chunk = 0; chunk < nChunks; chunk++) {
+      size_t point = firstPoint[chunk];
+      for (const char *line = bounds[chunk]; line < bounds[chunk + 1];) {
+        const char *last = lineEnd(line, bounds[chunk + 1]);
+        if (!isBlank(line, last)) {
+          bool valid = true;
+          const size_t count = parseLine(
+                  line,
+                  last,
+                  transposedData.colptr(point),
+                  nFeatures,
+                  &valid);
+          if (!valid || count != nFeatures) {
+            malformed[chunk] = point;
+            break;
+          }
+          point++;
+        }
+        line = last + 1;
+      }
+    }
+    const size_t firstMalformed = *std::min_element(
+            malformed.begin(), malformed.end());
+    if (firstMalformed < transposedData.n_cols) {
+      throw std::invalid_argument(
+              "Error: point " + std::to_string(firstMalformed) +
+              " of the data does not have " + std::to_string(nFeatures) +
+              " numeric values");
+    }
+    return transposedData;
+  }
+}  // namespace km
@@ -0,0 +1,153 @@
+/**
+ * @file distance_matrix.cpp
+ * @date 2026-10-16
+ *
+ * Contains the views of precomputed distance matrices in condensed or
+ * float16 form, in memory or memory-mapped from .npy and raw files.
+ */
+
+#include "distance_matrix.hpp"
+#include "npy_header.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace km {
+  DistanceMatrix::~DistanceMatrix() {
+    close();
+  }
+
+  size_t DistanceMatrix::pointsOfCondensed(size_t count) {
+    // Solve n (n - 1) / 2 = count for n
+    const size_t points = static_cast<size_t>(
+            std::llround((1 + std::sqrt(1 + 8.0 * count)) / 2));
+    return points * (points - 1) / 2 == count ? points : 0;
+  }
+
+  void DistanceMatrix::view(
+          const void *newValues,
+          size_t newN,
+          bool newCondensed,
+          bool newHalf) {
+    close();
+    values = newValues;
+    n = newN;
+    condensed = newCondensed;
+    half = newHalf;
+  }
+
+  void DistanceMatrix::viewOf(const DistanceMatrix &other) {
+    view(other.values, other.n, other.condensed, other.half);
+  }
+
+  void DistanceMatrix::open(
+          const std::string &path,
+          const std::string &dtype) {
+    close();
+#ifdef _WIN32
+    throw std::invalid_argument(
+            "Error: memory-mapped distance matrices are not supported on "
+            "Windows");
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::invalid_argument("Error: cannot open " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+      ::close(fd);
+      throw std::invalid_argument(
+              "Error: " + path + " is not a distance matrix");
+    }
+    const size_t bytes = status.st_size;
+    void *mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+      throw std::invalid_argument("Error: cannot map " + path);
+    }
+
+    const char *file = static_cast<const char *>(mapped);
+    size_t offset = 0;
+    bool fileHalf = dtype == "float16";
+    size_t fileN = 0;
+    bool fileCondensed = true;
+    bool valid = dtype == "float32" || dtype == "float16";
+    const bool isNpy = path.size() >= 4 &&
+                       path.compare(path.size() - 4, 4, ".npy") == 0;
+    if (isNpy) {
+      std::string header;
+      valid = readNpyHeader(file, bytes, &header, &offset);
+      if (valid) {
+        const std::string descr = npyHeaderValue(header, "descr");
+        fileHalf = descr == "<f2";
+        valid = fileHalf || descr == "<f4";
+
+        // A shape of "(m,)" is condensed and "(n, n)" is dense
+        const std::string shape = npyHeaderValue(header, "shape");
+        const size_t comma = shape.find(',');
+        const std::string second = comma == std::string::npos
+                                   ? "" : shape.substr(comma + 1);
+        const size_t rows = std::strtoull(shape.c_str(), nullptr, 10);
+        if (second.find_first_of("0123456789") == std::string::npos) {
+          fileN = pointsOfCondensed(rows);
+        } else {
+          fileCondensed = false;
+          fileN = std::strtoull(second.c_str(), nullptr, 10) == rows
+                  ? rows : 0;
+        }
+      }
+    } else if (valid) {
+      fileN = pointsOfCondensed(bytes / (fileHalf ? 2 : 4));
+    }
+
+    const size_t count = fileCondensed ? fileN * (fileN - 1) / 2
+                                       : fileN * fileN;
+    if (!valid || fileN == 0 ||
+        bytes != offset + count * (fileHalf ? 2 : 4)) {
+      munmap(mapped, bytes);
+      throw std::invalid_argument(
+              "Error: " + path + " is not a distance matrix");
+    }
+
+    mapping = mapped;
+    mappingBytes = bytes;
+    values = file + offset;
+    n = fileN;
+    condensed = fileCondensed;
+    half = fileHalf;
+#endif
+  }
+
+  void DistanceMatrix::close() {
+#ifndef _WIN32
+    if (mapping != nullptr) {
+      munmap(mapping, mappingBytes);
+    }
+#endif
+    mapping = nullptr;
+    mappingBytes = 0;
+    values = nullptr;
+    n = 0;
+    condensed = false;
+    half = false;
+  }
+
+  bool DistanceMatrix::isOpen() const {
+    return values != nullptr;
+  }
+
+  size_t DistanceMatrix::size() const {
+    return n;
+  }
+}  // namespace km
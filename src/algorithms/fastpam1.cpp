@@ -17,12 +17,14 @@
 
 namespace km {
   void FastPAM1::fitFastPAM1(
-          const arma::fmat &inputData,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat) {
-    data = inputData;
-    data = arma::trans(data);
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids) {
     arma::urowvec medoidIndices(nMedoids);
-    FastPAM1::buildFastPAM1(data, distMat, &medoidIndices);
+    if (initMedoids) {
+      medoidIndices = initMedoids.value();
+    } else {
+      FastPAM1::buildFastPAM1(data, distMat, &medoidIndices);
+    }
     steps = 0;
     medoidIndicesBuild = medoidIndices;
     arma::urowvec assignments(data.n_cols);
@@ -37,6 +39,9 @@ namespace km {
 
       medoidChange = arma::any(medoidIndices != previous);
       iter++;
+      if (fitCancelled() || budgetSpent()) {
+        break;
+      }
     }
     medoidIndicesFinal = medoidIndices;
     labels = assignments;
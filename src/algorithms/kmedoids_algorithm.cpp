@@ -9,6 +9,13 @@
 #include <armadillo>
 #include <unordered_map>
 #include <regex>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
 
 #include "kmedoids_algorithm.hpp"
 #include "fastpam1.hpp"
@@ -30,7 +37,8 @@ namespace km {
           bool usePerm,
           size_t cacheWidth,
           bool parallelize,
-          size_t seed) :
+          size_t seed,
+          const std::string &buildMethod) :
           nMedoids(nMedoids),
           algorithm(algorithm),
           maxIter(maxIter),
@@ -42,9 +50,11 @@ namespace km {
           parallelize(parallelize),
           seed(seed) {
     KMedoids::checkAlgorithm(algorithm);
+    KMedoids::setBuildMethod(buildMethod);
     // Though we initialize seed from the given parameter,
-    // we need to call setSeed to pass it to arma
+    // we need to call setSeed to seed the generator
     KMedoids::setSeed(seed);
+    threadCounts.resize(omp_get_max_threads());
   }
 
   KMedoids::~KMedoids() {}
@@ -52,13 +62,34 @@ namespace km {
   void KMedoids::fit(
           const arma::fmat &inputData,
           const std::string &loss,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat) {
-    numMiscDistanceComputations = 0;
-    numBuildDistanceComputations = 0;
-    numSwapDistanceComputations = 0;
-    numCacheWrites = 0;
-    numCacheHits = 0;
-    numCacheMisses = 0;
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids) {
+    releaseData();
+    data = arma::trans(inputData);
+    fitData(loss, distMat, initMedoids);
+  }
+
+  void KMedoids::fitTransposed(
+          const arma::fmat &transposedData,
+          const std::string &loss,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids) {
+    releaseData();
+    // NOTE: data aliases the caller's memory, which is only ever read
+    data = arma::fmat(
+            const_cast<float *>(transposedData.memptr()),
+            transposedData.n_rows,
+            transposedData.n_cols,
+            false,
+            false);
+    fitData(loss, distMat, initMedoids);
+  }
+
+  void KMedoids::fitData(
+          const std::string &loss,
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids) {
+    resetCounters();
 
     if (distMat) {  // User has provided a distance matrix
       if (distMat.value().get().n_cols != distMat.value().get().n_rows) {
@@ -68,6 +99,13 @@ namespace km {
                   "Malformed distance matrix provided");
       }
       useDistMat = true;
+    } else if (distanceMatrix.isOpen()) {
+      if (distanceMatrix.size() != data.n_cols) {
+        throw std::invalid_argument(
+                "Error: the distance matrix does not match the number of "
+                "points");
+      }
+      useDistMat = true;
     } else {
       // In case the user is running a new problem
       // without a distance matrix
@@ -75,33 +113,690 @@ namespace km {
       useDistMat = false;
     }
 
-    if (inputData.n_rows == 0) {
+    if (data.n_cols == 0) {
       // TODO(@motiwari): Change this to an assertion
       //  that is properly raised
       throw std::invalid_argument("Dataset is empty");
     }
+    if (initMedoids) {
+      KMedoids::checkInitMedoids(initMedoids.value(), data.n_cols);
+    }
+    if (!resumePath.empty() &&
+        (algorithm != "BanditPAM" || initMedoids || nInit > 1)) {
+      resumePath.clear();
+      throw std::invalid_argument(
+              "Error: resuming is only supported by BanditPAM with a single "
+              "restart and without initial medoids");
+    }
+    if (collapseDuplicates) {
+      if (algorithm != "BanditPAM" || useDistMat || reuseArmStats) {
+        throw std::invalid_argument(
+                "Error: collapsing duplicates is only supported by BanditPAM "
+                "without a distance matrix or reuseArmStats");
+      }
+      collapseData();
+      if (initMedoids && pointWeights.n_elem != 0) {
+        // The initial medoids are rows of the original data
+        arma::urowvec points(initMedoids.value().n_elem);
+        for (size_t i = 0; i < points.n_elem; i++) {
+          points(i) = rowPoints(initMedoids.value()(i));
+        }
+        if (arma::unique(points).eval().n_elem != points.n_elem) {
+          throw std::invalid_argument(
+                  "Initial medoids must be distinct points");
+        }
+        initMedoids = points;
+      }
+    }
     // TODO(@Adarsh321123): assert that the number of medoids is >=
     //  than the number of points
-    batchSize = fmin(inputData.n_rows, batchSize);
+    batchSize = fmin(data.n_cols, batchSize);
+    // The medoid indices of a previous fit refer to different points
+    medoidTree = MedoidTree();
 
     try {
       KMedoids::setLossFn(loss);
       if (algorithm == "PAM") {
-          static_cast<PAM *>(this)->fitPAM(inputData, distMat);
+          static_cast<PAM *>(this)->fitPAM(distMat, initMedoids);
       } else if (algorithm == "BanditPAM") {
-          static_cast<BanditPAM *>(this)->fitBanditPAM(inputData,
-                                                       distMat);
+          static_cast<BanditPAM *>(this)->fitBanditPAM(distMat, initMedoids);
       } else if (algorithm == "BanditPAM_orig") {
-          static_cast<BanditPAM_orig *>(this)->fitBanditPAM_orig(
-                  inputData, distMat);
+          if (initMedoids) {
+            throw std::invalid_argument(
+                    "Initial medoids are not supported by BanditPAM_orig");
+          }
+          static_cast<BanditPAM_orig *>(this)->fitBanditPAM_orig(distMat);
       } else if (algorithm == "FastPAM1") {
-          static_cast<FastPAM1 *>(this)->fitFastPAM1(inputData, distMat);
+          static_cast<FastPAM1 *>(this)->fitFastPAM1(distMat, initMedoids);
       }
-    } catch (std::invalid_argument &e) {
+      flushCounters();
+      medoidCoordinates = data.cols(medoidIndicesFinal);
+      expandResults();
+      cancelRequested = false;
+      checkpointing = false;
+      resumePath.clear();
+    } catch (std::exception &e) {
+      // Whatever stopped the fit, none of its partial state may be used
+      flushCounters();
+      cancelRequested = false;
+      checkpointing = false;
+      resumePath.clear();
+      clearFit();
       std::cout << e.what() << std::endl;
       std::cout << "Error: Clustering did not run." << std::endl;
-      throw e;
+      throw;
+    }
+  }
+
+  void KMedoids::clearFit() {
+    medoidIndicesBuild.reset();
+    medoidIndicesFinal.reset();
+    labels.reset();
+    medoidCoordinates.reset();
+    medoidTree = MedoidTree();
+    averageLoss = 0;
+    buildLoss = 0;
+    steps = 0;
+  }
+
+  void KMedoids::partialFit(
+          const arma::fmat &inputData,
+          size_t maxSwapIter) {
+    if (algorithm != "BanditPAM") {
+      throw std::invalid_argument(
+              "Error: partial fitting is only supported by BanditPAM");
+    }
+    if (data.n_cols == 0 || medoidIndicesFinal.n_cols != nMedoids) {
+      throw std::invalid_argument(
+              "Error: partial fitting requires a previous call to fit");
+    }
+    if (useDistMat) {
+      throw std::invalid_argument(
+              "Error: partial fitting is not supported with a distance matrix");
+    }
+    if (mappedData.isOpen()) {
+      throw std::invalid_argument(
+              "Error: partial fitting is not supported with mapped data");
+    }
+    if (pointWeights.n_elem != 0) {
+      throw std::invalid_argument(
+              "Error: partial fitting is not supported after collapsing "
+              "duplicates");
+    }
+    if (inputData.n_rows == 0) {
+      return;
+    }
+    if (inputData.n_cols != data.n_rows) {
+      throw std::invalid_argument(
+              "Error: new points must have the same number of features");
+    }
+
+    resetCounters();
+
+    // Growing data must not write past the memory of the caller
+    ownData();
+    static_cast<BanditPAM *>(this)->partialFitBanditPAM(
+            inputData, maxSwapIter);
+    flushCounters();
+    medoidCoordinates = data.cols(medoidIndicesFinal);
+    cancelRequested = false;
+  }
+
+  void KMedoids::fitMapped(
+          const std::string &path,
+          const std::string &loss,
+          std::optional<arma::urowvec> initMedoids) {
+    if (algorithm != "BanditPAM") {
+      throw std::invalid_argument(
+              "Error: mapped data is only supported by BanditPAM");
+    }
+    releaseData();
+    mappedData.open(path);
+    // NOTE: data aliases the read-only mapping and must not be written
+    data = mappedData.matrix();
+    fitData(loss, std::nullopt, initMedoids);
+  }
+
+  void KMedoids::setDistanceMatrix(
+          const void *values,
+          size_t n,
+          bool condensed,
+          bool half) {
+    distanceMatrix.view(values, n, condensed, half);
+  }
+
+  void KMedoids::loadDistanceMatrix(
+          const std::string &path,
+          const std::string &dtype) {
+    distanceMatrix.open(path, dtype);
+  }
+
+  void KMedoids::clearDistanceMatrix() {
+    distanceMatrix.close();
+  }
+
+  void KMedoids::setProgressCallback(
+          std::function<void(const FitProgress &)> callback) {
+    progressCallback = std::move(callback);
+  }
+
+  void KMedoids::requestCancel() {
+    cancelRequested = true;
+  }
+
+  bool KMedoids::getCancelled() const {
+    return cancelled;
+  }
+
+  bool KMedoids::getBudgetExhausted() const {
+    return budgetExhausted;
+  }
+
+  void KMedoids::fitKRange(
+          const arma::fmat &inputData,
+          const std::string &loss,
+          const arma::urowvec &ks) {
+    checkKRange(inputData.n_rows, ks);
+    releaseData();
+    data = arma::trans(inputData);
+    fitKRangeData(loss, ks);
+  }
+
+  void KMedoids::fitKRangeTransposed(
+          const arma::fmat &transposedData,
+          const std::string &loss,
+          const arma::urowvec &ks) {
+    checkKRange(transposedData.n_cols, ks);
+    releaseData();
+    // NOTE: data aliases the caller's memory, which is only ever read
+    data = arma::fmat(
+            const_cast<float *>(transposedData.memptr()),
+            transposedData.n_rows,
+            transposedData.n_cols,
+            false,
+            false);
+    fitKRangeData(loss, ks);
+  }
+
+  void KMedoids::checkKRange(size_t n, const arma::urowvec &ks) const {
+    if (algorithm != "BanditPAM") {
+      throw std::invalid_argument(
+              "Error: fitting a range of k is only supported by BanditPAM");
+    }
+    if (collapseDuplicates) {
+      throw std::invalid_argument(
+              "Error: fitting a range of k does not support collapsing "
+              "duplicates");
+    }
+    if (n == 0) {
+      throw std::invalid_argument("Dataset is empty");
+    }
+    if (ks.n_elem == 0) {
+      throw std::invalid_argument("Error: no numbers of medoids given");
+    }
+    if (ks.min() == 0 || ks.max() > n) {
+      throw std::invalid_argument(
+              "Error: each number of medoids must be between 1 and the "
+              "number of points");
+    }
+  }
+
+  void KMedoids::fitKRangeData(
+          const std::string &loss,
+          const arma::urowvec &ks) {
+    resetCounters();
+    useDistMat = false;
+    batchSize = fmin(data.n_cols, batchSize);
+    medoidTree = MedoidTree();
+    KMedoids::setLossFn(loss);
+    static_cast<BanditPAM *>(this)->fitKRangeBanditPAM(ks);
+    flushCounters();
+    medoidCoordinates = data.cols(medoidIndicesFinal);
+    cancelRequested = false;
+  }
+
+  arma::urowvec KMedoids::predict(
+          const arma::fmat &inputData,
+          arma::frowvec *distances) const {
+    return predictData(inputData, false, distances);
+  }
+
+  arma::urowvec KMedoids::predictTransposed(
+          const arma::fmat &transposedData,
+          arma::frowvec *distances) const {
+    return predictData(transposedData, true, distances);
+  }
+
+  arma::fmat KMedoids::getMedoidCoordinates() const {
+    return medoidCoordinates;
+  }
+
+  arma::urowvec KMedoids::predictData(
+          const arma::fmat &inputData,
+          bool transposed,
+          arma::frowvec *distances) const {
+    if (medoidCoordinates.n_cols == 0) {
+      throw std::invalid_argument(
+              "Error: predict requires a previous call to fit");
+    }
+    const size_t features = transposed ? inputData.n_rows : inputData.n_cols;
+    if (features != medoidCoordinates.n_rows) {
+      throw std::invalid_argument(
+              "Error: points must have the same number of features as the "
+              "data that was fit");
+    }
+
+    const size_t N = transposed ? inputData.n_cols : inputData.n_rows;
+    const size_t K = medoidCoordinates.n_cols;
+    arma::urowvec predictedLabels(N);
+    if (distances != nullptr) {
+      distances->set_size(N);
+    }
+
+    // For L2 and cosine, the inner products of a block of queries with all
+    // medoids come from one matrix product with the d x k medoid matrix
+    const bool useL2 = (lossFn == &KMedoids::LP) && (lp == 2);
+    const bool useCosine = (lossFn == &KMedoids::cos);
+    // The tree is only worth building once per call, over the final medoids
+    const bool useTree = useMedoidTree && isMetricLoss();
+    MedoidTree tree;
+    if (useTree) {
+      buildMedoidTree(medoidCoordinates, &tree);
+    }
+    arma::fvec medoidSquaredNorms;
+    if (!useTree && (useL2 || useCosine)) {
+      medoidSquaredNorms =
+              arma::trans(arma::sum(arma::square(medoidCoordinates), 0));
+    }
+
+    const size_t numBlocks = (N + predictBatchSize - 1) / predictBatchSize;
+    #pragma omp parallel for if (this->parallelize)
+    for (size_t b = 0; b < numBlocks; b++) {
+      const size_t first = b * predictBatchSize;
+      const size_t last = std::min(N, first + predictBatchSize) - 1;
+      // Query points of this block, one per column like the medoids
+      // NOTE: transposed queries alias the input, which is only ever read
+      const arma::fmat queries = transposed
+              ? arma::fmat(
+                      const_cast<float *>(inputData.colptr(first)),
+                      inputData.n_rows,
+                      last - first + 1,
+                      false,
+                      true)
+              : arma::fmat(arma::trans(inputData.rows(first, last)));
+      const size_t B = queries.n_cols;
+
+      if (useTree) {
+        for (size_t q = 0; q < B; q++) {
+          float best;
+          float second;
+          arma::uword k;
+          searchMedoidTree(tree, queries, q, &best, &second, &k);
+          predictedLabels(first + q) = k;
+          if (distances != nullptr) {
+            (*distances)(first + q) = best;
+          }
+        }
+        continue;
+      }
+
+      // k x B distances, so that each query's distances are contiguous
+      arma::fmat blockDistances;
+      if (useL2) {
+        // ||q - m||^2 = ||q||^2 - 2 q.m + ||m||^2; the square root is only
+        // taken for the returned distances
+        blockDistances = -2 * (medoidCoordinates.t() * queries);
+        blockDistances.each_col() += medoidSquaredNorms;
+        blockDistances.each_row() += arma::sum(arma::square(queries), 0);
+      } else if (useCosine) {
+        blockDistances = medoidCoordinates.t() * queries;
+        blockDistances.each_col() /= arma::sqrt(medoidSquaredNorms);
+        blockDistances.each_row() /=
+                arma::sqrt(arma::sum(arma::square(queries), 0));
+        blockDistances = 1 - blockDistances;
+      } else {
+        blockDistances.set_size(K, B);
+        for (size_t q = 0; q < B; q++) {
+          for (size_t k = 0; k < K; k++) {
+            blockDistances(k, q) =
+                    queryLoss(queries, q, medoidCoordinates, k);
+          }
+        }
+      }
+
+      for (size_t q = 0; q < B; q++) {
+        const arma::uword k = blockDistances.col(q).index_min();
+        predictedLabels(first + q) = k;
+        if (distances != nullptr) {
+          // Recomputed directly to avoid the cancellation of the expansion
+          (*distances)(first + q) =
+                  useL2 ? queryLoss(queries, q, medoidCoordinates, k)
+                        : blockDistances(k, q);
+        }
+      }
+    }
+    return predictedLabels;
+  }
+
+  void KMedoids::computeDistanceMatrix(
+          const arma::fmat &inputData,
+          const std::string &loss,
+          void *out,
+          bool condensed,
+          bool half) {
+    computeDistanceMatrixTransposed(
+            arma::trans(inputData), loss, out, condensed, half);
+  }
+
+  void KMedoids::computeDistanceMatrixTransposed(
+          const arma::fmat &points,
+          const std::string &loss,
+          void *out,
+          bool condensed,
+          bool half) {
+    KMedoids::setLossFn(loss);
+    const size_t N = points.n_cols;
+    const bool useL2 = (lossFn == &KMedoids::LP) && (lp == 2);
+    const bool useCosine = (lossFn == &KMedoids::cos);
+    arma::frowvec squaredNorms;
+    if (useL2 || useCosine) {
+      squaredNorms = arma::sum(arma::square(points), 0);
+    }
+
+    // Tiles on or above the diagonal, listed up front so that they can be
+    // handed out dynamically: diagonal tiles only do half the work
+    const size_t T = distanceTileSize;
+    const size_t numTiles = (N + T - 1) / T;
+    std::vector<std::pair<size_t, size_t>> tiles;
+    tiles.reserve(numTiles * (numTiles + 1) / 2);
+    for (size_t a = 0; a < numTiles; a++) {
+      for (size_t b = a; b < numTiles; b++) {
+        tiles.emplace_back(a, b);
+      }
+    }
+
+    float *outFloat = static_cast<float *>(out);
+    uint16_t *outHalf = static_cast<uint16_t *>(out);
+    auto store = [&](size_t index, float value) {
+      if (half) {
+        outHalf[index] = DistanceMatrix::floatToHalf(value);
+      } else {
+        outFloat[index] = value;
+      }
+    };
+
+    #pragma omp parallel for schedule(dynamic) if (this->parallelize)
+    for (size_t t = 0; t < tiles.size(); t++) {
+      const size_t rowFirst = tiles[t].first * T;
+      const size_t rowLast = std::min(N, rowFirst + T) - 1;
+      const size_t colFirst = tiles[t].second * T;
+      const size_t colLast = std::min(N, colFirst + T) - 1;
+      const bool diagonal = rowFirst == colFirst;
+      const arma::fmat rows = points.cols(rowFirst, rowLast);
+      const arma::fmat cols = points.cols(colFirst, colLast);
+
+      arma::fmat tile;
+      if (useL2) {
+        // ||x - y||^2 = ||x||^2 - 2 x.y + ||y||^2. The expansion loses about
+        // eps * (||x||^2 + ||y||^2) to cancellation, which swamps the
+        // distance of close pairs, so those are recomputed directly
+        const float recomputeRatio = 1e-2f;
+        tile = -2 * (rows.t() * cols);
+        tile.each_col() +=
+                arma::trans(squaredNorms.cols(rowFirst, rowLast));
+        tile.each_row() += squaredNorms.cols(colFirst, colLast);
+        for (size_t c = 0; c < cols.n_cols; c++) {
+          for (size_t r = 0; r < rows.n_cols; r++) {
+            const float scale = squaredNorms(rowFirst + r) +
+                                squaredNorms(colFirst + c);
+            tile(r, c) = tile(r, c) < recomputeRatio * scale
+                         ? queryLoss(rows, r, cols, c)
+                         : std::sqrt(tile(r, c));
+          }
+        }
+      } else if (useCosine) {
+        tile = rows.t() * cols;
+        tile.each_col() /=
+                arma::trans(arma::sqrt(squaredNorms.cols(rowFirst, rowLast)));
+        tile.each_row() /= arma::sqrt(squaredNorms.cols(colFirst, colLast));
+        tile = 1 - tile;
+      } else {
+        tile.set_size(rows.n_cols, cols.n_cols);
+        for (size_t c = 0; c < cols.n_cols; c++) {
+          for (size_t r = 0; r < (diagonal ? c : rows.n_cols); r++) {
+            tile(r, c) = queryLoss(rows, r, cols, c);
+          }
+        }
+      }
+
+      for (size_t r = 0; r < rows.n_cols; r++) {
+        const size_t i = rowFirst + r;
+        if (diagonal && !condensed) {
+          store(i * N + i, 0);
+        }
+        for (size_t c = diagonal ? r + 1 : 0; c < cols.n_cols; c++) {
+          const size_t j = colFirst + c;
+          if (condensed) {
+            store(DistanceMatrix::condensedIndex(i, j, N), tile(r, c));
+          } else {
+            store(i * N + j, tile(r, c));
+            store(j * N + i, tile(r, c));
+          }
+        }
+      }
+    }
+  }
+
+  size_t KMedoids::randomIndex(size_t bound) {
+    return std::uniform_int_distribution<size_t>(0, bound - 1)(rng);
+  }
+
+  double KMedoids::randomUniform() {
+    return std::uniform_real_distribution<double>(0, 1)(rng);
+  }
+
+  arma::uvec KMedoids::randomPermutation(size_t n) {
+    arma::uvec permutation(n);
+    for (size_t i = 0; i < n; i++) {
+      permutation(i) = i;
+    }
+    std::shuffle(permutation.begin(), permutation.end(), rng);
+    return permutation;
+  }
+
+  void KMedoids::randomSample(size_t n, size_t m, arma::uword *out) {
+    if (sampleIndices.n_elem != n) {
+      sampleIndices = randomPermutation(n);
+    }
+    // Partial Fisher-Yates shuffle: sampleIndices stays a permutation of the
+    // points, and its first m entries after the shuffle are a uniform sample
+    // whatever order it started in
+    for (size_t i = 0; i < m; i++) {
+      const size_t j = i + randomIndex(n - i);
+      std::swap(sampleIndices(i), sampleIndices(j));
+      out[i] = sampleIndices(i);
+    }
+  }
+
+  float KMedoids::queryLoss(
+          const arma::fmat &queries,
+          const size_t q,
+          const arma::fmat &medoids,
+          const size_t k) const {
+    if (lossFn == &KMedoids::manhattan) {
+      return arma::accu(arma::abs(queries.col(q) - medoids.col(k)));
+    } else if (lossFn == &KMedoids::LINF) {
+      return arma::max(arma::abs(queries.col(q) - medoids.col(k)));
+    } else if (lossFn == &KMedoids::cos) {
+      return 1 - (arma::dot(queries.col(q), medoids.col(k))
+                  / (arma::norm(queries.col(q)) *
+                     arma::norm(medoids.col(k))));
+    }
+    return arma::norm(queries.col(q) - medoids.col(k), lp);
+  }
+
+  bool KMedoids::isMetricLoss() const {
+    // Cosine distance violates the triangle inequality, as do Lp "norms"
+    // with p < 1
+    if (lossFn == &KMedoids::cos) {
+      return false;
+    }
+    return lossFn != &KMedoids::LP || lp >= 1;
+  }
+
+  size_t KMedoids::buildMedoidTree(
+          const arma::fmat &medoids,
+          MedoidTree *tree) const {
+    const size_t K = medoids.n_cols;
+    tree->coordinates = medoids;
+    tree->medoidIndices.reset();
+    tree->order = arma::regspace<arma::uvec>(0, K - 1);
+    tree->radii.zeros(K);
+
+    // Distances to the vantage point of the node being split, paired with
+    // the medoid they belong to
+    std::vector<std::pair<float, arma::uword>> scratch(K);
+    std::vector<std::pair<size_t, size_t>> nodes = {{0, K}};
+    size_t computed = 0;
+    while (!nodes.empty()) {
+      const size_t lo = nodes.back().first;
+      const size_t hi = nodes.back().second;
+      nodes.pop_back();
+      if (hi - lo <= 1) {
+        continue;
+      }
+
+      const arma::uword vantage = tree->order(lo);
+      for (size_t p = lo + 1; p < hi; p++) {
+        scratch[p] = std::make_pair(
+                queryLoss(medoids, tree->order(p), medoids, vantage),
+                tree->order(p));
+      }
+      computed += hi - lo - 1;
+
+      // Split the other medoids of the node at the median distance
+      const size_t mid = MedoidTree::split(lo, hi);
+      std::nth_element(scratch.begin() + lo + 1,
+                       scratch.begin() + mid,
+                       scratch.begin() + hi);
+      for (size_t p = lo + 1; p < hi; p++) {
+        tree->order(p) = scratch[p].second;
+      }
+      tree->radii(lo) = scratch[mid].first;
+      nodes.push_back(std::make_pair(lo + 1, mid));
+      nodes.push_back(std::make_pair(mid, hi));
+    }
+    return computed;
+  }
+
+  void KMedoids::refreshMedoidTree(
+          const arma::fmat &data,
+          const arma::urowvec &medoidIndices) {
+    if (medoidTree.medoidIndices.n_elem == medoidIndices.n_elem &&
+        arma::all(medoidTree.medoidIndices == medoidIndices)) {
+      return;
+    }
+    // Rebuilding costs O(k log k) distances, small next to the O(n log k)
+    // of the assignment pass that follows each swap
+    numMiscDistanceComputations +=
+            buildMedoidTree(data.cols(medoidIndices), &medoidTree);
+    medoidTree.medoidIndices = medoidIndices;
+  }
+
+  size_t KMedoids::searchMedoidTree(
+          const MedoidTree &tree,
+          const arma::fmat &queries,
+          const size_t q,
+          float *best,
+          float *second,
+          arma::uword *assignment) const {
+    *best = std::numeric_limits<float>::infinity();
+    *second = std::numeric_limits<float>::infinity();
+    // The tree is balanced, so the stack of pending subtrees stays shallow
+    std::array<MedoidTree::Frame, MedoidTree::maxPending> pending;
+    size_t top = 0;
+    pending[top++] = {0, tree.order.n_elem, 0};
+    size_t computed = 0;
+    while (top > 0) {
+      const MedoidTree::Frame frame = pending[--top];
+      // No medoid of this subtree can be among the two closest
+      if (frame.bound > *second) {
+        continue;
+      }
+
+      const arma::uword vantage = tree.order(frame.lo);
+      const float distance = queryLoss(queries, q, tree.coordinates, vantage);
+      computed++;
+      if (distance < *best) {
+        *assignment = vantage;
+        *second = *best;
+        *best = distance;
+      } else if (distance < *second) {
+        *second = distance;
+      }
+      if (frame.hi - frame.lo <= 1) {
+        continue;
+      }
+
+      // By the triangle inequality, medoids within radius of the vantage
+      // point are at least distance - radius away from the query, and the
+      // others at least radius - distance
+      const size_t mid = MedoidTree::split(frame.lo, frame.hi);
+      const float radius = tree.radii(frame.lo);
+      const MedoidTree::Frame inner =
+              {frame.lo + 1, mid, std::max(frame.bound, distance - radius)};
+      const MedoidTree::Frame outer =
+              {mid, frame.hi, std::max(frame.bound, radius - distance)};
+      // Push the side of the query last so that it is searched first
+      if (distance < radius) {
+        pending[top++] = outer;
+        if (inner.lo < inner.hi) {
+          pending[top++] = inner;
+        }
+      } else {
+        if (inner.lo < inner.hi) {
+          pending[top++] = inner;
+        }
+        pending[top++] = outer;
+      }
     }
+    return computed;
+  }
+
+  std::vector<arma::urowvec> KMedoids::getKRangeMedoids() const {
+    return kRangeMedoids;
+  }
+
+  std::vector<arma::urowvec> KMedoids::getKRangeBuildMedoids() const {
+    return kRangeBuildMedoids;
+  }
+
+  arma::frowvec KMedoids::getKRangeLosses() const {
+    return kRangeLosses;
+  }
+
+  arma::frowvec KMedoids::getKRangeBuildLosses() const {
+    return kRangeBuildLosses;
+  }
+
+  std::vector<arma::urowvec> KMedoids::getKRangeLabels() const {
+    return kRangeLabels;
+  }
+
+  arma::urowvec KMedoids::getKRangeSteps() const {
+    return kRangeSteps;
+  }
+
+  arma::frowvec KMedoids::getKRangeSwapTimes() const {
+    return kRangeSwapTimes;
+  }
+
+  arma::urowvec KMedoids::getKRangeSwapDistanceComputations() const {
+    return kRangeSwapDistanceComputations;
+  }
+
+  float KMedoids::getKRangeBuildTime() const {
+    return kRangeBuildTime;
   }
 
   arma::urowvec KMedoids::getMedoidsBuild() const {
@@ -137,6 +832,23 @@ namespace km {
     KMedoids::checkAlgorithm(algorithm);
   }
 
+  std::string KMedoids::getBuildMethod() const {
+    return buildMethod;
+  }
+
+  void KMedoids::setBuildMethod(const std::string &newBuildMethod) {
+    std::string method = newBuildMethod;
+    std::for_each(method.begin(), method.end(), [](char &c) {
+      c = ::tolower(c);
+    });
+    if ((method != "bandit") &&
+        (method != "lab") &&
+        (method != "kmedoids++")) {
+      throw std::invalid_argument("Error: unrecognized build method");
+    }
+    buildMethod = method;
+  }
+
   size_t KMedoids::getMaxIter() const {
     return maxIter;
   }
@@ -145,6 +857,233 @@ namespace km {
     maxIter = newMaxIter;
   }
 
+  size_t KMedoids::getMaxSwapsPerIter() const {
+    return maxSwapsPerIter;
+  }
+
+  void KMedoids::setMaxSwapsPerIter(size_t newMaxSwapsPerIter) {
+    if (newMaxSwapsPerIter == 0) {
+      throw std::invalid_argument(
+              "Error: at least one swap per iteration is required");
+    }
+    maxSwapsPerIter = newMaxSwapsPerIter;
+  }
+
+  bool KMedoids::getReuseArmStats() const {
+    return reuseArmStats;
+  }
+
+  void KMedoids::setReuseArmStats(bool newReuseArmStats) {
+    reuseArmStats = newReuseArmStats;
+  }
+
+  bool KMedoids::getOnlineSigma() const {
+    return onlineSigma;
+  }
+
+  void KMedoids::setOnlineSigma(bool newOnlineSigma) {
+    onlineSigma = newOnlineSigma;
+  }
+
+  size_t KMedoids::getNInit() const {
+    return nInit;
+  }
+
+  void KMedoids::setNInit(size_t newNInit) {
+    if (newNInit == 0) {
+      throw std::invalid_argument("Error: at least one restart is required");
+    }
+    nInit = newNInit;
+  }
+
+  bool KMedoids::getUseMedoidTree() const {
+    return useMedoidTree;
+  }
+
+  void KMedoids::setUseMedoidTree(bool newUseMedoidTree) {
+    useMedoidTree = newUseMedoidTree;
+  }
+
+  bool KMedoids::getCollapseDuplicates() const {
+    return collapseDuplicates;
+  }
+
+  void KMedoids::setCollapseDuplicates(bool newCollapseDuplicates) {
+    collapseDuplicates = newCollapseDuplicates;
+  }
+
+  void KMedoids::saveModel(
+          const std::string &path,
+          bool includeCoordinates) const {
+    toModelFile(includeCoordinates).write(path);
+  }
+
+  void KMedoids::loadModel(const std::string &path) {
+    ModelFile model;
+    model.read(path);
+    fromModelFile(model);
+  }
+
+  std::string KMedoids::serializeModel(bool includeCoordinates) const {
+    return toModelFile(includeCoordinates).serialize();
+  }
+
+  void KMedoids::deserializeModel(const std::string &bytes) {
+    ModelFile model;
+    model.deserialize(bytes.data(), bytes.size());
+    fromModelFile(model);
+  }
+
+  ModelFile KMedoids::toModelFile(bool includeCoordinates) const {
+    ModelFile model;
+    model.nMedoids = nMedoids;
+    model.algorithm = algorithm;
+    model.buildMethod = buildMethod;
+    // The loss function is only set by a fit
+    if (medoidIndicesFinal.n_elem > 0) {
+      model.loss = getLossFn();
+    }
+    model.maxIter = maxIter;
+    model.maxSwapsPerIter = maxSwapsPerIter;
+    model.nInit = nInit;
+    model.buildConfidence = buildConfidence;
+    model.swapConfidence = swapConfidence;
+    model.seed = seed;
+    model.cacheWidth = cacheWidth;
+    model.useCache = useCache;
+    model.usePerm = usePerm;
+    model.parallelize = parallelize;
+    model.reuseArmStats = reuseArmStats;
+    model.onlineSigma = onlineSigma;
+    model.useMedoidTree = useMedoidTree;
+    model.tolerance = tolerance;
+    model.relativeTolerance = relativeTolerance;
+    model.timeBudget = timeBudget;
+    model.distanceBudget = distanceBudget;
+    model.collapseDuplicates = collapseDuplicates;
+
+    model.buildMedoids = medoidIndicesBuild;
+    model.medoids = medoidIndicesFinal;
+    model.labels = labels;
+    model.averageLoss = averageLoss;
+    model.buildLoss = buildLoss;
+    model.steps = steps;
+    if (includeCoordinates) {
+      model.medoidCoordinates = medoidCoordinates;
+    }
+    return model;
+  }
+
+  void KMedoids::fromModelFile(const ModelFile &model) {
+    if (model.nMedoids == 0 || model.nInit == 0 ||
+        (model.medoids.n_elem != 0 && model.medoids.n_elem != model.nMedoids) ||
+        (model.labels.n_elem != 0 &&
+         model.labels.max() >= model.medoids.n_elem)) {
+      throw std::invalid_argument("Error: the model is inconsistent");
+    }
+    KMedoids::checkAlgorithm(model.algorithm);
+    KMedoids::setBuildMethod(model.buildMethod);
+    if (!model.loss.empty()) {
+      // getLossFn names the L-infinity loss differently than setLossFn
+      KMedoids::setLossFn(model.loss == "L-infinity" ? "inf" : model.loss);
+    }
+
+    nMedoids = model.nMedoids;
+    algorithm = model.algorithm;
+    maxIter = model.maxIter;
+    maxSwapsPerIter = model.maxSwapsPerIter;
+    nInit = model.nInit;
+    buildConfidence = model.buildConfidence;
+    swapConfidence = model.swapConfidence;
+    KMedoids::setSeed(model.seed);
+    cacheWidth = model.cacheWidth;
+    useCache = model.useCache;
+    usePerm = model.usePerm;
+    parallelize = model.parallelize;
+    reuseArmStats = model.reuseArmStats;
+    onlineSigma = model.onlineSigma;
+    useMedoidTree = model.useMedoidTree;
+    tolerance = model.tolerance;
+    relativeTolerance = model.relativeTolerance;
+    timeBudget = model.timeBudget;
+    distanceBudget = model.distanceBudget;
+    collapseDuplicates = model.collapseDuplicates;
+
+    // The training data is not part of the model
+    releaseData();
+    clearDistanceMatrix();
+    medoidTree = MedoidTree();
+    medoidIndicesBuild = model.buildMedoids;
+    medoidIndicesFinal = model.medoids;
+    labels = model.labels;
+    averageLoss = model.averageLoss;
+    buildLoss = model.buildLoss;
+    steps = model.steps;
+    medoidCoordinates = model.medoidCoordinates;
+  }
+
+  std::string KMedoids::getCheckpointPath() const {
+    return checkpointPath;
+  }
+
+  void KMedoids::setCheckpointPath(const std::string &newCheckpointPath) {
+    checkpointPath = newCheckpointPath;
+  }
+
+  bool KMedoids::getCheckpointCache() const {
+    return checkpointCache;
+  }
+
+  void KMedoids::setCheckpointCache(bool newCheckpointCache) {
+    checkpointCache = newCheckpointCache;
+  }
+
+  std::string KMedoids::getResumePath() const {
+    return resumePath;
+  }
+
+  void KMedoids::setResumePath(const std::string &newResumePath) {
+    resumePath = newResumePath;
+  }
+
+  float KMedoids::getTolerance() const {
+    return tolerance;
+  }
+
+  void KMedoids::setTolerance(float newTolerance) {
+    if (!(newTolerance >= 0)) {
+      throw std::invalid_argument("Error: the tolerance must be at least 0");
+    }
+    tolerance = newTolerance;
+  }
+
+  bool KMedoids::getRelativeTolerance() const {
+    return relativeTolerance;
+  }
+
+  void KMedoids::setRelativeTolerance(bool newRelativeTolerance) {
+    relativeTolerance = newRelativeTolerance;
+  }
+
+  float KMedoids::getTimeBudget() const {
+    return timeBudget;
+  }
+
+  void KMedoids::setTimeBudget(float newTimeBudget) {
+    if (!(newTimeBudget >= 0)) {
+      throw std::invalid_argument("Error: the time budget must be at least 0");
+    }
+    timeBudget = newTimeBudget;
+  }
+
+  size_t KMedoids::getDistanceBudget() const {
+    return distanceBudget;
+  }
+
+  void KMedoids::setDistanceBudget(size_t newDistanceBudget) {
+    distanceBudget = newDistanceBudget;
+  }
+
 
   size_t KMedoids::getBuildConfidence() const {
     return buildConfidence;
@@ -172,7 +1111,7 @@ namespace km {
 
   void KMedoids::setSeed(size_t newSeed) {
     seed = newSeed;
-    arma::arma_rng::set_seed(seed);
+    rng.seed(seed);
   }
 
   size_t KMedoids::getSeed() const {
@@ -308,6 +1247,28 @@ namespace km {
           arma::frowvec *secondBestDistances,
           arma::urowvec *assignments,
           const bool swapPerformed) {
+    if (useMedoidTree && !useDistMat && isMetricLoss()) {
+      refreshMedoidTree(data, *medoidIndices);
+      size_t computed = 0;
+      #pragma omp parallel for if (this->parallelize) reduction(+:computed)
+      for (size_t i = 0; i < data.n_cols; i++) {
+        // The tree's coordinates are in the order of medoidIndices, so the
+        // column found is the index of the medoid
+        computed += searchMedoidTree(medoidTree,
+                                     data,
+                                     i,
+                                     &(*bestDistances)(i),
+                                     &(*secondBestDistances)(i),
+                                     &(*assignments)(i));
+      }
+      numMiscDistanceComputations += computed;
+
+      if (!swapPerformed) {
+        averageLoss = meanLoss(*bestDistances);
+      }
+      return;
+    }
+
     #pragma omp parallel for if (this->parallelize)
     for (size_t i = 0; i < data.n_cols; i++) {
       float best = std::numeric_limits<float>::infinity();
@@ -331,7 +1292,7 @@ namespace km {
 
     if (!swapPerformed) {
       // We have converged; update the final loss
-      averageLoss = arma::accu(*bestDistances) / data.n_cols;
+      averageLoss = meanLoss(*bestDistances);
     }
   }
 
@@ -339,12 +1300,29 @@ namespace km {
           const arma::fmat &data,
           std::optional<std::reference_wrapper<const arma::fmat>> distMat,
           const arma::urowvec *medoidIndices) {
+    if (useMedoidTree && !useDistMat && isMetricLoss()) {
+      refreshMedoidTree(data, *medoidIndices);
+      float total = 0;
+      size_t computed = 0;
+      #pragma omp parallel for if (this->parallelize) \
+              reduction(+:total, computed)
+      for (size_t i = 0; i < data.n_cols; i++) {
+        float best;
+        float second;
+        arma::uword assignment;
+        computed += searchMedoidTree(
+                medoidTree, data, i, &best, &second, &assignment);
+        total += pointWeight(i) * best;
+      }
+      numMiscDistanceComputations += computed;
+      return total / totalWeight();
+    }
+
     float total = 0;
-    // TODO(@motiwari): is this parallel loop accumulating properly?
-    #pragma omp parallel for if (this->parallelize)
+    #pragma omp parallel for if (this->parallelize) reduction(+:total)
     for (size_t i = 0; i < data.n_cols; i++) {
       float cost = std::numeric_limits<float>::infinity();
-      for (size_t k = 0; k < nMedoids; k++) {
+      for (size_t k = 0; k < medoidIndices->n_cols; k++) {
         float currCost = KMedoids::cachedLoss(
                 data,
                 distMat,
@@ -355,11 +1333,11 @@ namespace km {
           cost = currCost;
         }
       }
-      total += cost;
+      total += pointWeight(i) * cost;
     }
 
-    // Returns average distance
-    return total / data.n_cols;
+    // Returns average distance over the original rows
+    return total / totalWeight();
   }
 
   float KMedoids::cachedLoss(
@@ -370,18 +1348,24 @@ namespace km {
           const size_t category,
           const bool useCacheFunctionOverride
   ) {
+    // Each thread counts in its own slot, which flushCounters adds to the
+    // totals once the loop is over
+    ThreadCounts &counts = threadCounts[omp_get_thread_num()];
     // TODO(@motiwari): Change category to an enum
     if (category == 0) {  // MISC
-      numMiscDistanceComputations++;
+      counts.misc++;
     } else if (category == 1) {  // BUILD
-      numBuildDistanceComputations++;
+      counts.build++;
     } else if (category == 2) {  // SWAP
-      numSwapDistanceComputations++;
+      counts.swap++;
     } else {
       // TODO(@motiwari): Throw exception
     }
 
     if (this->useDistMat) {
+      if (!distMat) {
+        return distanceMatrix.at(i, j);
+      }
       return distMat.value().get().at(i, j);
     }
 
@@ -389,9 +1373,9 @@ namespace km {
       return (this->*lossFn)(data, i, j);
     }
 
-    // TODO(@motiwari): Should infer n and m from the size of the cache
-    size_t n = data.n_cols;
-    size_t m = fmin(n, cacheWidth);
+    // The width is fixed when the cache is allocated, even if points are
+    // appended later
+    size_t m = cacheColumns;
 
     // test this is one of the early points in the permutation
     if (reindex.find(j) != reindex.end()) {
@@ -399,17 +1383,207 @@ namespace km {
       // T1 begins to write to cache and then T2
       // access in the middle of write?
       if (cache[(m * i) + reindex[j]] == -1) {
-        numCacheWrites++;
+        counts.cacheWrites++;
         cache[(m * i) + reindex[j]] = (this->*lossFn)(data, i, j);
       }
-      numCacheHits++;
+      counts.cacheHits++;
       return cache[m * i + reindex[j]];
     }
 
-    numCacheMisses++;
+    counts.cacheMisses++;
     return (this->*lossFn)(data, i, j);
   }
 
+  void KMedoids::resetCounters() {
+    numMiscDistanceComputations = 0;
+    numBuildDistanceComputations = 0;
+    numSwapDistanceComputations = 0;
+    numCacheWrites = 0;
+    numCacheHits = 0;
+    numCacheMisses = 0;
+    // The number of threads may have changed since the last fit
+    threadCounts.assign(
+            std::max<size_t>(threadCounts.size(), omp_get_max_threads()),
+            ThreadCounts());
+    cancelled = false;
+    budgetExhausted = false;
+    fitStart = std::chrono::steady_clock::now();
+  }
+
+  void KMedoids::flushCounters() {
+    ThreadCounts total;
+    for (ThreadCounts &counts : threadCounts) {
+      total.misc += counts.misc;
+      total.build += counts.build;
+      total.swap += counts.swap;
+      total.cacheWrites += counts.cacheWrites;
+      total.cacheHits += counts.cacheHits;
+      total.cacheMisses += counts.cacheMisses;
+      counts = ThreadCounts();
+    }
+    numMiscDistanceComputations += total.misc;
+    numBuildDistanceComputations += total.build;
+    numSwapDistanceComputations += total.swap;
+    numCacheWrites += total.cacheWrites;
+    numCacheHits += total.cacheHits;
+    numCacheMisses += total.cacheMisses;
+  }
+
+  float KMedoids::budgetUsed() const {
+    float used = 0;
+    if (timeBudget > 0) {
+      const std::chrono::duration<float> elapsed =
+              std::chrono::steady_clock::now() - fitStart;
+      used = elapsed.count() / timeBudget;
+    }
+    if (distanceBudget > 0) {
+      used = std::max(
+              used,
+              static_cast<float>(getDistanceComputations(true)) /
+              distanceBudget);
+    }
+    return used;
+  }
+
+  bool KMedoids::budgetSpent() {
+    flushCounters();
+    // Once spent, the budget stays spent for the rest of the fit
+    if (!budgetExhausted && budgetUsed() >= 1) {
+      budgetExhausted = true;
+    }
+    return budgetExhausted;
+  }
+
+  float KMedoids::budgetConfidence() {
+    if (budgetSpent()) {
+      return 0;
+    }
+    const float left = std::min(1.0f, 2 * (1 - budgetUsed()));
+    return left * left;
+  }
+
+  void KMedoids::reportProgress(
+          const char *phase,
+          size_t step,
+          size_t total,
+          float loss) {
+    if (!progressCallback) {
+      return;
+    }
+    flushCounters();
+    FitProgress progress;
+    progress.phase = phase;
+    progress.step = step;
+    progress.total = total;
+    progress.loss = loss;
+    progress.distanceComputations = getDistanceComputations(true);
+    progressCallback(progress);
+  }
+
+  bool KMedoids::fitCancelled() {
+    // Once observed, the request holds for the rest of the fit
+    if (cancelRequested ||
+        (restartOf != nullptr && restartOf->cancelRequested)) {
+      cancelled = true;
+    }
+    return cancelled;
+  }
+
+  void KMedoids::releaseData() {
+    // data may alias a mapping or the caller's memory; resetting it first
+    // makes its next assignment allocate memory instead of writing there
+    data.reset();
+    mappedData.close();
+    pointWeights.reset();
+    rowPoints.reset();
+    pointRows.reset();
+  }
+
+  void KMedoids::ownData() {
+    // Armadillo only sets mem_state to 0 for memory the matrix allocated
+    if (data.mem_state == 0) {
+      return;
+    }
+    arma::fmat owned(data);
+    data.reset();
+    data = std::move(owned);
+  }
+
+  void KMedoids::collapseData() {
+    const size_t n = data.n_cols;
+    const size_t bytes = data.n_rows * sizeof(float);
+    std::vector<uint64_t> hashes(n);
+    #pragma omp parallel for if (this->parallelize)
+    for (size_t i = 0; i < n; i++) {
+      // FNV-1a over the bytes of the point
+      const unsigned char *point =
+              reinterpret_cast<const unsigned char *>(data.colptr(i));
+      uint64_t hash = 14695981039346656037ULL;
+      for (size_t b = 0; b < bytes; b++) {
+        hash = (hash ^ point[b]) * 1099511628211ULL;
+      }
+      hashes[i] = hash;
+    }
+
+    // Unique points are numbered in the order of their first row; rows
+    // with equal hashes are compared to tell collisions from duplicates
+    std::unordered_multimap<uint64_t, size_t> firstRows;
+    firstRows.reserve(n);
+    std::vector<arma::uword> firsts;
+    arma::uvec rows(n);
+    for (size_t i = 0; i < n; i++) {
+      size_t point = firsts.size();
+      const auto candidates = firstRows.equal_range(hashes[i]);
+      for (auto it = candidates.first; it != candidates.second; ++it) {
+        if (std::memcmp(data.colptr(it->second), data.colptr(i), bytes) == 0) {
+          point = rows(it->second);
+          break;
+        }
+      }
+      if (point == firsts.size()) {
+        firstRows.emplace(hashes[i], i);
+        firsts.push_back(i);
+      }
+      rows(i) = point;
+    }
+
+    if (firsts.size() == n) {
+      return;
+    }
+    if (firsts.size() < nMedoids) {
+      throw std::invalid_argument(
+              "Error: there are fewer unique points than medoids");
+    }
+    const arma::uvec first(firsts);
+    const arma::fmat unique = data.cols(first);
+    arma::frowvec weights(first.n_elem, arma::fill::zeros);
+    for (size_t i = 0; i < n; i++) {
+      weights(rows(i)) += 1;
+    }
+    releaseData();
+    data = unique;
+    pointWeights = weights;
+    rowPoints = rows;
+    pointRows = first;
+  }
+
+  void KMedoids::expandResults() {
+    if (pointWeights.n_elem == 0) {
+      return;
+    }
+    arma::urowvec rowLabels(rowPoints.n_elem);
+    for (size_t i = 0; i < rowPoints.n_elem; i++) {
+      rowLabels(i) = labels(rowPoints(i));
+    }
+    labels = rowLabels;
+    for (size_t k = 0; k < medoidIndicesBuild.n_elem; k++) {
+      medoidIndicesBuild(k) = pointRows(medoidIndicesBuild(k));
+    }
+    for (size_t k = 0; k < medoidIndicesFinal.n_elem; k++) {
+      medoidIndicesFinal(k) = pointRows(medoidIndicesFinal(k));
+    }
+  }
+
   void KMedoids::checkAlgorithm(const std::string &algorithm) const {
     if ((algorithm != "BanditPAM") &&
         (algorithm != "BanditPAM_orig") &&
@@ -420,6 +1594,22 @@ namespace km {
     }
   }
 
+  void KMedoids::checkInitMedoids(
+          const arma::urowvec &initMedoids,
+          size_t n) const {
+    if (initMedoids.n_elem != nMedoids) {
+      throw std::invalid_argument(
+              "Number of initial medoids must equal the number of medoids");
+    }
+    if (arma::any(initMedoids >= n)) {
+      throw std::invalid_argument(
+              "Initial medoid index is out of range of the dataset");
+    }
+    if (arma::unique(initMedoids).eval().n_elem != initMedoids.n_elem) {
+      throw std::invalid_argument("Initial medoids must be distinct");
+    }
+  }
+
   float KMedoids::getAverageLoss() const {
     return averageLoss;
   }
@@ -0,0 +1,145 @@
+/**
+ * @file mapped_data.cpp
+ * @date 2026-10-16
+ *
+ * Contains the reader and writer of the memory-mapped on-disk dataset
+ * format used to cluster datasets larger than memory.
+ */
+
+#include "mapped_data.hpp"
+
+#include <armadillo>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace km {
+  namespace {
+    const char magic[8] = {'B', 'P', 'A', 'M', 'D', 'A', 'T', 'A'};
+  }  // namespace
+
+  MappedData::~MappedData() {
+    close();
+  }
+
+  void MappedData::write(
+          const std::string &path,
+          const arma::fmat &inputData) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw std::invalid_argument("Error: cannot write " + path);
+    }
+
+    char header[headerBytes] = {};
+    const uint64_t features = inputData.n_cols;
+    const uint64_t points = inputData.n_rows;
+    std::memcpy(header, magic, sizeof(magic));
+    std::memcpy(header + 8, &version, sizeof(version));
+    std::memcpy(header + 16, &features, sizeof(features));
+    std::memcpy(header + 24, &points, sizeof(points));
+    out.write(header, headerBytes);
+
+    // Points are written one at a time so that only one transposed point is
+    // held in memory besides the input
+    arma::fvec point(inputData.n_cols);
+    for (size_t i = 0; i < inputData.n_rows; i++) {
+      point = arma::trans(inputData.row(i));
+      out.write(reinterpret_cast<const char *>(point.memptr()),
+                point.n_elem * sizeof(float));
+    }
+    if (!out) {
+      throw std::invalid_argument("Error: cannot write " + path);
+    }
+  }
+
+  void MappedData::open(const std::string &path) {
+    close();
+#ifdef _WIN32
+    throw std::invalid_argument(
+            "Error: memory-mapped data is not supported on Windows");
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::invalid_argument("Error: cannot open " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+        static_cast<size_t>(status.st_size) < headerBytes) {
+      ::close(fd);
+      throw std::invalid_argument("Error: " + path + " is not a data file");
+    }
+
+    const size_t bytes = status.st_size;
+    void *mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+      throw std::invalid_argument("Error: cannot map " + path);
+    }
+
+    const char *header = static_cast<const char *>(mapped);
+    uint32_t fileVersion;
+    uint64_t features;
+    uint64_t points;
+    std::memcpy(&fileVersion, header + 8, sizeof(fileVersion));
+    std::memcpy(&features, header + 16, sizeof(features));
+    std::memcpy(&points, header + 24, sizeof(points));
+    if (std::memcmp(header, magic, sizeof(magic)) != 0 ||
+        fileVersion != version ||
+        bytes != headerBytes + features * points * sizeof(float)) {
+      munmap(mapped, bytes);
+      throw std::invalid_argument("Error: " + path + " is not a data file");
+    }
+
+    mapping = mapped;
+    mappingBytes = bytes;
+    nFeatures = features;
+    nPoints = points;
+#endif
+  }
+
+  void MappedData::close() {
+#ifndef _WIN32
+    if (mapping != nullptr) {
+      munmap(mapping, mappingBytes);
+    }
+#endif
+    mapping = nullptr;
+    mappingBytes = 0;
+    nFeatures = 0;
+    nPoints = 0;
+  }
+
+  bool MappedData::isOpen() const {
+    return mapping != nullptr;
+  }
+
+  arma::fmat MappedData::matrix() const {
+    float *coordinates = reinterpret_cast<float *>(
+            static_cast<char *>(mapping) + headerBytes);
+    // NOTE: the mapping is read-only, so the matrix must never be written;
+    //  strict is false so that reassigning it later allocates fresh memory
+    return arma::fmat(coordinates, nFeatures, nPoints, false, false);
+  }
+
+  void MappedData::prefetch(const arma::uword *points, size_t count) const {
+#ifndef _WIN32
+    const size_t pageBytes = sysconf(_SC_PAGESIZE);
+    const size_t pointBytes = nFeatures * sizeof(float);
+    char *base = static_cast<char *>(mapping);
+    for (size_t j = 0; j < count; j++) {
+      // madvise requires a page-aligned start
+      const size_t first = headerBytes + points[j] * pointBytes;
+      const size_t start = first - (first % pageBytes);
+      madvise(base + start, first + pointBytes - start, MADV_WILLNEED);
+    }
+#endif
+  }
+}  // namespace km
@@ -0,0 +1,260 @@
+/**
+ * @file model_file.cpp
+ * @date 2026-10-16
+ *
+ * Contains the reader and writer of the binary format in which fitted
+ * KMedoids models are saved.
+ */
+
+#include "model_file.hpp"
+
+#include <armadillo>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace km {
+  namespace {
+    const char magic[8] = {'B', 'P', 'A', 'M', 'M', 'O', 'D', 'L'};
+
+    /**
+     * @brief Appends values to the bytes of a model.
+     */
+    class Writer {
+     public:
+      explicit Writer(std::string *bytes) : bytes(bytes) {}
+
+      template <typename T>
+      void value(const T &value) {
+        bytes->append(reinterpret_cast<const char *>(&value), sizeof(value));
+      }
+
+      void string(const std::string &value) {
+        this->value<uint64_t>(value.size());
+        bytes->append(value);
+      }
+
+      void indices(const arma::urowvec &indices) {
+        value<uint64_t>(indices.n_elem);
+        for (size_t i = 0; i < indices.n_elem; i++) {
+          value<uint64_t>(indices(i));
+        }
+      }
+
+     private:
+      std::string *bytes;
+    };
+
+    /**
+     * @brief Reads values from the bytes of a model, throwing if they run
+     * out.
+     */
+    class Reader {
+     public:
+      Reader(const char *bytes, size_t size) : bytes(bytes), size(size) {}
+
+      template <typename T>
+      void value(T *value) {
+        std::memcpy(value, take(sizeof(*value)), sizeof(*value));
+      }
+
+      void string(std::string *value) {
+        uint64_t length = 0;
+        this->value(&length);
+        value->assign(take(length), length);
+      }
+
+      void indices(arma::urowvec *indices) {
+        uint64_t length = 0;
+        value(&length);
+        if (length > (size - position) / sizeof(uint64_t)) {
+          fail();
+        }
+        indices->set_size(length);
+        for (size_t i = 0; i < length; i++) {
+          uint64_t index = 0;
+          value(&index);
+          (*indices)(i) = index;
+        }
+      }
+
+      const char *take(size_t count) {
+        if (count > size - position) {
+          fail();
+        }
+        const char *start = bytes + position;
+        position += count;
+        return start;
+      }
+
+     private:
+      [[noreturn]] void fail() {
+        throw std::invalid_argument("Error: the model is truncated");
+      }
+
+      const char *bytes;
+      size_t size;
+      size_t position = 0;
+    };
+  }  // namespace
+
+  std::string ModelFile::serialize() const {
+    std::string bytes(magic, sizeof(magic));
+    Writer out(&bytes);
+    out.value(version);
+
+    out.value(nMedoids);
+    out.string(algorithm);
+    out.string(buildMethod);
+    out.string(loss);
+    out.value(maxIter);
+    out.value(maxSwapsPerIter);
+    out.value(nInit);
+    out.value(buildConfidence);
+    out.value(swapConfidence);
+    out.value(seed);
+    out.value(cacheWidth);
+    out.value(useCache);
+    out.value(usePerm);
+    out.value(parallelize);
+    out.value(reuseArmStats);
+    out.value(onlineSigma);
+    out.value(useMedoidTree);
+    out.value(tolerance);
+    out.value(relativeTolerance);
+    out.value(timeBudget);
+    out.value(distanceBudget);
+    out.value(collapseDuplicates);
+
+    out.indices(buildMedoids);
+    out.indices(medoids);
+    out.indices(labels);
+    out.value(averageLoss);
+    out.value(buildLoss);
+    out.value(steps);
+
+    out.value<uint64_t>(medoidCoordinates.n_rows);
+    out.value<uint64_t>(medoidCoordinates.n_cols);
+    bytes.append(reinterpret_cast<const char *>(medoidCoordinates.memptr()),
+                 medoidCoordinates.n_elem * sizeof(float));
+    return bytes;
+  }
+
+  void ModelFile::deserialize(const char *bytes, size_t size) {
+    Reader in(bytes, size);
+    uint32_t bytesVersion = 0;
+    if (size < sizeof(magic) ||
+        std::memcmp(in.take(sizeof(magic)), magic, sizeof(magic)) != 0) {
+      throw std::invalid_argument("Error: not a BanditPAM model");
+    }
+    in.value(&bytesVersion);
+    if (bytesVersion == 0 || bytesVersion > version) {
+      throw std::invalid_argument(
+              "Error: the model was saved by a newer version of BanditPAM");
+    }
+
+    in.value(&nMedoids);
+    in.string(&algorithm);
+    in.string(&buildMethod);
+    in.string(&loss);
+    in.value(&maxIter);
+    in.value(&maxSwapsPerIter);
+    in.value(&nInit);
+    in.value(&buildConfidence);
+    in.value(&swapConfidence);
+    in.value(&seed);
+    in.value(&cacheWidth);
+    in.value(&useCache);
+    in.value(&usePerm);
+    in.value(&parallelize);
+    in.value(&reuseArmStats);
+    in.value(&onlineSigma);
+    in.value(&useMedoidTree);
+    in.value(&tolerance);
+    in.value(&relativeTolerance);
+    in.value(&timeBudget);
+    in.value(&distanceBudget);
+    if (bytesVersion >= 2) {
+      in.value(&collapseDuplicates);
+    }
+
+    in.indices(&buildMedoids);
+    in.indices(&medoids);
+    in.indices(&labels);
+    in.value(&averageLoss);
+    in.value(&buildLoss);
+    in.value(&steps);
+
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    in.value(&rows);
+    in.value(&cols);
+    if (cols != 0 && cols != medoids.n_elem) {
+      throw std::invalid_argument(
+              "Error: the model has coordinates for the wrong number of "
+              "medoids");
+    }
+    // Checked before multiplying so that the product cannot overflow
+    if (cols != 0 && rows > size / sizeof(float) / cols) {
+      throw std::invalid_argument("Error: the model is truncated");
+    }
+    const char *coordinates = in.take(rows * cols * sizeof(float));
+    medoidCoordinates.set_size(rows, cols);
+    std::memcpy(medoidCoordinates.memptr(), coordinates,
+                rows * cols * sizeof(float));
+  }
+
+  void ModelFile::write(const std::string &path) const {
+    const std::string bytes = serialize();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    if (!out) {
+      throw std::invalid_argument("Error: cannot write " + path);
+    }
+  }
+
+  void ModelFile::read(const std::string &path) {
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      throw std::invalid_argument("Error: cannot open " + path);
+    }
+    const std::string bytes(
+            (std::istreambuf_iterator<char>(in)),
+            std::istreambuf_iterator<char>());
+    deserialize(bytes.data(), bytes.size());
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::invalid_argument("Error: cannot open " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+      ::close(fd);
+      throw std::invalid_argument("Error: " + path + " is not a model");
+    }
+    const size_t bytes = status.st_size;
+    void *mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+      throw std::invalid_argument("Error: cannot map " + path);
+    }
+    try {
+      deserialize(static_cast<const char *>(mapped), bytes);
+    } catch (...) {
+      munmap(mapped, bytes);
+      throw;
+    }
+    munmap(mapped, bytes);
+#endif
+  }
+}  // namespace km
@@ -0,0 +1,330 @@
+/**
+ * @file model_server.cpp
+ * @date 2026-10-16
+ *
+ * Contains the batching of assignment requests and the handling of the
+ * requests of a connection used by the model server, apart from its socket
+ * I/O.
+ */
+
+#include "model_server.hpp"
+
+#include <armadillo>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace km {
+  namespace {
+    uint64_t microseconds(std::chrono::steady_clock::duration duration) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+              duration).count();
+    }
+
+    bool writeHeader(
+            const std::function<bool(const void *, size_t)> &write,
+            uint32_t status,
+            uint64_t count) {
+      char header[16] = {};
+      std::memcpy(header, &status, sizeof(status));
+      std::memcpy(header + 8, &count, sizeof(count));
+      return write(header, sizeof(header));
+    }
+
+    bool writeText(
+            const std::function<bool(const void *, size_t)> &write,
+            uint32_t status,
+            const std::string &text) {
+      return writeHeader(write, status, text.size()) &&
+             write(text.data(), text.size());
+    }
+  }  // namespace
+
+  void Histogram::record(uint64_t value) {
+    size_t bucket = 0;
+    while (bucket + 1 < counts.size() && (value >> bucket) != 0) {
+      bucket++;
+    }
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t largest = max.load(std::memory_order_relaxed);
+    while (value > largest &&
+           !max.compare_exchange_weak(largest, value)) {}
+  }
+
+  std::string Histogram::json() const {
+    std::array<uint64_t, 48> snapshot;
+    uint64_t count = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+      snapshot[b] = counts[b].load(std::memory_order_relaxed);
+      count += snapshot[b];
+    }
+    std::ostringstream out;
+    out << "{\"count\":" << count << ",\"mean\":"
+        << (count == 0 ? 0.0
+            : static_cast<double>(sum.load(std::memory_order_relaxed)) /
+              count)
+        << ",\"max\":" << max.load(std::memory_order_relaxed);
+    const double quantiles[] = {0.5, 0.9, 0.99};
+    const char *names[] = {"p50", "p90", "p99"};
+    for (size_t q = 0; q < 3; q++) {
+      uint64_t seen = 0;
+      size_t b = 0;
+      while (b + 1 < snapshot.size() &&
+             seen + snapshot[b] < quantiles[q] * count) {
+        seen += snapshot[b];
+        b++;
+      }
+      out << ",\"" << names[q] << "\":" << (count == 0 ? 0 : upper(b));
+    }
+    out << ",\"buckets\":{";
+    bool first = true;
+    for (size_t b = 0; b < snapshot.size(); b++) {
+      if (snapshot[b] != 0) {
+        out << (first ? "" : ",") << "\"" << upper(b) << "\":"
+            << snapshot[b];
+        first = false;
+      }
+    }
+    out << "}}";
+    return out.str();
+  }
+
+  uint64_t Histogram::upper(size_t bucket) {
+    return uint64_t(1) << bucket;
+  }
+
+  Batcher::Batcher(
+          const KMedoids &model,
+          size_t maxBatchPoints,
+          std::chrono::microseconds maxWait)
+    : nFeatures(model.getMedoidCoordinates().n_rows),
+      model(model),
+      maxBatchPoints(maxBatchPoints),
+      maxWait(maxWait) {}
+
+  void Batcher::submit(AssignRequest *request) {
+    std::future<void> done = request->done.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stopping) {
+        request->error = "Error: the server is stopping";
+        return;
+      }
+      queue.push_back(request);
+      queuedPoints += request->nPoints;
+    }
+    ready.notify_one();
+    done.wait();
+  }
+
+  void Batcher::run() {
+    for (;;) {
+      std::vector<AssignRequest *> batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+          return;
+        }
+        // The oldest request waits at most maxWait for others to join it
+        ready.wait_until(
+                lock,
+                queue.front()->received + maxWait,
+                [this] { return stopping || queuedPoints >= maxBatchPoints; });
+        size_t taken = 0;
+        while (!queue.empty() &&
+               (batch.empty() ||
+                taken + queue.front()->nPoints <= maxBatchPoints)) {
+          taken += queue.front()->nPoints;
+          queuedPoints -= queue.front()->nPoints;
+          batch.push_back(queue.front());
+          queue.pop_front();
+        }
+      }
+      assign(batch);
+    }
+  }
+
+  void Batcher::stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    ready.notify_all();
+  }
+
+  std::string Batcher::stats() const {
+    std::ostringstream out;
+    out << "{\"requests\":" << requests.load()
+        << ",\"points\":" << points.load()
+        << ",\"batches\":" << batches.load()
+        << ",\"latency_us\":" << latency.json()
+        << ",\"queue_us\":" << queueing.json()
+        << ",\"predict_us\":" << predicting.json()
+        << ",\"batch_requests\":" << batchRequests.json()
+        << ",\"batch_points\":" << batchPoints.json() << "}";
+    return out.str();
+  }
+
+  void Batcher::assign(const std::vector<AssignRequest *> &batch) {
+    const auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    for (const AssignRequest *request : batch) {
+      total += request->nPoints;
+    }
+
+    // A lone request is assigned in place; the points of each request are
+    // otherwise copied side by side, as they are already one per column
+    arma::fmat transposedData = batch.size() == 1
+            ? arma::fmat(
+                    const_cast<float *>(batch.front()->points),
+                    nFeatures,
+                    total,
+                    false,
+                    true)
+            : arma::fmat(nFeatures, total);
+    if (batch.size() > 1) {
+      size_t offset = 0;
+      for (const AssignRequest *request : batch) {
+        std::memcpy(
+                transposedData.colptr(offset),
+                request->points,
+                request->nPoints * nFeatures * sizeof(float));
+        offset += request->nPoints;
+      }
+    }
+
+    arma::urowvec labels;
+    arma::frowvec distances;
+    std::string error;
+    try {
+      labels = model.predictTransposed(transposedData, &distances);
+    } catch (std::exception &e) {
+      error = e.what();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    predicting.record(microseconds(end - start));
+    batchRequests.record(batch.size());
+    batchPoints.record(total);
+    batches++;
+    size_t offset = 0;
+    for (AssignRequest *request : batch) {
+      const size_t last = offset + request->nPoints - 1;
+      if (error.empty()) {
+        request->labels = labels.cols(offset, last);
+        request->distances = distances.cols(offset, last);
+      } else {
+        request->error = error;
+      }
+      queueing.record(microseconds(start - request->received));
+      latency.record(microseconds(end - request->received));
+      requests++;
+      points += request->nPoints;
+      offset = last + 1;
+      request->done.set_value();
+    }
+  }
+
+  std::string modelInfo(const KMedoids &model) {
+    std::ostringstream out;
+    out.precision(std::numeric_limits<float>::max_digits10);
+    out << "{\"medoids\":" << model.getNMedoids()
+        << ",\"features\":" << model.getMedoidCoordinates().n_rows
+        << ",\"loss_fn\":\"" << model.getLossFn() << "\",\"loss\":";
+    // JSON has no infinity or NaN
+    if (std::isfinite(model.getAverageLoss())) {
+      out << model.getAverageLoss();
+    } else {
+      out << "null";
+    }
+    out << "}";
+    return out.str();
+  }
+
+  void serveRequests(
+          const std::function<bool(void *, size_t)> &read,
+          const std::function<bool(const void *, size_t)> &write,
+          Batcher *batcher,
+          const std::string &info) {
+    std::vector<float> points;
+    std::vector<uint64_t> labels;
+    for (;;) {
+      char header[16];
+      if (!read(header, sizeof(header))) {
+        return;
+      }
+      uint32_t type;
+      uint32_t reserved;
+      uint64_t nPoints;
+      std::memcpy(&type, header, sizeof(type));
+      std::memcpy(&reserved, header + 4, sizeof(reserved));
+      std::memcpy(&nPoints, header + 8, sizeof(nPoints));
+      if (reserved != 0) {
+        writeText(write, 1, "Error: malformed request header");
+        return;
+      }
+
+      if (type == STATS_REQUEST) {
+        if (!writeText(write, 0, batcher->stats())) {
+          return;
+        }
+        continue;
+      } else if (type == INFO_REQUEST) {
+        if (!writeText(write, 0, info)) {
+          return;
+        }
+        continue;
+      } else if (type != ASSIGN_REQUEST) {
+        writeText(write, 1, "Error: unknown request type");
+        return;
+      }
+
+      uint64_t nFeatures;
+      if (!read(&nFeatures, sizeof(nFeatures))) {
+        return;
+      }
+      if (nPoints == 0 || nFeatures == 0 ||
+          nPoints > MAX_REQUEST_VALUES / nFeatures) {
+        writeText(write, 1, "Error: the request has no points or too many");
+        return;
+      }
+      points.resize(nPoints * nFeatures);
+      if (!read(points.data(), points.size() * sizeof(float))) {
+        return;
+      }
+      if (nFeatures != batcher->nFeatures) {
+        // The points were read, so the connection can still be used
+        if (!writeText(write, 1,
+                       "Error: points must have " +
+                       std::to_string(batcher->nFeatures) + " features")) {
+          return;
+        }
+        continue;
+      }
+
+      AssignRequest request;
+      request.points = points.data();
+      request.nPoints = nPoints;
+      request.received = std::chrono::steady_clock::now();
+      batcher->submit(&request);
+      if (!request.error.empty()) {
+        if (!writeText(write, 1, request.error)) {
+          return;
+        }
+        continue;
+      }
+      labels.assign(request.labels.begin(), request.labels.end());
+      if (!writeHeader(write, 0, nPoints) ||
+          !write(labels.data(), labels.size() * sizeof(uint64_t)) ||
+          !write(request.distances.memptr(),
+                 request.distances.n_elem * sizeof(float))) {
+        return;
+      }
+    }
+  }
+}  // namespace km
@@ -15,11 +15,14 @@
 
 namespace km {
   void PAM::fitPAM(
-          const arma::fmat &inputData,
-          std::optional<std::reference_wrapper<const arma::fmat>> distMat) {
-    data = arma::trans(inputData);
+          std::optional<std::reference_wrapper<const arma::fmat>> distMat,
+          std::optional<arma::urowvec> initMedoids) {
     arma::urowvec medoidIndices(nMedoids);
-    PAM::buildPAM(data, distMat, &medoidIndices);
+    if (initMedoids) {
+      medoidIndices = initMedoids.value();
+    } else {
+      PAM::buildPAM(data, distMat, &medoidIndices);
+    }
     steps = 0;
     medoidIndicesBuild = medoidIndices;
     arma::urowvec assignments(data.n_cols);
@@ -34,6 +37,9 @@ namespace km {
 
       medoidChange = arma::any(medoidIndices != previous);
       i++;
+      if (fitCancelled() || budgetSpent()) {
+        break;
+      }
     }
     medoidIndicesFinal = medoidIndices;
     labels = assignments;
@@ -0,0 +1,49 @@
+/**
+ * @file workspace.cpp
+ * @date 2026-10-16
+ *
+ * Contains the preallocated buffers reused across the rounds of the
+ * BanditPAM BUILD and SWAP steps.
+ */
+
+#include "workspace.hpp"
+
+#include <armadillo>
+#include <algorithm>
+
+namespace km {
+  void Workspace::reserve(
+          size_t n,
+          size_t k,
+          size_t batchSize,
+          size_t nThreads,
+          bool withSquares) {
+    // Only grow the buffers; views into their prefixes are used otherwise
+    if (referencePoints.n_elem < n) {
+      referencePoints.set_size(n);
+    }
+    if (targets.n_elem < n) {
+      targets.set_size(n);
+    }
+    if (results.n_elem < k * n) {
+      results.set_size(k * n);
+    }
+    if (withSquares && squares.n_elem < k * n) {
+      squares.set_size(k * n);
+    }
+    if (sigmaSamples.n_rows < batchSize || sigmaSamples.n_cols < nThreads) {
+      // Each dimension grows independently so neither ever shrinks
+      sigmaSamples.set_size(
+              std::max<size_t>(sigmaSamples.n_rows, batchSize),
+              std::max<size_t>(sigmaSamples.n_cols, nThreads));
+    }
+  }
+
+  void Workspace::release() {
+    referencePoints.reset();
+    targets.reset();
+    results.reset();
+    squares.reset();
+    sigmaSamples.reset();
+  }
+}  // namespace km
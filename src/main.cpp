@@ -7,18 +7,213 @@
  *
  * Usage (from home repo directory):
  * ./src/build/BanditPAM -f [path/to/input] -k [number of clusters]
+ *
+ * The input is read in the format given by -t: raw float32 points (with
+ * the number of features given by -d), .npy, Armadillo binary, or CSV, or
+ * detected from the file by default.
+ *
+ * -k and -s take comma-separated lists, e.g. -k 5,10,20 -s 0,1,2. The data
+ * is loaded once; for each seed a single BUILD up to the largest k is
+ * followed by a SWAP for each k, sharing the distance cache. A single k and
+ * seed is a plain fit. With -o, the
+ * medoids, labels, losses, timings and distance computations of every fit
+ * are written to a file in the format given by -F:
+ *  - "json" (default): an object with the loss, the number of points and
+ *    features, the load time and a "fits" array with one object per seed
+ *  - "binary": the magic string "BPAMRSLT", a uint32 version, then the
+ *    same fields as the JSON output in the same order, as little-endian
+ *    uint64 integers, float32 values and length-prefixed arrays
  */
 
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <exception>
 #include <filesystem>
+#include <limits>
+#include <sstream>
+#include <vector>
 
+#include "data_loader.hpp"
 #include "kmedoids_algorithm.hpp"
 
+namespace {
+/**
+ * @brief Results of fitting every k for one seed.
+ */
+struct SeedResults {
+  size_t seed;
+  float buildTime;
+  size_t buildDistanceComputations;
+  size_t miscDistanceComputations;
+  arma::urowvec ks;
+  std::vector<arma::urowvec> medoids;
+  std::vector<arma::urowvec> labels;
+  arma::frowvec buildLosses;
+  arma::frowvec losses;
+  arma::urowvec steps;
+  arma::frowvec swapTimes;
+  arma::urowvec swapDistanceComputations;
+};
+
+/**
+ * @brief Parses a comma-separated list of non-negative integers.
+ *
+ * @param text List to parse
+ * @param flag Flag the list was given with, for the error message
+ *
+ * @returns The integers of the list
+ *
+ * @throws If an element of the list is not a non-negative integer
+ */
+std::vector<size_t> parseList(const std::string &text, char flag) {
+  std::vector<size_t> values;
+  std::istringstream in(text);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (item.empty() ||
+        item.find_first_not_of("0123456789") != std::string::npos) {
+      throw std::invalid_argument(
+              std::string("Error: -") + flag +
+              " takes a comma-separated list of non-negative integers");
+    }
+    values.push_back(std::stoull(item));
+  }
+  if (values.empty()) {
+    throw std::invalid_argument(
+            std::string("Error: -") + flag + " needs at least one value");
+  }
+  return values;
+}
+
+/**
+ * @brief Writes a float as a JSON number, or null if it is not finite.
+ */
+void writeJsonFloat(std::ostream &out, float value) {
+  if (std::isfinite(value)) {
+    out << value;
+  } else {
+    out << "null";
+  }
+}
+
+template <typename Values>
+void writeJsonArray(std::ostream &out, const Values &values) {
+  out << "[";
+  for (size_t i = 0; i < values.n_elem; i++) {
+    out << (i == 0 ? "" : ",") << values(i);
+  }
+  out << "]";
+}
+
+void writeJson(
+        const std::string &path,
+        const std::string &loss,
+        const arma::fmat &data,
+        float loadTime,
+        const std::vector<SeedResults> &results) {
+  std::ofstream out(path, std::ios::trunc);
+  if (!out) {
+    throw std::invalid_argument("Error: cannot write " + path);
+  }
+  out.precision(std::numeric_limits<float>::max_digits10);
+  out << "{\"loss\":\"" << loss << "\",\"points\":" << data.n_cols
+      << ",\"features\":" << data.n_rows << ",\"load_milliseconds\":";
+  writeJsonFloat(out, loadTime);
+  out << ",\"fits\":[";
+  for (size_t s = 0; s < results.size(); s++) {
+    const SeedResults &result = results[s];
+    out << (s == 0 ? "" : ",") << "\n{\"seed\":" << result.seed
+        << ",\"build_milliseconds\":";
+    writeJsonFloat(out, result.buildTime);
+    out << ",\"build_distance_computations\":"
+        << result.buildDistanceComputations
+        << ",\"misc_distance_computations\":"
+        << result.miscDistanceComputations << ",\"results\":[";
+    for (size_t r = 0; r < result.medoids.size(); r++) {
+      out << (r == 0 ? "" : ",") << "\n{\"k\":" << result.ks(r)
+          << ",\"medoids\":";
+      writeJsonArray(out, result.medoids[r]);
+      out << ",\"labels\":";
+      writeJsonArray(out, result.labels[r]);
+      out << ",\"build_loss\":";
+      writeJsonFloat(out, result.buildLosses(r));
+      out << ",\"loss\":";
+      writeJsonFloat(out, result.losses(r));
+      out << ",\"steps\":" << result.steps(r) << ",\"swap_milliseconds\":";
+      writeJsonFloat(out, result.swapTimes(r));
+      out << ",\"swap_distance_computations\":"
+          << result.swapDistanceComputations(r) << "}";
+    }
+    out << "]}";
+  }
+  out << "]}\n";
+  if (!out) {
+    throw std::invalid_argument("Error: cannot write " + path);
+  }
+}
+
+template <typename T>
+void writeValue(std::ofstream &out, const T &value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void writeIndices(std::ofstream &out, const arma::urowvec &indices) {
+  writeValue<uint64_t>(out, indices.n_elem);
+  for (size_t i = 0; i < indices.n_elem; i++) {
+    writeValue<uint64_t>(out, indices(i));
+  }
+}
+
+void writeBinary(
+        const std::string &path,
+        const std::string &loss,
+        const arma::fmat &data,
+        float loadTime,
+        const std::vector<SeedResults> &results) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::invalid_argument("Error: cannot write " + path);
+  }
+  const char magic[8] = {'B', 'P', 'A', 'M', 'R', 'S', 'L', 'T'};
+  const uint32_t version = 1;
+  out.write(magic, sizeof(magic));
+  writeValue(out, version);
+  writeValue<uint64_t>(out, loss.size());
+  out.write(loss.data(), loss.size());
+  writeValue<uint64_t>(out, data.n_cols);
+  writeValue<uint64_t>(out, data.n_rows);
+  writeValue(out, loadTime);
+  writeValue<uint64_t>(out, results.size());
+  for (const SeedResults &result : results) {
+    writeValue<uint64_t>(out, result.seed);
+    writeValue(out, result.buildTime);
+    writeValue<uint64_t>(out, result.buildDistanceComputations);
+    writeValue<uint64_t>(out, result.miscDistanceComputations);
+    writeValue<uint64_t>(out, result.medoids.size());
+    for (size_t r = 0; r < result.medoids.size(); r++) {
+      writeValue<uint64_t>(out, result.ks(r));
+      writeIndices(out, result.medoids[r]);
+      writeIndices(out, result.labels[r]);
+      writeValue(out, result.buildLosses(r));
+      writeValue(out, result.losses(r));
+      writeValue<uint64_t>(out, result.steps(r));
+      writeValue(out, result.swapTimes(r));
+      writeValue<uint64_t>(out, result.swapDistanceComputations(r));
+    }
+  }
+  if (!out) {
+    throw std::invalid_argument("Error: cannot write " + path);
+  }
+}
+}  // namespace
+
 int main(int argc, char *argv[]) {
   std::string input_name;
-  size_t k;
+  std::vector<size_t> ks;
   int opt;
   int prev_ind;
   size_t maxIter = 100;
@@ -30,58 +225,85 @@ int main(int argc, char *argv[]) {
   const int ARGUMENT_ERROR_CODE = 1;
   bool useCache = true;
   bool usePerm = true;
-  int seed = 0;
+  std::vector<size_t> seeds = {0};
   int num_data = 0;
   bool parallelize = false;
+  std::string format = "auto";
+  int num_features = 0;
+  std::string output_name;
+  std::string output_format = "json";
+  int num_threads = 0;
 
   // TODO(@motiwari): Use a variadic function signature for this instead
-  while (prev_ind = optind,
-          (opt = getopt(argc, argv, "f:l:k:v:s:cpnw:")) != -1) {
-    if (optind == prev_ind + 2 && *optarg == '-') {
-      opt = ':';
-      --optind;
-    }
+  try {
+    while (prev_ind = optind,
+            (opt = getopt(argc, argv, "f:l:k:v:s:n:w:t:d:o:F:CPj:")) != -1) {
+      if (optind == prev_ind + 2 && *optarg == '-') {
+        opt = ':';
+        --optind;
+      }
 
-    switch (opt) {
-      // path to the data file to be read in
-      case 'f':
-        input_name = optarg;
-        f_flag = true;
-        break;
-        // number of clusters to create
-      case 'k':
-        k = std::stoi(optarg);
-        k_flag = true;
-        break;
-        // type of loss/distance function to use
-      case 'l':
-        loss = optarg;
-        break;
-      case 's':
-        seed = std::stoi(optarg);
-        break;
-      case ':':
-        printf("option needs a value\n");
-        return ARGUMENT_ERROR_CODE;
-      case 'c':
-        useCache = true;
-        break;
-      case 'p':
-        usePerm = true;
-        break;
-      case 'n':
-        num_data = std::stoi(optarg);
-        break;
-      case 'w':
-        parallelize = true;
-        break;
-      case '?':
-        printf("unknown option: %c\n", optopt);
-        return ARGUMENT_ERROR_CODE;
+      switch (opt) {
+        // path to the data file to be read in
+        case 'f':
+          input_name = optarg;
+          f_flag = true;
+          break;
+          // numbers of clusters to create
+        case 'k':
+          ks = parseList(optarg, 'k');
+          k_flag = true;
+          break;
+          // type of loss/distance function to use
+        case 'l':
+          loss = optarg;
+          break;
+          // random seeds, each of which fits every number of clusters
+        case 's':
+          seeds = parseList(optarg, 's');
+          break;
+        case ':':
+          printf("option needs a value\n");
+          return ARGUMENT_ERROR_CODE;
+          // disable the distance cache or the permutation of reference points
+        case 'C':
+          useCache = false;
+          break;
+        case 'P':
+          usePerm = false;
+          break;
+        case 'n':
+          num_data = std::stoi(optarg);
+          break;
+        case 'w':
+          parallelize = true;
+          break;
+          // number of threads of a parallel fit, which implies -w
+        case 'j':
+          num_threads = std::stoi(optarg);
+          parallelize = true;
+          break;
+          // format of the data file: auto, raw, npy, arma or csv
+        case 't':
+          format = optarg;
+          break;
+          // number of features of each point of a raw data file
+        case 'd':
+          num_features = std::stoi(optarg);
+          break;
+          // path and format (json or binary) of the results file
+        case 'o':
+          output_name = optarg;
+          break;
+        case 'F':
+          output_format = optarg;
+          break;
+        case '?':
+          printf("unknown option: %c\n", optopt);
+          return ARGUMENT_ERROR_CODE;
+      }
     }
-  }
 
-  try {
     if (!f_flag) {
       throw std::invalid_argument(
               "Error: Must specify input file via -f flag");
@@ -91,24 +313,54 @@ int main(int argc, char *argv[]) {
     } else if (!std::filesystem::exists(input_name)) {
       throw std::invalid_argument(
               "Error: The file does not exist");
+    } else if (num_data < 0) {
+      throw std::invalid_argument(
+              "Error: num_data passed was less than 0");
+    } else if (num_features < 0) {
+      throw std::invalid_argument(
+              "Error: num_features passed was less than 0");
+    } else if (num_threads < 0) {
+      throw std::invalid_argument(
+              "Error: num_threads passed was less than 0");
+    } else if (output_format != "json" && output_format != "binary") {
+      throw std::invalid_argument(
+              "Error: the output format must be json or binary");
     }
   } catch (std::invalid_argument &e) {
     std::cout << e.what() << std::endl;
     return ARGUMENT_ERROR_CODE;
   }
+  if (num_threads > 0) {
+    omp_set_num_threads(num_threads);
+  }
 
-  arma::fmat data;
-  data.load(input_name);
-
-  if (num_data < 0) {
-    throw std::invalid_argument(
-            "Error: num_data passed was less than 0");
-  } else if (num_data != 0) {
-    data.resize(num_data, data.n_cols);
+  km::DataLoader loader;
+  arma::fmat transposedData;
+  const auto loadStart = std::chrono::steady_clock::now();
+  try {
+    // The points are loaded one per column, and binary files are mapped
+    // rather than read
+    transposedData = loader.load(input_name, format, num_features);
+  } catch (std::invalid_argument &e) {
+    std::cout << e.what() << std::endl;
+    return ARGUMENT_ERROR_CODE;
   }
+  const float loadTime = std::chrono::duration<float, std::milli>(
+          std::chrono::steady_clock::now() - loadStart).count();
+
+  // Only the first num_data points are used, without copying them
+  const size_t n = num_data == 0
+                   ? transposedData.n_cols
+                   : std::min<size_t>(num_data, transposedData.n_cols);
+  const arma::fmat data(
+          transposedData.memptr(),
+          transposedData.n_rows,
+          n,
+          false,
+          true);
 
   km::KMedoids kmed(
-          k,
+          ks.front(),
           "BanditPAM",
           maxIter,
           buildConfidence,
@@ -117,13 +369,75 @@ int main(int argc, char *argv[]) {
           usePerm,
           1000,  // Cache Width
           parallelize,
-          seed);
-  kmed.fit(data, loss, {});
-  for (auto medoid : kmed.getMedoidsFinal()) {
-    std::cout << medoid << ",";
+          seeds.front());
+  const arma::urowvec kRange = arma::conv_to<arma::urowvec>::from(ks);
+  std::vector<SeedResults> results;
+  try {
+    for (size_t seed : seeds) {
+      kmed.setSeed(seed);
+      SeedResults result;
+      result.seed = seed;
+      result.ks = kRange;
+      if (ks.size() == 1 && seeds.size() == 1) {
+        // A single fit has nothing to share between fits
+        const auto fitStart = std::chrono::steady_clock::now();
+        kmed.fitTransposed(data, loss, std::nullopt);
+        const float fitTime = std::chrono::duration<float, std::milli>(
+                std::chrono::steady_clock::now() - fitStart).count();
+        // The fit times its SWAP; the rest of it is mostly BUILD
+        const float swapTime = kmed.getTotalSwapTime();
+        result.buildTime = std::max(0.0f, fitTime - swapTime);
+        result.medoids = {kmed.getMedoidsFinal()};
+        result.labels = {kmed.getLabels()};
+        result.buildLosses = {kmed.getBuildLoss()};
+        result.losses = {kmed.getAverageLoss()};
+        result.steps = {static_cast<arma::uword>(kmed.getSteps())};
+        result.swapTimes = {swapTime};
+        result.swapDistanceComputations = {
+                static_cast<arma::uword>(kmed.getSwapDistanceComputations())};
+      } else {
+        kmed.fitKRangeTransposed(data, loss, kRange);
+        result.buildTime = kmed.getKRangeBuildTime();
+        result.medoids = kmed.getKRangeMedoids();
+        result.labels = kmed.getKRangeLabels();
+        result.buildLosses = kmed.getKRangeBuildLosses();
+        result.losses = kmed.getKRangeLosses();
+        result.steps = kmed.getKRangeSteps();
+        result.swapTimes = kmed.getKRangeSwapTimes();
+        result.swapDistanceComputations =
+                kmed.getKRangeSwapDistanceComputations();
+      }
+      result.buildDistanceComputations = kmed.getBuildDistanceComputations();
+      result.miscDistanceComputations = kmed.getMiscDistanceComputations();
+
+      for (size_t r = 0; r < result.medoids.size(); r++) {
+        if (seeds.size() > 1 || ks.size() > 1) {
+          std::cout << "Seed: " << seed << ", k: " << ks[r] << "\n";
+        }
+        for (auto medoid : result.medoids[r]) {
+          std::cout << medoid << ",";
+        }
+        std::cout << "Final loss: " << result.losses(r) << "\n";
+        std::cout << "Num Swap Steps: " << result.steps(r) << "\n";
+        std::cout << "Total Swap Milliseconds: " << result.swapTimes(r)
+                  << "\n";
+        std::cout << "Average Swap Milliseconds: "
+                  << (result.steps(r) == 0
+                      ? 0 : result.swapTimes(r) / result.steps(r))
+                  << "\n";
+      }
+      results.push_back(std::move(result));
+    }
+
+    if (output_name.empty()) {
+      return 0;
+    } else if (output_format == "json") {
+      writeJson(output_name, loss, data, loadTime, results);
+    } else {
+      writeBinary(output_name, loss, data, loadTime, results);
+    }
+  } catch (std::invalid_argument &e) {
+    std::cout << e.what() << std::endl;
+    return ARGUMENT_ERROR_CODE;
   }
-  std::cout << "Final loss: " << kmed.getAverageLoss() << "\n";
-  std::cout << "Num Swap Steps: " << kmed.getSteps() << "\n";
-  std::cout << "Total Swap Milliseconds: " << kmed.getTotalSwapTime() << "\n";
-  std::cout << "Average Swap Milliseconds: " << kmed.getTimePerSwap() << "\n";
 }
@@ -0,0 +1,93 @@
+/**
+ * @file distance_matrix_python.cpp
+ * @date 2026-10-16
+ *
+ * Defines the function computeDistanceMatrixPython, which is used in Python
+ * bindings.
+ */
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <armadillo>
+#include <string>
+#include <vector>
+
+#include "kmedoids_pywrapper.hpp"
+
+namespace km {
+  pybind11::array computeDistanceMatrixPython(
+          const pybind11::array_t<float,
+                  pybind11::array::c_style | pybind11::array::forcecast>
+                  &inputData,
+          const std::string &loss,
+          pybind11::object out,
+          bool condensed,
+          pybind11::object dtype,
+          bool parallelize) {
+    if (inputData.ndim() != 2) {
+      throw pybind11::value_error("Error: X must be two-dimensional.");
+    }
+    const size_t N = inputData.shape(0);
+    const size_t condensedSize = N > 0 ? N * (N - 1) / 2 : 0;
+
+    pybind11::array distances;
+    if (out.is_none()) {
+      std::vector<pybind11::ssize_t> shape;
+      if (condensed) {
+        shape = {static_cast<pybind11::ssize_t>(condensedSize)};
+      } else {
+        shape = {static_cast<pybind11::ssize_t>(N),
+                 static_cast<pybind11::ssize_t>(N)};
+      }
+      distances = pybind11::array(pybind11::dtype::from_args(dtype), shape);
+    } else {
+      if (!pybind11::isinstance<pybind11::array>(out)) {
+        throw pybind11::value_error("Error: out must be a numpy array.");
+      }
+      distances = pybind11::reinterpret_borrow<pybind11::array>(out);
+      if (condensed != (distances.ndim() == 1)) {
+        throw pybind11::value_error(
+                condensed
+                ? "Error: out must be one-dimensional when condensed is True."
+                : "Error: out must be two-dimensional unless condensed is "
+                  "True.");
+      }
+      const bool shapeMatches = condensed
+              ? static_cast<size_t>(distances.shape(0)) == condensedSize
+              : distances.ndim() == 2 &&
+                static_cast<size_t>(distances.shape(0)) == N &&
+                static_cast<size_t>(distances.shape(1)) == N;
+      if (!shapeMatches) {
+        throw pybind11::value_error(
+                "Error: out must have shape (n, n) or (n * (n - 1) / 2,).");
+      }
+      if (!(distances.flags() & pybind11::array::c_style) ||
+          !distances.writeable()) {
+        throw pybind11::value_error(
+                "Error: out must be writeable and C-contiguous.");
+      }
+    }
+
+    const bool half = distances.itemsize() == 2;
+    if (distances.dtype().kind() != 'f' ||
+        (distances.itemsize() != 4 && !half)) {
+      throw pybind11::value_error(
+              "Error: distances must be float32 or float16.");
+    }
+
+    // A C-contiguous array of points has the layout of the transposed data
+    // matrix, so it is used in place
+    const arma::fmat points(
+            const_cast<float *>(inputData.data()),
+            inputData.shape(1), N, false, true);
+    KMedoids model;
+    model.setParallelize(parallelize);
+    void *values = distances.mutable_data();
+    {
+      pybind11::gil_scoped_release release;
+      model.computeDistanceMatrixTransposed(
+              points, loss, values, condensed, half);
+    }
+    return distances;
+  }
+}  // namespace km
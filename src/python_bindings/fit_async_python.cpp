@@ -0,0 +1,176 @@
+/**
+ * @file fit_async_python.cpp
+ * @date 2026-10-16
+ *
+ * Defines the function fitAsyncPython in KMedoidsWrapper class and the
+ * FitHandle class it returns, which are used in Python bindings.
+ */
+
+#include <pybind11/pybind11.h>
+#include <chrono>
+#include <memory>
+#include <utility>
+
+#include "kmedoids_pywrapper.hpp"
+
+namespace km {
+  namespace {
+    /**
+     * @brief Returns the progress of a fit as a Python dict.
+     */
+    pybind11::dict progressDict(const FitProgress &progress) {
+      pybind11::dict result;
+      result["phase"] = progress.phase;
+      result["step"] = progress.step;
+      result["total"] = progress.total;
+      result["loss"] = progress.loss;
+      result["distance_computations"] = progress.distanceComputations;
+      return result;
+    }
+  }  // namespace
+
+  std::unique_ptr<FitHandle> km::KMedoidsWrapper::fitAsyncPython(
+          const pybind11::array_t<float> &inputData,
+          const std::string &loss,
+          pybind11::kwargs kw) {
+    pybind11::object callback = pybind11::none();
+    if (kw.contains("callback")) {
+      callback = kw["callback"];
+    }
+    return std::make_unique<FitHandle>(
+            this, prepareFitPython(inputData, loss, kw), callback);
+  }
+
+  FitHandle::FitHandle(
+          KMedoidsWrapper *kmedoids,
+          std::function<void()> run,
+          pybind11::object callback):
+    kmedoids(kmedoids),
+    callback(callback),
+    hasCallback(!callback.is_none()) {
+    kmedoids->setProgressCallback([this](const FitProgress &progress) {
+      update(progress);
+    });
+    worker = std::thread([this, run = std::move(run)]() {
+      std::exception_ptr fitError;
+      try {
+        run();
+      } catch (...) {
+        fitError = std::current_exception();
+      }
+      this->kmedoids->setProgressCallback(nullptr);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        // An error of the callback, which cancelled the fit, comes first
+        if (!error) {
+          error = fitError;
+        }
+        finished = true;
+      }
+      finishedCondition.notify_all();
+    });
+  }
+
+  FitHandle::~FitHandle() {
+    if (worker.joinable()) {
+      cancel();
+      // The fit may be waiting for the GIL to report its progress
+      pybind11::gil_scoped_release release;
+      worker.join();
+    }
+  }
+
+  bool FitHandle::done() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return finished;
+  }
+
+  void FitHandle::cancel() {
+    // A request after the fit is over would stop the next fit instead
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!finished) {
+      kmedoids->requestCancel();
+    }
+  }
+
+  pybind11::object FitHandle::progress() {
+    FitProgress current;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!hasProgress) {
+        return pybind11::none();
+      }
+      current = latest;
+    }
+    return progressDict(current);
+  }
+
+  pybind11::object FitHandle::result(pybind11::object timeout) {
+    bool over;
+    {
+      // The fit may be waiting for the GIL to report its progress
+      pybind11::gil_scoped_release release;
+      std::unique_lock<std::mutex> lock(mutex);
+      if (timeout.is_none()) {
+        finishedCondition.wait(lock, [this]() { return finished; });
+        over = true;
+      } else {
+        over = finishedCondition.wait_for(
+                lock,
+                std::chrono::duration<double>(pybind11::cast<double>(timeout)),
+                [this]() { return finished; });
+      }
+      lock.unlock();
+      if (over && worker.joinable()) {
+        worker.join();
+      }
+    }
+    if (!over) {
+      PyErr_SetString(PyExc_TimeoutError, "The fit is not done yet");
+      throw pybind11::error_already_set();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return pybind11::cast(kmedoids);
+  }
+
+  void FitHandle::update(const FitProgress &progress) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      latest = progress;
+      hasProgress = true;
+    }
+    if (!hasCallback) {
+      return;
+    }
+    pybind11::gil_scoped_acquire acquire;
+    try {
+      callback(progressDict(progress));
+    } catch (pybind11::error_already_set &) {
+      // An exception raised by the callback stops the fit and is raised
+      // again by result()
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      kmedoids->requestCancel();
+    }
+  }
+
+  void fit_async_python(
+          pybind11::module *m,
+          pybind11::class_ <KMedoidsWrapper> *cls) {
+    pybind11::class_<FitHandle>(*m, "FitHandle")
+            .def("done", &FitHandle::done)
+            .def("cancel", &FitHandle::cancel)
+            .def("progress", &FitHandle::progress)
+            .def("result", &FitHandle::result,
+                 pybind11::arg("timeout") = pybind11::none());
+    // The model is kept alive as long as the handle
+    cls->def("fit_async", &KMedoidsWrapper::fitAsyncPython,
+             pybind11::keep_alive<0, 1>());
+    cls->def("cancel", &KMedoidsWrapper::requestCancel);
+    cls->def_property_readonly("cancelled", &KMedoidsWrapper::getCancelled);
+  }
+}  // namespace km
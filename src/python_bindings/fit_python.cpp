@@ -2,8 +2,9 @@
  * @file fit_python.cpp
  * @date 2021-08-16
  *
- * Defines the function fitPython in KMedoidsWrapper class 
- * which is used in Python bindings.
+ * Defines the functions fitPython, prepareFitPython, fitMappedPython,
+ * partialFitPython and fitKRangePython in KMedoidsWrapper class, and
+ * writeMappedDataPython, which are used in Python bindings.
  */
 
 #include <pybind11/pybind11.h>
@@ -11,7 +12,10 @@
 #include <pybind11/numpy.h>
 #include <carma>
 #include <armadillo>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <vector>
 
 #include "kmedoids_pywrapper.hpp"
 
@@ -20,6 +24,17 @@ namespace km {
           const pybind11::array_t<float> &inputData,
           const std::string &loss,
           pybind11::kwargs kw) {
+    const std::function<void()> run = prepareFitPython(inputData, loss, kw);
+    // The fit itself runs without the GIL so that other Python threads,
+    // e.g. fitting other models, can run meanwhile
+    pybind11::gil_scoped_release release;
+    run();
+  }
+
+  std::function<void()> km::KMedoidsWrapper::prepareFitPython(
+          const pybind11::array_t<float> &inputData,
+          const std::string &loss,
+          pybind11::kwargs kw) {
     // throw an error if the number of medoids is not specified in either
     // the KMedoids object or the fitPython function
     try {
@@ -41,23 +56,200 @@ namespace km {
       KMedoids::setNMedoids(pybind11::cast<int>(kw["k"]));
     }
 
-    // TODO(@motiwari): Add a comment here explaining the massaging, cleanup
+    // if initial medoids are given, BUILD is skipped and SWAP starts
+    // from them (warm start)
+    std::optional<arma::urowvec> initMedoids = std::nullopt;
+    if ((kw.size() != 0) && (kw.contains("init_medoids"))) {
+      const pybind11::array_t<int64_t,
+              pybind11::array::c_style | pybind11::array::forcecast>
+              initArray = pybind11::cast<pybind11::array_t<int64_t,
+              pybind11::array::c_style | pybind11::array::forcecast>>(
+                      kw["init_medoids"]);
+      arma::urowvec init(initArray.size());
+      for (pybind11::ssize_t i = 0; i < initArray.size(); i++) {
+        if (initArray.data()[i] < 0) {
+          throw pybind11::value_error(
+                  "Error: init_medoids must be non-negative indices.");
+        }
+        init(i) = initArray.data()[i];
+      }
+      initMedoids = init;
+    }
+
+    // Distance matrices are read in place rather than copied into an
+    // arma::fmat: either dense or condensed (one dimension, as returned by
+    // scipy's pdist), and either float32 or float16
+    KMedoids::clearDistanceMatrix();
+    distMatOwner = pybind11::none();
     if ((kw.size() != 0) && (kw.contains("dist_mat"))) {
-      const pybind11::array_t<float> &distMat =
-              pybind11::cast<const pybind11::array_t<float>>(
-                      kw["dist_mat"]);
-      const arma::fmat &tmp_array = carma::arr_to_mat<float>(distMat);
-      KMedoids::fit(carma::arr_to_mat<float>(inputData), loss,
-            std::make_optional<std::reference_wrapper<const arma::fmat>>(
-                    tmp_array));
-    } else {
-      // TODO(@motiwari): change std::nullopt to nullopt?
-      KMedoids::fit(carma::arr_to_mat<float>(inputData), loss,
-                    std::nullopt);
+      pybind11::array distMatArray = pybind11::array::ensure(
+              kw["dist_mat"], pybind11::array::c_style);
+      if (!distMatArray) {
+        throw pybind11::value_error("Error: dist_mat must be an array.");
+      }
+      const bool half = distMatArray.dtype().kind() == 'f' &&
+                        distMatArray.itemsize() == 2;
+      if (!half) {
+        distMatArray = pybind11::array_t<float,
+                pybind11::array::c_style | pybind11::array::forcecast>
+                ::ensure(distMatArray);
+      }
+
+      const bool condensed = distMatArray.ndim() == 1;
+      size_t n = 0;
+      if (condensed) {
+        n = DistanceMatrix::pointsOfCondensed(distMatArray.shape(0));
+      } else if (distMatArray.ndim() == 2 &&
+                 distMatArray.shape(0) == distMatArray.shape(1)) {
+        n = distMatArray.shape(0);
+      }
+      if (n == 0) {
+        throw pybind11::value_error("Malformed distance matrix provided");
+      }
+      // Keep the array alive while the model reads its memory
+      distMatOwner = distMatArray;
+      KMedoids::setDistanceMatrix(distMatArray.data(), n, condensed, half);
+    } else if ((kw.size() != 0) && (kw.contains("dist_mat_path"))) {
+      std::string dtype = "float32";
+      if (kw.contains("dist_mat_dtype")) {
+        dtype = pybind11::cast<std::string>(kw["dist_mat_dtype"]);
+      }
+      KMedoids::loadDistanceMatrix(
+              pybind11::cast<std::string>(kw["dist_mat_path"]), dtype);
+    }
+    // A checkpoint to resume from is used by this fit only
+    if ((kw.size() != 0) && (kw.contains("resume_from"))) {
+      KMedoids::setResumePath(pybind11::cast<std::string>(kw["resume_from"]));
     }
+    // Every numpy buffer the fit reads is held by this wrapper or by the
+    // returned function, so none can be freed while the fit runs.
+    // A C-contiguous float32 array of points has the layout of the
+    // transposed data matrix, so the fit reads it in place instead of a
+    // transposed copy. Arrays of other types were already converted to such
+    // an array by pybind11.
+    if (inputData.ndim() == 2 &&
+        (inputData.flags() & pybind11::array::c_style)) {
+      float *memory = const_cast<float *>(inputData.data());
+      const size_t nFeatures = inputData.shape(1);
+      const size_t nPoints = inputData.shape(0);
+      // Keep the array alive while the model reads its memory
+      dataOwner = inputData;
+      return [this, memory, nFeatures, nPoints, loss, initMedoids]() {
+        const arma::fmat transposedData(
+                memory, nFeatures, nPoints, false, true);
+        // TODO(@motiwari): change std::nullopt to nullopt?
+        try {
+          KMedoids::fitTransposed(
+                  transposedData, loss, std::nullopt, initMedoids);
+        } catch (...) {
+          KMedoids::releaseData();
+          throw;
+        }
+        // Once the fit is over, the model keeps its own copy of the points
+        // so that later writes to the array neither reach the model nor
+        // come from it
+        KMedoids::ownData();
+      };
+    }
+    dataOwner = pybind11::none();
+    const auto data = std::make_shared<const arma::fmat>(
+            carma::arr_to_mat<float>(inputData));
+    return [this, data, loss, initMedoids]() {
+      KMedoids::fit(*data, loss, std::nullopt, initMedoids);
+    };
+  }
+
+  void km::KMedoidsWrapper::fitMappedPython(
+          const std::string &path,
+          const std::string &loss) {
+    pybind11::gil_scoped_release release;
+    KMedoids::fitMapped(path, loss);
+  }
+
+  void writeMappedDataPython(
+          const std::string &path,
+          const pybind11::array_t<float> &inputData) {
+    MappedData::write(path, carma::arr_to_mat<float>(inputData));
+  }
+
+  void km::KMedoidsWrapper::partialFitPython(
+          const pybind11::array_t<float> &inputData,
+          size_t maxIter) {
+    const arma::fmat data = carma::arr_to_mat<float>(inputData);
+    pybind11::gil_scoped_release release;
+    KMedoids::partialFit(data, maxIter);
+  }
+
+  pybind11::dict km::KMedoidsWrapper::fitKRangePython(
+          const pybind11::array_t<float> &inputData,
+          const std::string &loss,
+          const std::vector<size_t> &ks) {
+    arma::urowvec kRange(ks.size());
+    for (size_t r = 0; r < ks.size(); r++) {
+      kRange(r) = ks[r];
+    }
+    const arma::fmat data = carma::arr_to_mat<float>(inputData);
+    {
+      pybind11::gil_scoped_release release;
+      KMedoids::fitKRange(data, loss, kRange);
+    }
+
+    pybind11::list medoidsList;
+    for (const arma::urowvec &medoids : KMedoids::getKRangeMedoids()) {
+      pybind11::array medoidsArray = carma::row_to_arr<arma::uword>(medoids);
+      if (medoids.size() > 1) {
+        medoidsArray = medoidsArray.squeeze();
+      }
+      medoidsList.append(medoidsArray);
+    }
+    pybind11::list buildMedoidsList;
+    for (const arma::urowvec &medoids : KMedoids::getKRangeBuildMedoids()) {
+      pybind11::array medoidsArray = carma::row_to_arr<arma::uword>(medoids);
+      if (medoids.size() > 1) {
+        medoidsArray = medoidsArray.squeeze();
+      }
+      buildMedoidsList.append(medoidsArray);
+    }
+    pybind11::list labelsList;
+    for (const arma::urowvec &labels : KMedoids::getKRangeLabels()) {
+      labelsList.append(carma::row_to_arr<arma::uword>(labels).squeeze());
+    }
+    const arma::frowvec losses = KMedoids::getKRangeLosses();
+    const arma::frowvec buildLosses = KMedoids::getKRangeBuildLosses();
+    const arma::urowvec steps = KMedoids::getKRangeSteps();
+    const arma::frowvec swapTimes = KMedoids::getKRangeSwapTimes();
+    const arma::urowvec swapDistanceComputations =
+            KMedoids::getKRangeSwapDistanceComputations();
+
+    pybind11::dict result;
+    // A cancelled sweep stops before the larger numbers of medoids
+    result["k"] = std::vector<size_t>(ks.begin(), ks.begin() + losses.n_elem);
+    result["medoids"] = medoidsList;
+    result["build_medoids"] = buildMedoidsList;
+    result["loss"] = pybind11::array_t<float>(losses.n_elem, losses.memptr());
+    result["build_loss"] =
+            pybind11::array_t<float>(buildLosses.n_elem, buildLosses.memptr());
+    result["labels"] = labelsList;
+    result["steps"] = std::vector<size_t>(steps.begin(), steps.end());
+    result["swap_time"] =
+            pybind11::array_t<float>(swapTimes.n_elem, swapTimes.memptr());
+    result["swap_distance_computations"] = std::vector<size_t>(
+            swapDistanceComputations.begin(), swapDistanceComputations.end());
+    result["build_time"] = KMedoids::getKRangeBuildTime();
+    return result;
   }
 
   void fit_python(pybind11::class_ <KMedoidsWrapper> *cls) {
     cls->def("fit", &KMedoidsWrapper::fitPython);
+    cls->def("partial_fit", &KMedoidsWrapper::partialFitPython,
+             pybind11::arg("data"),
+             pybind11::arg("max_iter") = 1);
+    cls->def("fit_mapped", &KMedoidsWrapper::fitMappedPython,
+             pybind11::arg("path"),
+             pybind11::arg("loss"));
+    cls->def("fit_k_range", &KMedoidsWrapper::fitKRangePython,
+             pybind11::arg("data"),
+             pybind11::arg("loss"),
+             pybind11::arg("ks"));
   }
 }  // namespace km
@@ -25,6 +25,17 @@ namespace km {
     &omp_get_max_threads, "Returns max number of threads");
     m.def("set_num_threads",
     &omp_set_num_threads, "Set the maximum number of threads");
+    m.def("write_mapped_data",
+    &writeMappedDataPython, "Write data in the format read by fit_mapped",
+    pybind11::arg("path"), pybind11::arg("data"));
+    m.def("compute_distance_matrix",
+    &computeDistanceMatrixPython,
+    "Compute the distances between all pairs of points",
+    pybind11::arg("X"), pybind11::arg("loss"),
+    pybind11::arg("out") = pybind11::none(),
+    pybind11::arg("condensed") = false,
+    pybind11::arg("dtype") = "float32",
+    pybind11::arg("parallelize") = true);
 
     // Class functions
     pybind11::class_ <KMedoidsWrapper> cls(m, "KMedoids");
@@ -36,7 +47,8 @@ namespace km {
     //  each others' values). The order here much also match that of the
     //  constructor in kmedoids_algorithm.*pp
     cls.def(
-    pybind11::init<int, std::string, int, int, int, bool, bool, int, bool>(),
+    pybind11::init<int, std::string, int, int, int, bool, bool, int, bool, int,
+      std::string>(),
     pybind11::arg("n_medoids") = 5,
     pybind11::arg("algorithm") = "BanditPAM",
     pybind11::arg("max_iter") = 100,
@@ -46,7 +58,9 @@ namespace km {
     pybind11::arg("use_cache") = true,
     pybind11::arg("use_perm") = true,
     pybind11::arg("cache_width") = 1000,
-    pybind11::arg("parallelize") = true);
+    pybind11::arg("parallelize") = true,
+    pybind11::arg("seed") = 0,
+    pybind11::arg("build") = "bandit");
 
     // Properties
     cls.def_property("n_medoids",
@@ -55,6 +69,20 @@ namespace km {
     &KMedoidsWrapper::getAlgorithm, &KMedoidsWrapper::setAlgorithm);
     cls.def_property("max_iter",
     &KMedoidsWrapper::getMaxIter, &KMedoidsWrapper::setMaxIter);
+    cls.def_property("max_swaps_per_iter",
+    &KMedoidsWrapper::getMaxSwapsPerIter,
+    &KMedoidsWrapper::setMaxSwapsPerIter);
+    cls.def_property("reuse_arm_stats",
+    &KMedoidsWrapper::getReuseArmStats, &KMedoidsWrapper::setReuseArmStats);
+    cls.def_property("online_sigma",
+    &KMedoidsWrapper::getOnlineSigma, &KMedoidsWrapper::setOnlineSigma);
+    cls.def_property("n_init",
+    &KMedoidsWrapper::getNInit, &KMedoidsWrapper::setNInit);
+    cls.def_property("medoid_tree",
+    &KMedoidsWrapper::getUseMedoidTree, &KMedoidsWrapper::setUseMedoidTree);
+    cls.def_property("collapse_duplicates",
+    &KMedoidsWrapper::getCollapseDuplicates,
+    &KMedoidsWrapper::setCollapseDuplicates);
     cls.def_property("build_confidence",
     &KMedoidsWrapper::getBuildConfidence, &KMedoidsWrapper::setBuildConfidence);
     cls.def_property("swap_confidence",
@@ -71,6 +99,24 @@ namespace km {
     &KMedoidsWrapper::getLossFn, &KMedoidsWrapper::setLossFn);
     cls.def_property("seed",
     &KMedoidsWrapper::getSeed, &KMedoidsWrapper::setSeed);
+    cls.def_property("build",
+    &KMedoidsWrapper::getBuildMethod, &KMedoidsWrapper::setBuildMethod);
+    cls.def_property("tolerance",
+    &KMedoidsWrapper::getTolerance, &KMedoidsWrapper::setTolerance);
+    cls.def_property("relative_tolerance",
+    &KMedoidsWrapper::getRelativeTolerance,
+    &KMedoidsWrapper::setRelativeTolerance);
+    cls.def_property("checkpoint_path",
+    &KMedoidsWrapper::getCheckpointPath, &KMedoidsWrapper::setCheckpointPath);
+    cls.def_property("checkpoint_cache",
+    &KMedoidsWrapper::getCheckpointCache,
+    &KMedoidsWrapper::setCheckpointCache);
+    cls.def_property("time_budget",
+    &KMedoidsWrapper::getTimeBudget, &KMedoidsWrapper::setTimeBudget);
+    cls.def_property("distance_budget",
+    &KMedoidsWrapper::getDistanceBudget, &KMedoidsWrapper::setDistanceBudget);
+    cls.def_property_readonly("budget_exhausted",
+    &KMedoidsWrapper::getBudgetExhausted);
 
     // Other functions
     medoids_python(&cls);
@@ -78,6 +124,9 @@ namespace km {
     labels_python(&cls);
     steps_python(&cls);
     fit_python(&cls);
+    fit_async_python(&m, &cls);
+    predict_python(&cls);
+    model_file_python(&cls);
     loss_python(&cls);
     build_loss_python(&cls);
 
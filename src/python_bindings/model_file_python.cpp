@@ -0,0 +1,38 @@
+/**
+ * @file model_file_python.cpp
+ * @date 2026-10-16
+ *
+ * Defines the Python bindings that save, load and pickle fitted models.
+ */
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <carma>
+#include <armadillo>
+#include <memory>
+#include <string>
+
+#include "kmedoids_pywrapper.hpp"
+
+namespace km {
+  void model_file_python(pybind11::class_ <KMedoidsWrapper> *cls) {
+    cls->def("save", &KMedoidsWrapper::saveModel,
+             pybind11::arg("path"),
+             pybind11::arg("include_medoids") = true);
+    cls->def_static("load", [](const std::string &path) {
+      auto model = std::make_unique<KMedoidsWrapper>();
+      model->loadModel(path);
+      return model;
+    }, pybind11::arg("path"));
+    // Pickles embed the medoid coordinates so that unpickled models predict
+    cls->def(pybind11::pickle(
+            [](const KMedoidsWrapper &model) {
+              return pybind11::bytes(model.serializeModel(true));
+            },
+            [](const pybind11::bytes &state) {
+              auto model = std::make_unique<KMedoidsWrapper>();
+              model->deserializeModel(state);
+              return model;
+            }));
+  }
+}  // namespace km
@@ -0,0 +1,47 @@
+/**
+ * @file predict_python.cpp
+ * @date 2026-10-16
+ *
+ * Defines the function predictPython in KMedoidsWrapper class
+ * which is used in Python bindings.
+ */
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <carma>
+#include <armadillo>
+
+#include "kmedoids_pywrapper.hpp"
+
+namespace km {
+  pybind11::object km::KMedoidsWrapper::predictPython(
+          const pybind11::array_t<float> &inputData,
+          bool returnDistances) {
+    arma::frowvec distances;
+    arma::urowvec predictedLabels = KMedoids::predict(
+            carma::arr_to_mat<float>(inputData),
+            returnDistances ? &distances : nullptr);
+
+    pybind11::array labelsArray =
+            carma::row_to_arr<arma::uword>(predictedLabels);
+    if (predictedLabels.size() > 1) {
+      labelsArray = labelsArray.squeeze();
+    }
+    if (!returnDistances) {
+      return labelsArray;
+    }
+
+    pybind11::array distancesArray =
+            carma::row_to_arr<float>(distances);
+    if (distances.size() > 1) {
+      distancesArray = distancesArray.squeeze();
+    }
+    return pybind11::make_tuple(labelsArray, distancesArray);
+  }
+
+  void predict_python(pybind11::class_ <km::KMedoidsWrapper> *cls) {
+    cls->def("predict", &KMedoidsWrapper::predictPython,
+             pybind11::arg("data"),
+             pybind11::arg("return_distances") = false);
+  }
+}  // namespace km
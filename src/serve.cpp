@@ -0,0 +1,275 @@
+/**
+ * @file serve.cpp
+ * @date 2026-10-16
+ *
+ * Defines a command line program that loads a model saved by
+ * KMedoids::saveModel and assigns points to its medoids for other local
+ * processes over a Unix domain socket.
+ *
+ * Usage (from home repo directory):
+ * ./src/build/BanditPAM_serve -m [path/to/model] -u [path/to/socket]
+ *
+ * -b sets the largest number of points assigned in one predict pass
+ * (default 65536), -t the number of microseconds a request waits for others
+ * to join its pass (default 200), -w parallelizes each pass and -j sets its
+ * number of threads. The server stops on SIGINT or SIGTERM and prints its
+ * statistics.
+ *
+ * Every message starts with a 16-byte header of little-endian integers.
+ * Requests have a uint32 type, a uint32 that must be 0, and a uint64 number
+ * of points, and are answered in order:
+ *  - 1 (assign): followed by a uint64 number of features and the float32
+ *    coordinates of the points, one point after the other. The response
+ *    holds the uint64 label and then the float32 distance to its medoid of
+ *    each point
+ *  - 2 (stats): the response holds the request counts and the latency and
+ *    batch size histograms as JSON
+ *  - 3 (info): the response holds the number of medoids, the number of
+ *    features, the loss function ("loss_fn") and the average loss of the
+ *    fit ("loss") of the model as JSON
+ * Responses have a uint32 status (0 on success, 1 on error), a uint32 0,
+ * and a uint64 count: the number of points of an assignment, or the number
+ * of bytes of the JSON or of the error message that follows.
+ *
+ * Assignments received within the wait of each other are coalesced into a
+ * single call to KMedoids::predictTransposed, so that concurrent clients
+ * share its vectorized distance computations. The batching and the
+ * requests are handled by model_server.cpp; this file owns the sockets and
+ * the threads of the connections.
+ */
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <thread>
+
+#include "kmedoids_algorithm.hpp"
+#include "model_server.hpp"
+
+namespace {
+volatile std::sig_atomic_t stopRequested = 0;
+
+void requestStop(int) {
+  stopRequested = 1;
+}
+
+bool readAll(int fd, void *buffer, size_t bytes) {
+  char *position = static_cast<char *>(buffer);
+  while (bytes > 0) {
+    const ssize_t count = ::read(fd, position, bytes);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    } else if (count <= 0) {
+      return false;
+    }
+    position += count;
+    bytes -= count;
+  }
+  return true;
+}
+
+bool writeAll(int fd, const void *buffer, size_t bytes) {
+  const char *position = static_cast<const char *>(buffer);
+  while (bytes > 0) {
+    const ssize_t count = ::write(fd, position, bytes);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    } else if (count <= 0) {
+      return false;
+    }
+    position += count;
+    bytes -= count;
+  }
+  return true;
+}
+
+/**
+ * @brief A connection and the thread answering its requests.
+ */
+struct Connection {
+  /// Socket of the connection, closed once the thread is joined
+  int fd;
+
+  /// Set by the thread once the connection is done
+  std::atomic<bool> finished{false};
+
+  /// Thread answering the requests of the connection
+  std::thread thread;
+};
+
+/**
+ * @brief Joins the thread of a connection and closes its socket.
+ *
+ * @param connection Connection whose thread is done or about to be
+ */
+void closeConnection(Connection *connection) {
+  connection->thread.join();
+  ::close(connection->fd);
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string model_name;
+  std::string socket_name;
+  size_t max_batch_points = 65536;
+  int max_wait = 200;
+  bool parallelize = false;
+  int num_threads = 0;
+  int opt;
+  const int ARGUMENT_ERROR_CODE = 1;
+
+  try {
+    while ((opt = getopt(argc, argv, "m:u:b:t:wj:")) != -1) {
+      switch (opt) {
+        // path to a model saved by KMedoids::saveModel
+        case 'm':
+          model_name = optarg;
+          break;
+          // path of the Unix domain socket to listen on
+        case 'u':
+          socket_name = optarg;
+          break;
+          // largest number of points assigned in one predict pass
+        case 'b':
+          max_batch_points = std::stoull(optarg);
+          break;
+          // microseconds a request waits for others to join its pass
+        case 't':
+          max_wait = std::stoi(optarg);
+          break;
+        case 'w':
+          parallelize = true;
+          break;
+        case 'j':
+          num_threads = std::stoi(optarg);
+          parallelize = true;
+          break;
+        case '?':
+          printf("unknown option: %c\n", optopt);
+          return ARGUMENT_ERROR_CODE;
+      }
+    }
+
+    if (model_name.empty()) {
+      throw std::invalid_argument("Error: Must specify a model via -m flag");
+    } else if (socket_name.empty()) {
+      throw std::invalid_argument("Error: Must specify a socket via -u flag");
+    } else if (socket_name.size() >= sizeof(sockaddr_un::sun_path)) {
+      throw std::invalid_argument("Error: The socket path is too long");
+    } else if (max_batch_points == 0 || max_wait < 0 || num_threads < 0) {
+      throw std::invalid_argument(
+              "Error: -b must be positive, and -t and -j non-negative");
+    }
+  } catch (std::invalid_argument &e) {
+    std::cout << e.what() << std::endl;
+    return ARGUMENT_ERROR_CODE;
+  }
+
+  km::KMedoids model;
+  try {
+    model.loadModel(model_name);
+  } catch (std::invalid_argument &e) {
+    std::cout << e.what() << std::endl;
+    return ARGUMENT_ERROR_CODE;
+  }
+  if (model.getMedoidCoordinates().n_cols == 0) {
+    std::cout << "Error: the model was saved without its medoids and cannot "
+                 "assign points" << std::endl;
+    return ARGUMENT_ERROR_CODE;
+  }
+  if (parallelize) {
+    model.setParallelize(true);
+  }
+  if (num_threads > 0) {
+    omp_set_num_threads(num_threads);
+  }
+
+  const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socket_name.c_str(),
+               sizeof(address.sun_path) - 1);
+  ::unlink(socket_name.c_str());
+  if (listener < 0 ||
+      ::bind(listener, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(listener, SOMAXCONN) != 0) {
+    std::cout << "Error: cannot listen on " << socket_name << std::endl;
+    return ARGUMENT_ERROR_CODE;
+  }
+
+  // Writes to closed connections fail instead of killing the server
+  std::signal(SIGPIPE, SIG_IGN);
+  std::signal(SIGINT, requestStop);
+  std::signal(SIGTERM, requestStop);
+
+  const std::string info = km::modelInfo(model);
+  km::Batcher batcher(
+          model, max_batch_points, std::chrono::microseconds(max_wait));
+  std::thread batchThread(&km::Batcher::run, &batcher);
+  std::cout << "Serving " << model_name << " on " << socket_name
+            << std::endl;
+
+  // Every connection thread is joined before the batcher and the model it
+  // uses go out of scope
+  std::list<std::unique_ptr<Connection>> connections;
+  while (!stopRequested) {
+    for (auto it = connections.begin(); it != connections.end();) {
+      if ((*it)->finished) {
+        closeConnection(it->get());
+        it = connections.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    // Polling with a timeout lets the loop notice a stop request
+    pollfd listening = {listener, POLLIN, 0};
+    if (::poll(&listening, 1, 200) <= 0) {
+      continue;
+    }
+    const int fd = ::accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    connections.push_back(std::make_unique<Connection>());
+    Connection *connection = connections.back().get();
+    connection->fd = fd;
+    connection->thread = std::thread([connection, &batcher, &info]() {
+      km::serveRequests(
+              [fd = connection->fd](void *buffer, size_t bytes) {
+                return readAll(fd, buffer, bytes);
+              },
+              [fd = connection->fd](const void *buffer, size_t bytes) {
+                return writeAll(fd, buffer, bytes);
+              },
+              &batcher,
+              info);
+      connection->finished = true;
+    });
+  }
+
+  ::close(listener);
+  ::unlink(socket_name.c_str());
+  // Shutting each connection down makes its thread return, after the
+  // batcher, which is still running, is done with its current request
+  for (const std::unique_ptr<Connection> &connection : connections) {
+    ::shutdown(connection->fd, SHUT_RDWR);
+  }
+  for (const std::unique_ptr<Connection> &connection : connections) {
+    closeConnection(connection.get());
+  }
+  batcher.stop();
+  batchThread.join();
+  std::cout << batcher.stats() << std::endl;
+  return 0;
+}
@@ -0,0 +1,124 @@
+#ifndef TESTS_CPP_CHECK_HPP_
+#define TESTS_CPP_CHECK_HPP_
+
+#include <unistd.h>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+// The C++ tests are plain executables run by CTest: each failed check is
+// printed, and main returns the number of failures
+namespace km_test {
+/// Number of checks that failed so far
+inline int failures = 0;
+
+/**
+ * @brief Records the outcome of a check, printing it if it failed.
+ *
+ * @param passed Whether the check passed
+ * @param expression Text of the check
+ * @param file File of the check
+ * @param line Line of the check
+ */
+inline void record(
+        bool passed,
+        const char *expression,
+        const char *file,
+        int line) {
+  if (!passed) {
+    std::cerr << file << ":" << line << ": check failed: " << expression
+              << std::endl;
+    failures++;
+  }
+}
+
+/**
+ * @brief Creates an empty directory for the files of a test, which is
+ * removed with everything in it when the directory goes out of scope.
+ */
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    std::string pattern =
+            (std::filesystem::temp_directory_path() / "banditpam_XXXXXX")
+            .string();
+    if (mkdtemp(pattern.data()) == nullptr) {
+      std::cerr << "cannot create a temporary directory" << std::endl;
+      std::exit(1);
+    }
+    path = pattern;
+  }
+
+  ~TemporaryDirectory() {
+    std::error_code error;
+    std::filesystem::remove_all(path, error);
+  }
+
+  TemporaryDirectory(const TemporaryDirectory &) = delete;
+
+  TemporaryDirectory &operator=(const TemporaryDirectory &) = delete;
+
+  /**
+   * @brief Returns the path of a file in the directory.
+   *
+   * @param name Name of the file
+   *
+   * @returns The path of the file
+   */
+  std::string file(const std::string &name) const {
+    return (path / name).string();
+  }
+
+ private:
+  /// Path of the directory
+  std::filesystem::path path;
+};
+
+/**
+ * @brief Writes bytes to a file, replacing its contents.
+ *
+ * @param path Path of the file
+ * @param bytes Contents of the file
+ */
+inline void writeFile(const std::string &path, const std::string &bytes) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), bytes.size());
+}
+
+/**
+ * @brief Reads a whole file.
+ *
+ * @param path Path of the file
+ *
+ * @returns The contents of the file, or an empty string if it cannot be read
+ */
+inline std::string readFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(
+          (std::istreambuf_iterator<char>(in)),
+          std::istreambuf_iterator<char>());
+}
+}  // namespace km_test
+
+/// Fails the test if condition is false
+#define CHECK(condition) \
+  km_test::record((condition), #condition, __FILE__, __LINE__)
+
+/// Fails the test unless statement throws std::invalid_argument
+#define CHECK_THROWS(statement) \
+  do { \
+    bool thrown = false; \
+    try { \
+      statement; \
+    } catch (const std::invalid_argument &) { \
+      thrown = true; \
+    } \
+    km_test::record(thrown, #statement " throws", __FILE__, __LINE__); \
+  } while (false)
+
+#endif  // TESTS_CPP_CHECK_HPP_
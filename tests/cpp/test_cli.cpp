@@ -0,0 +1,202 @@
+/**
+ * @file test_cli.cpp
+ * @date 2026-10-16
+ *
+ * Runs the command line program on a small dataset and checks the JSON and
+ * binary results files it writes.
+ *
+ * Usage: test_cli [path/to/BanditPAM]
+ */
+
+#include <sys/wait.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+  /**
+   * @brief Runs the command line program, discarding its output.
+   *
+   * @returns The exit code of the program, or -1 if it did not exit
+   */
+  int run(const std::string &program, const std::string &arguments) {
+    const int status = std::system(
+            ("'" + program + "' " + arguments + " > /dev/null").c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  }
+
+  /**
+   * @brief Returns the number of times a string occurs in text.
+   */
+  size_t count(const std::string &text, const std::string &needle) {
+    size_t occurrences = 0;
+    for (size_t position = text.find(needle);
+         position != std::string::npos;
+         position = text.find(needle, position + needle.size())) {
+      occurrences++;
+    }
+    return occurrences;
+  }
+
+  /**
+   * @brief Returns the integers of the first JSON array following key.
+   */
+  std::vector<uint64_t> jsonArray(
+          const std::string &text,
+          const std::string &key) {
+    std::vector<uint64_t> values;
+    const size_t start = text.find("\"" + key + "\":[");
+    if (start == std::string::npos) {
+      return values;
+    }
+    std::istringstream in(text.substr(start + key.size() + 4));
+    uint64_t value;
+    char separator = ',';
+    while (separator == ',' && in >> value) {
+      values.push_back(value);
+      in >> separator;
+    }
+    return values;
+  }
+
+  /**
+   * @brief Reads the little-endian fields of a binary results file in order.
+   */
+  class Reader {
+   public:
+    explicit Reader(const std::string &bytes) : bytes(bytes) {}
+
+    template <typename T>
+    T read() {
+      T value{};
+      if (position + sizeof(T) <= bytes.size()) {
+        std::memcpy(&value, bytes.data() + position, sizeof(T));
+      }
+      position += sizeof(T);
+      return value;
+    }
+
+    std::string readString(size_t length) {
+      const std::string value =
+              position + length <= bytes.size()
+              ? bytes.substr(position, length) : "";
+      position += length;
+      return value;
+    }
+
+    std::vector<uint64_t> readIndices() {
+      std::vector<uint64_t> values(read<uint64_t>());
+      for (uint64_t &value : values) {
+        value = read<uint64_t>();
+      }
+      return values;
+    }
+
+    /// Whether exactly every byte was read
+    bool atEnd() const {
+      return position == bytes.size();
+    }
+
+   private:
+    const std::string bytes;
+    size_t position = 0;
+  };
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    return 1;
+  }
+  const std::string program = argv[1];
+  km_test::TemporaryDirectory directory;
+
+  // Three well separated groups of eleven points on a line, each with a
+  // single best medoid in its middle
+  const size_t nPoints = 33;
+  std::ostringstream points;
+  for (size_t i = 0; i < nPoints; i++) {
+    const size_t group = i % 3;
+    points << 10.0 * group + 0.1 * (i / 3) << "," << -5.0 * group << "\n";
+  }
+  const std::string data = directory.file("points.csv");
+  km_test::writeFile(data, points.str());
+
+  // A single k and seed
+  const std::string json = directory.file("single.json");
+  CHECK(run(program, "-f " + data + " -k 3 -o " + json) == 0);
+  const std::string single = km_test::readFile(json);
+  CHECK(single.rfind("{\"loss\":\"L2\",\"points\":33,\"features\":2,", 0) == 0);
+  CHECK(count(single, "\"seed\":") == 1);
+  CHECK(count(single, "\"k\":") == 1);
+  const std::vector<uint64_t> medoids = jsonArray(single, "medoids");
+  const std::vector<uint64_t> labels = jsonArray(single, "labels");
+  CHECK(medoids.size() == 3);
+  CHECK(labels.size() == nPoints);
+  std::set<uint64_t> groups;
+  for (uint64_t medoid : medoids) {
+    CHECK(medoid < nPoints);
+    groups.insert(medoid % 3);
+  }
+  // Each group has its own medoid, and each point is labeled with it
+  CHECK(groups.size() == 3);
+  for (size_t i = 0; i < labels.size(); i++) {
+    CHECK(labels[i] < medoids.size() && medoids[labels[i]] % 3 == i % 3);
+  }
+
+  // Several ks and seeds in the binary format
+  const std::string binary = directory.file("batch.bin");
+  CHECK(run(program,
+            "-f " + data + " -k 2,3 -s 0,1 -F binary -o " + binary) == 0);
+  Reader reader(km_test::readFile(binary));
+  CHECK(reader.readString(8) == "BPAMRSLT");
+  CHECK(reader.read<uint32_t>() == 1);
+  CHECK(reader.readString(reader.read<uint64_t>()) == "L2");
+  CHECK(reader.read<uint64_t>() == nPoints);
+  CHECK(reader.read<uint64_t>() == 2);
+  reader.read<float>();
+  CHECK(reader.read<uint64_t>() == 2);
+  for (uint64_t seed = 0; seed < 2; seed++) {
+    CHECK(reader.read<uint64_t>() == seed);
+    CHECK(reader.read<float>() >= 0);
+    CHECK(reader.read<uint64_t>() > 0);
+    reader.read<uint64_t>();
+    CHECK(reader.read<uint64_t>() == 2);
+    for (uint64_t k = 2; k <= 3; k++) {
+      CHECK(reader.read<uint64_t>() == k);
+      const std::vector<uint64_t> fitMedoids = reader.readIndices();
+      const std::vector<uint64_t> fitLabels = reader.readIndices();
+      CHECK(fitMedoids.size() == k);
+      CHECK(fitLabels.size() == nPoints);
+      for (uint64_t label : fitLabels) {
+        CHECK(label < k);
+      }
+      const float buildLoss = reader.read<float>();
+      const float loss = reader.read<float>();
+      CHECK(loss >= 0 && loss <= buildLoss + 1e-4f);
+      reader.read<uint64_t>();
+      CHECK(reader.read<float>() >= 0);
+      reader.read<uint64_t>();
+      if (seed == 0 && k == 3) {
+        // The plain fit and the shared BUILD find the same medoids
+        CHECK(std::set<uint64_t>(fitMedoids.begin(), fitMedoids.end()) ==
+              std::set<uint64_t>(medoids.begin(), medoids.end()));
+      }
+    }
+  }
+  CHECK(reader.atEnd());
+
+  // Bad arguments are rejected without writing results
+  const std::string rejected = directory.file("rejected.json");
+  CHECK(run(program, "-f " + data + " -o " + rejected) != 0);
+  CHECK(run(program, "-f " + data + " -k 3 -c -o " + rejected) != 0);
+  CHECK(run(program, "-f " + data + " -k 3 -F xml -o " + rejected) != 0);
+  CHECK(km_test::readFile(rejected).empty());
+
+  return km_test::failures;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file test_data_loader.cpp
+ * @date 2026-10-16
+ *
+ * Tests that DataLoader reads the same points from raw, .npy, Armadillo
+ * binary and CSV files, rejects malformed files, and parses text the same
+ * way with and without threads.
+ */
+
+#include <omp.h>
+#include <armadillo>
+#include <filesystem>
+#include <string>
+
+#include "check.hpp"
+#include "data_loader.hpp"
+
+namespace {
+  /**
+   * @brief Returns whether two matrices have the same size and values.
+   */
+  bool same(const arma::fmat &a, const arma::fmat &b) {
+    return a.n_rows == b.n_rows && a.n_cols == b.n_cols &&
+           arma::all(arma::vectorise(a == b));
+  }
+
+  /**
+   * @brief Returns the bytes of the values of a matrix, in memory order.
+   */
+  template <typename T>
+  std::string bytesOf(const arma::Mat<T> &matrix) {
+    return std::string(
+            reinterpret_cast<const char *>(matrix.memptr()),
+            matrix.n_elem * sizeof(T));
+  }
+
+  /**
+   * @brief Returns a version 1.0 .npy file with the given header fields
+   * followed by the given values.
+   */
+  std::string npyFile(
+          const std::string &descr,
+          bool fortran,
+          const std::string &shape,
+          const std::string &values) {
+    std::string header =
+            "{'descr': '" + descr + "', 'fortran_order': " +
+            (fortran ? "True" : "False") + ", 'shape': " + shape + ", }";
+    // The data starts at a multiple of 64 bytes, after a newline
+    while ((10 + header.size() + 1) % 64 != 0) {
+      header += ' ';
+    }
+    header += '\n';
+    std::string file("\x93NUMPY\x01\x00", 8);
+    file += static_cast<char>(header.size() & 0xff);
+    file += static_cast<char>(header.size() >> 8);
+    return file + header + values;
+  }
+
+  /**
+   * @brief Loads a file with a new loader, returning an owned copy of the
+   * points since the matrix may alias the file.
+   */
+  arma::fmat load(
+          const std::string &path,
+          const std::string &format,
+          size_t nFeatures = 0,
+          bool parallelize = true) {
+    km::DataLoader loader;
+    const arma::fmat loaded =
+            loader.load(path, format, nFeatures, parallelize);
+    return arma::fmat(loaded);
+  }
+}  // namespace
+
+int main() {
+  km_test::TemporaryDirectory directory;
+
+  // Four points of three features; the loaders return one column per point
+  const arma::fmat points = {
+          {0.5f, -1.25f, 3.0f},
+          {2.0f, 0.0f, -0.75f},
+          {1e-3f, 42.0f, 7.5f},
+          {-8.0f, 0.25f, 1.0f}};
+  const arma::fmat expected = points.t();
+
+  // Raw float32, one point after the other
+  const std::string raw = directory.file("points.bin");
+  km_test::writeFile(raw, bytesOf(expected));
+  CHECK(same(load(raw, "raw", 3), expected));
+  CHECK_THROWS(load(raw, "raw"));
+  CHECK_THROWS(load(raw, "raw", 5));
+  km_test::writeFile(raw, bytesOf(expected).substr(0, 11 * sizeof(float)));
+  CHECK_THROWS(load(raw, "raw", 3));
+
+  // .npy in every supported type and order
+  const std::string npy = directory.file("points.npy");
+  const arma::mat pointsDouble = arma::conv_to<arma::mat>::from(points);
+  const std::string cFloat = bytesOf(expected);
+  const std::string fortranFloat = bytesOf(points);
+  const std::string cDouble = bytesOf(arma::mat(pointsDouble.t()));
+  const std::string fortranDouble = bytesOf(pointsDouble);
+  km_test::writeFile(npy, npyFile("<f4", false, "(4, 3)", cFloat));
+  CHECK(same(load(npy, "auto"), expected));
+  km_test::writeFile(npy, npyFile("<f4", true, "(4, 3)", fortranFloat));
+  CHECK(same(load(npy, "npy"), expected));
+  km_test::writeFile(npy, npyFile("<f8", false, "(4, 3)", cDouble));
+  CHECK(same(load(npy, "npy"), expected));
+  km_test::writeFile(npy, npyFile("<f8", true, "(4, 3)", fortranDouble));
+  CHECK(same(load(npy, "npy"), expected));
+
+  // A single feature may be stored as a one-dimensional array
+  km_test::writeFile(
+          npy, npyFile("<f4", false, "(4,)", cFloat.substr(0, 16)));
+  CHECK(same(load(npy, "npy"), arma::fmat(expected.memptr(), 1, 4)));
+
+  // Wrong types, byte orders and truncated files are rejected
+  km_test::writeFile(npy, npyFile("<i4", false, "(4, 3)", cFloat));
+  CHECK_THROWS(load(npy, "npy"));
+  km_test::writeFile(npy, npyFile(">f4", false, "(4, 3)", cFloat));
+  CHECK_THROWS(load(npy, "npy"));
+  km_test::writeFile(
+          npy, npyFile("<f4", false, "(4, 3)", cFloat.substr(0, 11 * 4)));
+  CHECK_THROWS(load(npy, "npy"));
+  km_test::writeFile(
+          npy,
+          npyFile("<f8", true, "(4, 3)", fortranDouble.substr(0, 11 * 8)));
+  CHECK_THROWS(load(npy, "npy"));
+  km_test::writeFile(
+          npy, npyFile("<f4", false, "(4, 3)", cFloat).substr(0, 9));
+  CHECK_THROWS(load(npy, "npy"));
+  km_test::writeFile(npy, "not a numpy file");
+  CHECK_THROWS(load(npy, "npy"));
+
+  // Armadillo binary matrices of floats and doubles
+  const std::string binary = directory.file("points.arma");
+  points.save(binary, arma::arma_binary);
+  CHECK(same(load(binary, "auto"), expected));
+  pointsDouble.save(binary, arma::arma_binary);
+  CHECK(same(load(binary, "arma"), expected));
+  const std::string binaryBytes = km_test::readFile(binary);
+  km_test::writeFile(binary, binaryBytes.substr(0, binaryBytes.size() - 1));
+  CHECK_THROWS(load(binary, "arma"));
+
+  // CSV with a header, and text separated by whitespace
+  const std::string csv = directory.file("points.csv");
+  km_test::writeFile(
+          csv,
+          "a,b,c\n"
+          "0.5,-1.25,3\n"
+          "2,0,-0.75\n"
+          "\n"
+          "1e-3,42,7.5\n"
+          "-8,0.25,1\n");
+  CHECK(same(load(csv, "auto"), expected));
+  km_test::writeFile(
+          csv,
+          "0.5 -1.25 3\r\n2\t0\t-0.75\r\n0.001 42 7.5\r\n-8 0.25 1");
+  CHECK(same(load(csv, "csv"), expected));
+  km_test::writeFile(csv, "0.5,-1.25,3\n2,0\n0.001,42,7.5\n");
+  CHECK_THROWS(load(csv, "csv"));
+  km_test::writeFile(csv, "0.5,-1.25,3\n2,zero,-0.75\n");
+  CHECK_THROWS(load(csv, "csv"));
+  km_test::writeFile(csv, "a,b,c\n");
+  CHECK_THROWS(load(csv, "csv"));
+
+  CHECK_THROWS(load(directory.file("missing.csv"), "csv"));
+  CHECK_THROWS(load(csv, "parquet"));
+
+  // Text large enough to be split into many chunks parses the same with and
+  // without threads
+  arma::arma_rng::set_seed(0);
+  const arma::fmat large = arma::randn<arma::fmat>(8, 20000);
+  const std::string text = directory.file("large.csv");
+  arma::fmat(large.t()).save(text, arma::csv_ascii);
+  CHECK(std::filesystem::file_size(text) > 16 * 65536);
+  omp_set_num_threads(4);
+  const arma::fmat parallel = load(text, "csv", 0, true);
+  const arma::fmat serial = load(text, "csv", 0, false);
+  CHECK(parallel.n_rows == 8 && parallel.n_cols == 20000);
+  CHECK(same(parallel, serial));
+  CHECK(arma::approx_equal(parallel, large, "reldiff", 1e-4f));
+
+  return km_test::failures;
+}
@@ -0,0 +1,288 @@
+/**
+ * @file test_serve.cpp
+ * @date 2026-10-16
+ *
+ * Tests the batching and the request handling of the model server by
+ * driving them directly, without sockets.
+ */
+
+#include <armadillo>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "kmedoids_algorithm.hpp"
+#include "model_server.hpp"
+
+namespace {
+  /**
+   * @brief Returns whether a request was assigned like a direct call to
+   * predictTransposed on its points.
+   */
+  bool assignedLikePredict(
+          const km::KMedoids &model,
+          const km::AssignRequest &request,
+          size_t nFeatures) {
+    const arma::fmat points(request.points, nFeatures, request.nPoints);
+    arma::frowvec distances;
+    const arma::urowvec labels = model.predictTransposed(points, &distances);
+    return request.error.empty() &&
+           request.labels.n_elem == labels.n_elem &&
+           arma::all(request.labels == labels) &&
+           arma::all(request.distances == distances);
+  }
+
+  /**
+   * @brief Appends a request header to a message.
+   */
+  void appendHeader(std::string *message, uint32_t type, uint64_t count) {
+    char header[16] = {};
+    std::memcpy(header, &type, sizeof(type));
+    std::memcpy(header + 8, &count, sizeof(count));
+    message->append(header, sizeof(header));
+  }
+
+  /**
+   * @brief Appends the bytes of a value to a message.
+   */
+  template <typename T>
+  void appendValue(std::string *message, const T &value) {
+    message->append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  /**
+   * @brief Answers the requests of a message as serveRequests would those
+   * read from a connection.
+   *
+   * @param batcher Batcher that assigns the points
+   * @param info Answer to info requests
+   * @param input Requests sent on the connection
+   * @param consumed Number of bytes of input read, written in place
+   *
+   * @returns The responses written to the connection
+   */
+  std::string serveMessage(
+          km::Batcher *batcher,
+          const std::string &info,
+          const std::string &input,
+          size_t *consumed) {
+    std::string output;
+    *consumed = 0;
+    km::serveRequests(
+            [&](void *buffer, size_t bytes) {
+              if (*consumed + bytes > input.size()) {
+                return false;
+              }
+              std::memcpy(buffer, input.data() + *consumed, bytes);
+              *consumed += bytes;
+              return true;
+            },
+            [&](const void *buffer, size_t bytes) {
+              output.append(static_cast<const char *>(buffer), bytes);
+              return true;
+            },
+            batcher,
+            info);
+    return output;
+  }
+
+  /**
+   * @brief Reads the responses written by serveRequests in order.
+   */
+  class Responses {
+   public:
+    explicit Responses(const std::string &bytes) : bytes(bytes) {}
+
+    /**
+     * @brief Reads the header of the next response.
+     *
+     * @param status Status of the response, written in place
+     *
+     * @returns The count of the response
+     */
+    uint64_t header(uint32_t *status) {
+      *status = value<uint32_t>();
+      value<uint32_t>();
+      return value<uint64_t>();
+    }
+
+    /**
+     * @brief Reads the text of a response with the given status.
+     */
+    std::string text(uint32_t expectedStatus) {
+      uint32_t status;
+      const uint64_t length = header(&status);
+      CHECK(status == expectedStatus);
+      const std::string result =
+              position + length <= bytes.size()
+              ? bytes.substr(position, length) : "";
+      position += length;
+      return result;
+    }
+
+    template <typename T>
+    T value() {
+      T result{};
+      if (position + sizeof(T) <= bytes.size()) {
+        std::memcpy(&result, bytes.data() + position, sizeof(T));
+      }
+      position += sizeof(T);
+      return result;
+    }
+
+    /// Whether exactly every byte was read
+    bool atEnd() const {
+      return position == bytes.size();
+    }
+
+   private:
+    const std::string bytes;
+    size_t position = 0;
+  };
+}  // namespace
+
+int main() {
+  // Three well separated groups of points in two dimensions
+  arma::arma_rng::set_seed(0);
+  arma::fmat data = arma::randn<arma::fmat>(60, 2);
+  for (size_t i = 0; i < data.n_rows; i++) {
+    data(i, 0) += 20.0f * (i % 3);
+  }
+  km::KMedoids model(3, "BanditPAM");
+  model.fit(data, "L2", std::nullopt);
+  const arma::fmat transposedData = data.t();
+
+  // Histograms
+  km::Histogram empty;
+  CHECK(empty.json() ==
+        "{\"count\":0,\"mean\":0,\"max\":0,\"p50\":0,\"p90\":0,\"p99\":0,"
+        "\"buckets\":{}}");
+  km::Histogram histogram;
+  for (uint64_t value : {0, 1, 2, 3, 1000}) {
+    histogram.record(value);
+  }
+  CHECK(histogram.json() ==
+        "{\"count\":5,\"mean\":201.2,\"max\":1000,\"p50\":4,\"p90\":1024,"
+        "\"p99\":1024,\"buckets\":{\"1\":1,\"2\":1,\"4\":2,\"1024\":1}}");
+
+  // INFO holds the loss function and the loss of the fit
+  const std::string info = km::modelInfo(model);
+  const std::string infoStart =
+          "{\"medoids\":3,\"features\":2,\"loss_fn\":\"L2\",\"loss\":";
+  CHECK(info.rfind(infoStart, 0) == 0);
+  CHECK(std::stof(info.substr(infoStart.size())) == model.getAverageLoss());
+
+  {
+    // Concurrent requests are coalesced into one pass once the points of
+    // all of them fill it, long before the wait is over
+    km::Batcher batcher(model, 20, std::chrono::seconds(10));
+    CHECK(batcher.nFeatures == 2);
+    std::thread batchThread(&km::Batcher::run, &batcher);
+    std::vector<km::AssignRequest> requests(4);
+    std::vector<std::thread> clients;
+    for (size_t r = 0; r < requests.size(); r++) {
+      requests[r].points = transposedData.colptr(5 * r);
+      requests[r].nPoints = 5;
+      requests[r].received = std::chrono::steady_clock::now();
+      clients.emplace_back(&km::Batcher::submit, &batcher, &requests[r]);
+    }
+    for (std::thread &client : clients) {
+      client.join();
+    }
+    for (const km::AssignRequest &request : requests) {
+      CHECK(assignedLikePredict(model, request, 2));
+    }
+    const std::string stats = batcher.stats();
+    CHECK(stats.rfind("{\"requests\":4,\"points\":20,\"batches\":1,", 0) == 0);
+
+    // A request with more points than a pass is assigned on its own
+    km::AssignRequest large;
+    large.points = transposedData.memptr();
+    large.nPoints = 30;
+    large.received = std::chrono::steady_clock::now();
+    batcher.submit(&large);
+    CHECK(assignedLikePredict(model, large, 2));
+
+    // Requests are rejected once the batcher stops
+    batcher.stop();
+    batchThread.join();
+    km::AssignRequest late;
+    late.points = transposedData.memptr();
+    late.nPoints = 1;
+    batcher.submit(&late);
+    CHECK(late.error == "Error: the server is stopping");
+  }
+
+  {
+    // The requests of a connection are answered in order
+    km::Batcher batcher(model, 1024, std::chrono::microseconds(0));
+    std::thread batchThread(&km::Batcher::run, &batcher);
+    std::string input;
+    appendHeader(&input, km::INFO_REQUEST, 0);
+    appendHeader(&input, km::ASSIGN_REQUEST, 3);
+    appendValue<uint64_t>(&input, 2);
+    input.append(
+            reinterpret_cast<const char *>(transposedData.memptr()),
+            6 * sizeof(float));
+    // Points with the wrong number of features leave the connection open
+    appendHeader(&input, km::ASSIGN_REQUEST, 1);
+    appendValue<uint64_t>(&input, 3);
+    input.append(
+            reinterpret_cast<const char *>(transposedData.memptr()),
+            3 * sizeof(float));
+    appendHeader(&input, km::STATS_REQUEST, 0);
+    // An unknown request ends the connection
+    appendHeader(&input, 9, 0);
+    appendHeader(&input, km::INFO_REQUEST, 0);
+
+    size_t consumed;
+    const std::string output = serveMessage(&batcher, info, input, &consumed);
+    batcher.stop();
+    batchThread.join();
+
+    Responses responses(output);
+    CHECK(responses.text(0) == info);
+    uint32_t status;
+    CHECK(responses.header(&status) == 3);
+    CHECK(status == 0);
+    arma::frowvec distances;
+    const arma::urowvec labels = model.predictTransposed(
+            transposedData.head_cols(3), &distances);
+    for (size_t i = 0; i < 3; i++) {
+      CHECK(responses.value<uint64_t>() == labels(i));
+    }
+    for (size_t i = 0; i < 3; i++) {
+      CHECK(responses.value<float>() == distances(i));
+    }
+    CHECK(responses.text(1) == "Error: points must have 2 features");
+    CHECK(responses.text(0).rfind("{\"requests\":1,\"points\":3,", 0) == 0);
+    CHECK(responses.text(1) == "Error: unknown request type");
+    CHECK(responses.atEnd());
+    // The request after the unknown one is never read
+    CHECK(consumed == input.size() - 16);
+  }
+
+  {
+    // Malformed headers and empty requests end the connection
+    km::Batcher batcher(model, 1024, std::chrono::microseconds(0));
+    for (const bool reserved : {true, false}) {
+      std::string input;
+      appendHeader(&input, km::ASSIGN_REQUEST, 0);
+      input[4] = reserved;
+      appendValue<uint64_t>(&input, 2);
+      size_t consumed;
+      Responses responses(serveMessage(&batcher, info, input, &consumed));
+      CHECK(responses.text(1) ==
+            (reserved ? "Error: malformed request header"
+                      : "Error: the request has no points or too many"));
+      CHECK(responses.atEnd());
+    }
+  }
+
+  return km_test::failures;
+}
@@ -1,8 +1,12 @@
+import os
+import pickle
+import tempfile
 import unittest
+from concurrent.futures import ThreadPoolExecutor
 import pandas as pd
 import numpy as np
 
-from banditpam import KMedoids
+from banditpam import KMedoids, write_mapped_data, compute_distance_matrix
 from utils import bpam_agrees_pam
 from constants import (
     NUM_SMALL_CASES,
@@ -113,6 +117,767 @@ class SmallerTests(unittest.TestCase):
             [16, 25, 31, 49, 63, 70, 82, 90, 94, 99]
         )
 
+    def test_warm_start(self):
+        """
+        Test that fitting from given initial medoids skips BUILD and that
+        starting from a converged solution leaves it unchanged
+        """
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed.fit(self.small_mnist, "L2")
+        final_medoids = sorted(kmed.medoids.tolist())
+
+        kmed_warm = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_warm.fit(self.small_mnist, "L2", init_medoids=final_medoids)
+        self.assertEqual(
+            sorted(kmed_warm.build_medoids.tolist()), final_medoids
+        )
+        self.assertEqual(sorted(kmed_warm.medoids.tolist()), final_medoids)
+        self.assertEqual(kmed_warm.build_distance_computations, 0)
+
+        # wrong number of medoids, out of range, and duplicate medoids
+        self.assertRaises(
+            ValueError, kmed_warm.fit, self.small_mnist, "L2",
+            init_medoids=[0, 1]
+        )
+        self.assertRaises(
+            ValueError, kmed_warm.fit, self.small_mnist, "L2",
+            init_medoids=[0, 1, 2, 3, 1000]
+        )
+        self.assertRaises(
+            ValueError, kmed_warm.fit, self.small_mnist, "L2",
+            init_medoids=[0, 1, 2, 3, 3]
+        )
+
+    def test_build_methods(self):
+        """
+        Test that the LAB and k-medoids++ initializations produce valid
+        medoids with fewer BUILD distance computations than the default BUILD
+        and that SWAP brings them close to it in loss
+        """
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed.fit(self.small_mnist, "L2")
+        self.assertEqual(kmed.build, "bandit")
+
+        for build in ["lab", "kmedoids++"]:
+            kmed_init = KMedoids(n_medoids=5, algorithm="BanditPAM", build=build)
+            kmed_init.fit(self.small_mnist, "L2")
+            self.assertEqual(len(set(kmed_init.build_medoids.tolist())), 5)
+            self.assertEqual(len(set(kmed_init.medoids.tolist())), 5)
+            self.assertLessEqual(
+                kmed_init.average_loss, kmed.average_loss * 1.1
+            )
+            self.assertLess(
+                kmed_init.build_distance_computations,
+                kmed.build_distance_computations,
+            )
+
+        self.assertRaises(ValueError, KMedoids, build="random")
+
+    def test_multiple_swaps_per_iter(self):
+        """
+        Test that applying several non-conflicting swaps per SWAP iteration
+        reaches a comparable loss in fewer iterations
+        """
+        kmed = KMedoids(n_medoids=10, algorithm="BanditPAM")
+        kmed.fit(self.small_mnist, "L2")
+
+        kmed_multi = KMedoids(n_medoids=10, algorithm="BanditPAM")
+        kmed_multi.max_swaps_per_iter = 4
+        kmed_multi.fit(self.small_mnist, "L2")
+        self.assertEqual(kmed_multi.max_swaps_per_iter, 4)
+        self.assertEqual(len(set(kmed_multi.medoids.tolist())), 10)
+        self.assertLessEqual(
+            kmed_multi.average_loss, kmed.average_loss * 1.1
+        )
+        self.assertLess(kmed_multi.steps, kmed.steps)
+
+        with self.assertRaises(ValueError):
+            kmed_multi.max_swaps_per_iter = 0
+
+    def test_reuse_arm_stats(self):
+        """
+        Test that carrying swap arm statistics across SWAP iterations reaches
+        a comparable loss with fewer SWAP distance computations
+        """
+        kmed = KMedoids(n_medoids=10, algorithm="BanditPAM")
+        kmed.fit(self.small_mnist, "L2")
+
+        kmed_reuse = KMedoids(n_medoids=10, algorithm="BanditPAM")
+        kmed_reuse.reuse_arm_stats = True
+        kmed_reuse.fit(self.small_mnist, "L2")
+        self.assertTrue(kmed_reuse.reuse_arm_stats)
+        self.assertEqual(len(set(kmed_reuse.medoids.tolist())), 10)
+        self.assertLessEqual(
+            kmed_reuse.average_loss, kmed.average_loss * 1.1
+        )
+        self.assertLess(
+            kmed_reuse.swap_distance_computations,
+            kmed.swap_distance_computations,
+        )
+        self.assertLess(
+            kmed_reuse.swap_distance_computations / kmed_reuse.steps,
+            kmed.swap_distance_computations / kmed.steps,
+        )
+        # Sigma comes from the reused statistics, not from sigma batches
+        self.assertLess(
+            kmed_reuse.misc_distance_computations,
+            kmed.misc_distance_computations,
+        )
+
+    def test_online_sigma(self):
+        """
+        Test that estimating sigma from the sampling rounds skips the
+        separate sigma batches and reaches a comparable loss
+        """
+        kmed = KMedoids(n_medoids=10, algorithm="BanditPAM")
+        kmed.fit(self.small_mnist, "L2")
+
+        kmed_online = KMedoids(n_medoids=10, algorithm="BanditPAM")
+        kmed_online.online_sigma = True
+        kmed_online.fit(self.small_mnist, "L2")
+        self.assertTrue(kmed_online.online_sigma)
+        self.assertEqual(len(set(kmed_online.medoids.tolist())), 10)
+        self.assertLessEqual(
+            kmed_online.average_loss, kmed.average_loss * 1.1
+        )
+        self.assertLess(
+            kmed_online.misc_distance_computations / (kmed_online.steps + 1),
+            kmed.misc_distance_computations / (kmed.steps + 1),
+        )
+        # Without sigma batches, MISC computations only come from passes that
+        # compare every point with the medoids: during BUILD, for the BUILD
+        # loss, before SWAP and after each SWAP iteration
+        self.assertLessEqual(
+            kmed_online.misc_distance_computations,
+            len(self.small_mnist) * 10 * (kmed_online.steps + 4),
+        )
+
+    def test_tolerance(self):
+        """
+        Test that ending bandit rounds within a tolerance of the best arm
+        reaches a comparable loss with fewer distance computations
+        """
+        kmed = KMedoids(n_medoids=10, algorithm="BanditPAM")
+        kmed.fit(self.small_mnist, "L2")
+
+        for relative in [False, True]:
+            kmed_tol = KMedoids(n_medoids=10, algorithm="BanditPAM")
+            kmed_tol.tolerance = 0.05 if relative else 0.5
+            kmed_tol.relative_tolerance = relative
+            kmed_tol.fit(self.small_mnist, "L2")
+            self.assertEqual(len(set(kmed_tol.medoids.tolist())), 10)
+            self.assertLessEqual(
+                kmed_tol.average_loss, kmed.average_loss * 1.1
+            )
+            self.assertLessEqual(
+                kmed_tol.build_distance_computations,
+                kmed.build_distance_computations,
+            )
+            self.assertLess(
+                kmed_tol.build_distance_computations
+                + kmed_tol.swap_distance_computations,
+                kmed.build_distance_computations
+                + kmed.swap_distance_computations,
+            )
+
+        self.assertRaises(ValueError, setattr, kmed, "tolerance", -1)
+
+    def test_partial_fit(self):
+        """
+        Test that points added with partial_fit are labeled and that the
+        updated medoids remain valid and close in loss to a full fit
+        """
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        self.assertRaises(ValueError, kmed.partial_fit, self.small_mnist)
+
+        kmed.fit(self.small_mnist[:70], "L2")
+        kmed.partial_fit(self.small_mnist[70:], max_iter=3)
+        self.assertEqual(len(kmed.labels), len(self.small_mnist))
+        self.assertEqual(len(set(kmed.medoids.tolist())), 5)
+        self.assertTrue(np.all(kmed.medoids < len(self.small_mnist)))
+        self.assertLessEqual(kmed.steps, 3)
+
+        kmed_full = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_full.fit(self.small_mnist, "L2")
+        self.assertLessEqual(
+            kmed.average_loss, kmed_full.average_loss * 1.2
+        )
+
+        # wrong number of features
+        self.assertRaises(
+            ValueError, kmed.partial_fit, self.small_mnist[:5, :10]
+        )
+
+    def test_n_init(self):
+        """
+        Test that restarts keep the medoids with the lowest loss, which is
+        no worse than that of a single run from the same seed
+        """
+        kmed_single = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_single.fit(self.small_mnist, "L2")
+
+        kmed_restarts = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_restarts.n_init = 4
+        self.assertEqual(kmed_restarts.n_init, 4)
+        kmed_restarts.fit(self.small_mnist, "L2")
+
+        self.assertEqual(len(set(kmed_restarts.medoids.tolist())), 5)
+        self.assertLessEqual(
+            kmed_restarts.average_loss, kmed_single.average_loss + 1e-3
+        )
+        self.assertAlmostEqual(
+            kmed_restarts.average_loss,
+            np.linalg.norm(
+                self.small_mnist[:, None, :]
+                - self.small_mnist[kmed_restarts.medoids][None, :, :],
+                axis=2,
+            ).min(axis=1).mean(),
+            delta=1e-2,
+        )
+
+        # Each restart draws from its own stream, so the result does not
+        # depend on which thread runs it
+        kmed_again = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_again.n_init = 4
+        kmed_again.fit(self.small_mnist, "L2")
+        self.assertEqual(
+            kmed_again.medoids.tolist(), kmed_restarts.medoids.tolist()
+        )
+        self.assertGreater(
+            kmed_restarts.build_distance_computations,
+            kmed_single.build_distance_computations,
+        )
+
+        with self.assertRaises(ValueError):
+            kmed_restarts.n_init = 0
+
+    def test_medoid_tree(self):
+        """
+        Test that assigning points with the medoid tree gives the same
+        clustering as scanning all medoids for metric losses
+        """
+        for loss in ["L1", "L2", "inf"]:
+            kmed_scan = KMedoids(n_medoids=10, algorithm="BanditPAM")
+            kmed_scan.fit(self.small_mnist, loss)
+
+            kmed_tree = KMedoids(n_medoids=10, algorithm="BanditPAM")
+            kmed_tree.medoid_tree = True
+            self.assertTrue(kmed_tree.medoid_tree)
+            kmed_tree.fit(self.small_mnist, loss)
+
+            self.assertEqual(
+                sorted(kmed_tree.medoids.tolist()),
+                sorted(kmed_scan.medoids.tolist()),
+            )
+            self.assertAlmostEqual(
+                kmed_tree.average_loss, kmed_scan.average_loss, places=3
+            )
+            self.assertEqual(
+                kmed_tree.predict(self.small_mnist).tolist(),
+                kmed_tree.labels.tolist(),
+            )
+
+    def test_collapse_duplicates(self):
+        """
+        Test that collapsing duplicate points gives labels for every row,
+        the same label to copies of a point, and the loss over all rows
+        """
+        data = np.vstack(
+            [self.small_mnist, self.small_mnist[:50], self.small_mnist[:50]]
+        )
+        kmed_rows = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_rows.fit(data, "L2")
+
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed.collapse_duplicates = True
+        self.assertTrue(kmed.collapse_duplicates)
+        kmed.fit(data, "L2")
+
+        labels = kmed.labels.tolist()
+        self.assertEqual(len(labels), len(data))
+        self.assertEqual(labels[100:150], labels[:50])
+        self.assertEqual(labels[150:], labels[:50])
+        self.assertTrue(all(0 <= m < len(data) for m in kmed.medoids))
+        self.assertEqual(len(set(kmed.medoids.tolist())), 5)
+
+        medoids = data[kmed.medoids]
+        distances = np.linalg.norm(
+            data[:, None, :] - medoids[None, :, :], axis=2
+        )
+        self.assertEqual(labels, distances.argmin(axis=1).tolist())
+        self.assertAlmostEqual(
+            kmed.average_loss, distances.min(axis=1).mean(), delta=1e-2
+        )
+        self.assertLess(kmed.average_loss, kmed_rows.average_loss * 1.05)
+
+        # only BanditPAM weighs the points
+        kmed_pam = KMedoids(n_medoids=5, algorithm="PAM")
+        kmed_pam.collapse_duplicates = True
+        self.assertRaises(ValueError, kmed_pam.fit, data, "L2")
+
+    def test_zero_copy_fit(self):
+        """
+        Test that C-contiguous float32 input, which is used in place, gives
+        the same clustering as other layouts and is left unchanged
+        """
+        data32 = np.ascontiguousarray(self.small_mnist, dtype=np.float32)
+        original = data32.copy()
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed.fit(data32, "L2")
+        np.testing.assert_array_equal(data32, original)
+
+        kmed_fortran = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_fortran.fit(np.asfortranarray(data32), "L2")
+        self.assertEqual(kmed.medoids.tolist(), kmed_fortran.medoids.tolist())
+        self.assertAlmostEqual(
+            kmed.average_loss, kmed_fortran.average_loss, places=3
+        )
+
+        # the fitted model does not depend on the caller keeping a reference
+        kmed_temporary = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_temporary.fit(self.small_mnist.astype(np.float32), "L2")
+        kmed_temporary.partial_fit(data32[:10])
+        self.assertEqual(len(kmed_temporary.labels), len(data32) + 10)
+
+        # the model keeps its own copy of the points once the fit is over,
+        # so later writes to the array do not reach it
+        data32[:] = 0
+        kmed.partial_fit(original[:10], max_iter=3)
+        kmed_fortran.partial_fit(original[:10], max_iter=3)
+        np.testing.assert_array_equal(data32, 0)
+        self.assertEqual(kmed.medoids.tolist(), kmed_fortran.medoids.tolist())
+        self.assertEqual(kmed.labels.tolist(), kmed_fortran.labels.tolist())
+
+    def test_fit_mapped(self):
+        """
+        Test that fitting a memory-mapped file gives the same medoids as
+        fitting the same data in memory
+        """
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "mnist.bpam")
+            write_mapped_data(path, self.small_mnist)
+
+            kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+            kmed.fit(self.small_mnist, "L2")
+            kmed_mapped = KMedoids(n_medoids=5, algorithm="BanditPAM")
+            kmed_mapped.fit_mapped(path, "L2")
+            self.assertEqual(
+                kmed_mapped.medoids.tolist(), kmed.medoids.tolist()
+            )
+            self.assertAlmostEqual(
+                kmed_mapped.average_loss, kmed.average_loss, places=3
+            )
+
+            # fitting in-memory data afterwards releases the mapping
+            kmed_mapped.fit(self.small_mnist[:50], "L2")
+            self.assertEqual(len(kmed_mapped.labels), 50)
+
+            self.assertRaises(
+                ValueError, kmed.fit_mapped, os.path.join(directory, "none"),
+                "L2"
+            )
+
+    def test_fit_k_range(self):
+        """
+        Test that a sweep over k gives valid medoids for each k, that the
+        BUILD medoids are nested, and that the losses decrease with k
+        """
+        ks = [2, 3, 5, 8]
+        kmed = KMedoids(algorithm="BanditPAM")
+        result = kmed.fit_k_range(self.small_mnist, "L2", ks)
+
+        self.assertEqual(result["k"], ks)
+        self.assertEqual(len(result["medoids"]), len(ks))
+        for k, medoids in zip(ks, result["medoids"]):
+            self.assertEqual(len(set(medoids.tolist())), k)
+        # BUILD runs once, so each k's BUILD medoids are a prefix of the next
+        build = [m.ravel().tolist() for m in result["build_medoids"]]
+        for k, smaller, larger in zip(ks, build, build[1:]):
+            self.assertEqual(len(smaller), k)
+            self.assertEqual(larger[:k], smaller)
+        self.assertEqual(kmed.build_medoids.tolist(), build[-1])
+        self.assertTrue(np.all(np.diff(result["build_loss"]) <= 0))
+        self.assertTrue(np.all(result["loss"] <= result["build_loss"] + 1e-3))
+        for labels, medoids in zip(result["labels"], result["medoids"]):
+            self.assertEqual(len(labels), len(self.small_mnist))
+            self.assertEqual(set(labels.tolist()), set(range(len(medoids))))
+        self.assertEqual(len(result["steps"]), len(ks))
+        self.assertEqual(len(result["swap_time"]), len(ks))
+        self.assertEqual(len(result["swap_distance_computations"]), len(ks))
+        self.assertGreaterEqual(result["build_time"], 0)
+
+        # The model is left fitted with the last k
+        self.assertEqual(kmed.medoids.tolist(), result["medoids"][-1].tolist())
+        self.assertAlmostEqual(kmed.average_loss, result["loss"][-1], places=3)
+
+        kmed_single = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_single.fit(self.small_mnist, "L2")
+        self.assertLessEqual(
+            result["loss"][2], kmed_single.average_loss * 1.1
+        )
+
+        self.assertRaises(
+            ValueError, kmed.fit_k_range, self.small_mnist, "L2", [0, 2]
+        )
+        self.assertRaises(
+            ValueError, KMedoids(algorithm="PAM").fit_k_range,
+            self.small_mnist, "L2", [2, 3]
+        )
+
+    def test_condensed_dist_mat(self):
+        """
+        Test that condensed, float16 and memory-mapped distance matrices give
+        the same medoids as the dense distance matrix
+        """
+        data = self.small_mnist.astype(np.float32)
+        dense = np.linalg.norm(
+            data[:, None, :] - data[None, :, :], axis=2
+        ).astype(np.float32)
+        condensed = dense[np.triu_indices(len(data), 1)]
+
+        kmed = KMedoids(n_medoids=5, algorithm="PAM")
+        kmed.fit(data, "L2", dist_mat=dense)
+        kmed_condensed = KMedoids(n_medoids=5, algorithm="PAM")
+        kmed_condensed.fit(data, "L2", dist_mat=condensed)
+        self.assertEqual(
+            kmed_condensed.medoids.tolist(), kmed.medoids.tolist()
+        )
+
+        kmed_half = KMedoids(n_medoids=5, algorithm="PAM")
+        kmed_half.fit(data, "L2", dist_mat=condensed.astype(np.float16))
+        self.assertLessEqual(
+            kmed_half.average_loss, kmed.average_loss * 1.01
+        )
+
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "distances.npy")
+            np.save(path, condensed)
+            kmed_mapped = KMedoids(n_medoids=5, algorithm="PAM")
+            kmed_mapped.fit(data, "L2", dist_mat_path=path)
+            self.assertEqual(
+                kmed_mapped.medoids.tolist(), kmed.medoids.tolist()
+            )
+
+            raw_path = os.path.join(directory, "distances.bin")
+            condensed.tofile(raw_path)
+            kmed_mapped.fit(data, "L2", dist_mat_path=raw_path)
+            self.assertEqual(
+                kmed_mapped.medoids.tolist(), kmed.medoids.tolist()
+            )
+
+        # the distance matrix does not match the number of points
+        self.assertRaises(
+            ValueError, kmed.fit, data[:50], "L2", dist_mat=condensed
+        )
+        self.assertRaises(
+            ValueError, kmed.fit, data, "L2", dist_mat=condensed[:-1]
+        )
+
+    def test_compute_distance_matrix(self):
+        """
+        Test that the dense, condensed and float16 distance matrices match
+        the distances computed with numpy
+        """
+        data = self.small_mnist.astype(np.float32)
+        expected = np.linalg.norm(data[:, None, :] - data[None, :, :], axis=2)
+        upper = np.triu_indices(len(data), 1)
+
+        dense = compute_distance_matrix(data, "L2")
+        self.assertEqual(dense.shape, (len(data), len(data)))
+        self.assertEqual(dense.dtype, np.float32)
+        np.testing.assert_allclose(dense, expected, rtol=1e-4, atol=1e-4)
+        np.testing.assert_array_equal(dense, dense.T)
+        self.assertTrue(np.all(np.diag(dense) == 0))
+
+        condensed = compute_distance_matrix(data, "L2", condensed=True)
+        np.testing.assert_array_equal(condensed, dense[upper])
+
+        half = compute_distance_matrix(data, "L2", dtype="float16")
+        self.assertEqual(half.dtype, np.float16)
+        np.testing.assert_allclose(half, expected, rtol=1e-3, atol=1e-3)
+
+        # near-duplicate points, whose distance the L2 expansion would lose
+        near = np.vstack([data, data[:1]])
+        near[-1, 0] += 0.01
+        near_distance = np.linalg.norm(near[-1] - near[0])
+        self.assertAlmostEqual(
+            compute_distance_matrix(near, "L2")[0, -1],
+            near_distance,
+            delta=near_distance * 1e-4,
+        )
+
+        manhattan = compute_distance_matrix(
+            data, "manhattan", condensed=True, parallelize=False
+        )
+        np.testing.assert_allclose(
+            manhattan,
+            np.abs(data[:, None, :] - data[None, :, :]).sum(axis=2)[upper],
+            rtol=1e-4,
+        )
+
+        # written in place into a memory-mapped .npy file
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "distances.npy")
+            out = np.lib.format.open_memmap(
+                path, mode="w+", dtype=np.float32, shape=condensed.shape
+            )
+            result = compute_distance_matrix(
+                data, "L2", out=out, condensed=True
+            )
+            self.assertIs(result, out)
+            out.flush()
+            del out, result
+            kmed = KMedoids(n_medoids=5, algorithm="PAM")
+            kmed.fit(data, "L2", dist_mat_path=path)
+            kmed_dense = KMedoids(n_medoids=5, algorithm="PAM")
+            kmed_dense.fit(data, "L2", dist_mat=dense)
+            self.assertEqual(
+                kmed.medoids.tolist(), kmed_dense.medoids.tolist()
+            )
+
+        self.assertRaises(
+            ValueError, compute_distance_matrix, data, "L2",
+            out=np.zeros((5, 5), dtype=np.float32)
+        )
+        # out must have the layout that condensed asks for
+        self.assertRaises(
+            ValueError, compute_distance_matrix, data, "L2",
+            out=np.zeros(condensed.shape, dtype=np.float32)
+        )
+        self.assertRaises(
+            ValueError, compute_distance_matrix, data, "L2", condensed=True,
+            out=np.zeros(dense.shape, dtype=np.float32)
+        )
+
+    def test_concurrent_fits(self):
+        """
+        Test that models fit concurrently from several threads give the same
+        medoids as the same models fit one after the other
+        """
+        seeds = [0, 1, 2, 3]
+
+        def fit(seed):
+            kmed = KMedoids(n_medoids=5, algorithm="BanditPAM", seed=seed)
+            kmed.fit(self.small_mnist, "L2")
+            return kmed.medoids.tolist(), kmed.build_medoids.tolist()
+
+        sequential = [fit(seed) for seed in seeds]
+        with ThreadPoolExecutor(max_workers=len(seeds)) as executor:
+            concurrent = list(executor.map(fit, seeds))
+        self.assertEqual(concurrent, sequential)
+
+    def test_fit_async(self):
+        """
+        Test that an asynchronous fit reports its progress, gives the same
+        medoids as a synchronous fit, and stops early when cancelled
+        """
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        reports = []
+        handle = kmed.fit_async(
+            self.small_mnist, "L2", callback=reports.append
+        )
+        self.assertIs(handle.result(), kmed)
+        self.assertTrue(handle.done())
+        self.assertFalse(kmed.cancelled)
+
+        build = [r for r in reports if r["phase"] == "build"]
+        swap = [r for r in reports if r["phase"] == "swap"]
+        self.assertEqual([r["step"] for r in build], [1, 2, 3, 4, 5])
+        self.assertEqual(len(swap), kmed.steps)
+        self.assertTrue(all(r["total"] == 5 for r in build))
+        counts = [r["distance_computations"] for r in reports]
+        self.assertEqual(counts, sorted(counts))
+        self.assertAlmostEqual(swap[-1]["loss"], kmed.average_loss, places=3)
+        self.assertEqual(handle.progress(), reports[-1])
+
+        kmed_sync = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_sync.fit(self.small_mnist, "L2")
+        self.assertEqual(kmed.medoids.tolist(), kmed_sync.medoids.tolist())
+
+        # cancelled after the first medoid of BUILD: the other medoids are
+        # seeded and SWAP is skipped
+        kmed_build = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        handle = kmed_build.fit_async(
+            self.small_mnist, "L2", callback=lambda p: kmed_build.cancel()
+        )
+        handle.result()
+        self.assertTrue(kmed_build.cancelled)
+        self.assertEqual(len(set(kmed_build.medoids.tolist())), 5)
+        self.assertEqual(kmed_build.steps, 0)
+        self.assertEqual(len(kmed_build.labels), len(self.small_mnist))
+
+        # the cancelled model is complete, so it can be saved and reloaded
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "cancelled.bpam")
+            kmed_build.save(path)
+            loaded = KMedoids.load(path)
+            self.assertEqual(
+                loaded.medoids.tolist(), kmed_build.medoids.tolist()
+            )
+            self.assertEqual(
+                loaded.predict(self.small_mnist).tolist(),
+                kmed_build.labels.tolist(),
+            )
+        unpickled = pickle.loads(pickle.dumps(kmed_build))
+        self.assertEqual(
+            unpickled.medoids.tolist(), kmed_build.medoids.tolist()
+        )
+
+        # cancelled after the first SWAP iteration
+        kmed_swap = KMedoids(n_medoids=5, algorithm="BanditPAM")
+
+        def cancel_in_swap(progress):
+            if progress["phase"] == "swap":
+                kmed_swap.cancel()
+
+        kmed_swap.fit_async(
+            self.small_mnist, "L2", callback=cancel_in_swap
+        ).result()
+        self.assertTrue(kmed_swap.cancelled)
+        self.assertEqual(np.size(kmed_swap.medoids), 5)
+        self.assertEqual(kmed_swap.steps, 1)
+
+        # errors of the fit are raised by result
+        handle = KMedoids(n_medoids=5).fit_async(
+            self.small_mnist, "L2", init_medoids=[0, 0, 1, 2, 3]
+        )
+        self.assertRaises(ValueError, handle.result)
+
+    def test_checkpoint(self):
+        """
+        Test that a fit resumed from the checkpoint of an interrupted fit
+        finds the same medoids as an uninterrupted fit
+        """
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed.fit(self.small_mnist, "L2")
+
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "fit.ckpt")
+            for cache in [False, True]:
+                # stopped after the first SWAP iteration
+                kmed_first = KMedoids(
+                    n_medoids=5, algorithm="BanditPAM", max_iter=1
+                )
+                kmed_first.checkpoint_path = path
+                kmed_first.checkpoint_cache = cache
+                kmed_first.fit(self.small_mnist, "L2")
+                self.assertTrue(os.path.exists(path))
+                self.assertFalse(os.path.exists(path + ".tmp"))
+
+                kmed_resumed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+                kmed_resumed.fit(self.small_mnist, "L2", resume_from=path)
+                self.assertEqual(
+                    kmed_resumed.medoids.tolist(), kmed.medoids.tolist()
+                )
+                self.assertEqual(
+                    kmed_resumed.build_medoids.tolist(),
+                    kmed.build_medoids.tolist(),
+                )
+                self.assertEqual(kmed_resumed.build_distance_computations, 0)
+
+            # the checkpoint belongs to other data
+            self.assertRaises(
+                ValueError,
+                KMedoids(n_medoids=5).fit,
+                self.small_mnist[:50],
+                "L2",
+                resume_from=path,
+            )
+
+    def test_budget(self):
+        """
+        Test that fits out of budget still return as many medoids as asked
+        for and report that the budget was exhausted
+        """
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed.fit(self.small_mnist, "L2")
+        self.assertFalse(kmed.budget_exhausted)
+
+        kmed_time = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_time.time_budget = 1000
+        kmed_time.fit(self.small_mnist, "L2")
+        self.assertFalse(kmed_time.budget_exhausted)
+        self.assertEqual(kmed_time.medoids.tolist(), kmed.medoids.tolist())
+
+        # spent during the first medoid: the rest are seeded, SWAP skipped
+        kmed_small = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        kmed_small.distance_budget = 1
+        kmed_small.fit(self.small_mnist, "L2")
+        self.assertTrue(kmed_small.budget_exhausted)
+        self.assertEqual(len(set(kmed_small.medoids.tolist())), 5)
+        self.assertEqual(kmed_small.steps, 0)
+        self.assertEqual(len(kmed_small.labels), len(self.small_mnist))
+
+        self.assertRaises(ValueError, setattr, kmed, "time_budget", -1)
+
+    def test_save_load(self):
+        """
+        Test that saved, loaded and pickled models keep their settings and
+        medoids and predict without the training data
+        """
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM", max_iter=50)
+        kmed.fit(self.small_mnist, "L2")
+        labels = kmed.predict(self.small_mnist)
+
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "model.bpam")
+            kmed.save(path)
+            loaded = KMedoids.load(path)
+            self.assertEqual(loaded.medoids.tolist(), kmed.medoids.tolist())
+            self.assertEqual(
+                loaded.build_medoids.tolist(), kmed.build_medoids.tolist()
+            )
+            self.assertEqual(loaded.labels.tolist(), kmed.labels.tolist())
+            self.assertEqual(loaded.max_iter, 50)
+            self.assertEqual(loaded.loss_function, "L2")
+            self.assertAlmostEqual(loaded.average_loss, kmed.average_loss)
+            self.assertEqual(
+                loaded.predict(self.small_mnist).tolist(), labels.tolist()
+            )
+
+            # without the coordinates the medoids are kept but not predict
+            kmed.save(path, include_medoids=False)
+            loaded = KMedoids.load(path)
+            self.assertEqual(loaded.medoids.tolist(), kmed.medoids.tolist())
+            self.assertRaises(ValueError, loaded.predict, self.small_mnist)
+
+            with open(path, "wb") as f:
+                f.write(b"not a model")
+            self.assertRaises(ValueError, KMedoids.load, path)
+
+        unpickled = pickle.loads(pickle.dumps(kmed))
+        self.assertEqual(unpickled.medoids.tolist(), kmed.medoids.tolist())
+        self.assertEqual(
+            unpickled.predict(self.small_mnist).tolist(), labels.tolist()
+        )
+
+    def test_predict(self):
+        """
+        Test that predict assigns the training points to their medoids and
+        returns the distance to the closest medoid
+        """
+        kmed = KMedoids(n_medoids=5, algorithm="BanditPAM")
+        self.assertRaises(ValueError, kmed.predict, self.small_mnist)
+
+        kmed.fit(self.small_mnist, "L2")
+        labels = kmed.predict(self.small_mnist)
+        self.assertEqual(labels.tolist(), kmed.labels.tolist())
+
+        labels, distances = kmed.predict(
+            self.small_mnist, return_distances=True
+        )
+        medoids = self.small_mnist[kmed.medoids]
+        expected = np.linalg.norm(
+            self.small_mnist[:, None, :] - medoids[None, :, :], axis=2
+        ).min(axis=1)
+        np.testing.assert_allclose(distances, expected, rtol=1e-3, atol=1e-2)
+        self.assertAlmostEqual(
+            distances.mean(), kmed.average_loss, delta=1e-2
+        )
+
+        # wrong number of features
+        self.assertRaises(ValueError, kmed.predict, self.small_mnist[:5, :10])
+
     def test_edge_cases(self):
         """
         Test that BanditPAM raises errors on n_medoids being unspecified or